@@ -0,0 +1,74 @@
+#!/bin/sh
+#
+# This file is part of the Parallel Tools GUI Framework (PTGF)
+# Copyright (C) 2010-2011 Argo Navis Technologies, LLC
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License as published by the Free Software Foundation; either
+# version 2.1 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# License along with this library; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+#
+# Generates synthetic graphs of increasing size and runs the benchmark over
+# them, giving one CSV of load, layout, render and interaction times against
+# node count for each topology.
+#
+# Usage: scaling.sh [build directory] [output directory]
+#
+# Environment:
+#   TYPES     topologies to generate (default "calltree ring torus dag")
+#   SIZES     node counts (default "1k 10k 100k 1M")
+#   TIMEOUT   seconds before a graph is given up on (default 1800)
+#   BENCH_ARGS  extra arguments for the benchmark, e.g. "--edge-batching"
+
+BUILD_DIR=${1:-$(dirname "$0")/../src}
+OUTPUT_DIR=${2:-scaling-$(date +%Y%m%d-%H%M%S)}
+
+TYPES=${TYPES:-"calltree ring torus dag"}
+SIZES=${SIZES:-"1k 10k 100k 1M"}
+TIMEOUT=${TIMEOUT:-1800}
+
+find_program() {
+    find "$BUILD_DIR" -type f -perm -u+x -name "$1*" | head -n 1
+}
+
+GENERATOR=$(find_program GenerateQGraphViz)
+BENCH=$(find_program BenchQGraphViz)
+
+if [ -z "$GENERATOR" ] || [ -z "$BENCH" ]; then
+    echo "Could not find GenerateQGraphViz and BenchQGraphViz under $BUILD_DIR; build src/QGraphViz.pro first" >&2
+    exit 1
+fi
+
+mkdir -p "$OUTPUT_DIR/graphs" || exit 1
+RESULTS="$OUTPUT_DIR/results.csv"
+
+HEADER_WRITTEN=
+for TYPE in $TYPES; do
+    for SIZE in $SIZES; do
+        GRAPH="$OUTPUT_DIR/graphs/$TYPE-$SIZE.dot"
+        echo "Generating $TYPE with $SIZE nodes" >&2
+        "$GENERATOR" --type "$TYPE" --nodes "$SIZE" --output "$GRAPH" || exit 1
+
+        echo "Benchmarking $GRAPH" >&2
+        # shellcheck disable=SC2086
+        "$BENCH" --timeout "$TIMEOUT" $BENCH_ARGS "$GRAPH" > "$OUTPUT_DIR/row.csv"
+
+        if [ -z "$HEADER_WRITTEN" ]; then
+            echo "type,size,$(head -n 1 "$OUTPUT_DIR/row.csv")" > "$RESULTS"
+            HEADER_WRITTEN=1
+        fi
+        tail -n +2 "$OUTPUT_DIR/row.csv" | sed "s/^/$TYPE,$SIZE,/" >> "$RESULTS"
+    done
+done
+
+rm -f "$OUTPUT_DIR/row.csv"
+echo "Results written to $RESULTS" >&2
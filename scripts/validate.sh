@@ -0,0 +1,138 @@
+#!/bin/sh
+#
+# This file is part of the Parallel Tools GUI Framework (PTGF)
+# Copyright (C) 2010-2011 Argo Navis Technologies, LLC
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License as published by the Free Software Foundation; either
+# version 2.1 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# License along with this library; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+#
+# Checks the native DOT parser against GraphViz's own: runs the benchmark's
+# --validate mode over the graphs in test/, a few synthetic graphs of each
+# topology, and a set of small graphs with the corners of the DOT language in
+# them (escapes, quoted keywords, late and scoped defaults, strict edges).
+# Prints the rows that don't match, and exits with 1 if there are any.
+#
+# Usage: validate.sh [build directory] [graph files or directories...]
+#
+# Environment:
+#   TYPES     topologies to generate (default "calltree ring torus dag")
+#   SIZES     node counts (default "100 1k")
+
+BUILD_DIR=${1:-$(dirname "$0")/../src}
+[ $# -gt 0 ] && shift
+TEST_DIR=$(dirname "$0")/../test
+
+TYPES=${TYPES:-"calltree ring torus dag"}
+SIZES=${SIZES:-"100 1k"}
+
+find_program() {
+    find "$BUILD_DIR" -type f -perm -u+x -name "$1*" | head -n 1
+}
+
+GENERATOR=$(find_program GenerateQGraphViz)
+BENCH=$(find_program BenchQGraphViz)
+
+if [ -z "$GENERATOR" ] || [ -z "$BENCH" ]; then
+    echo "Could not find GenerateQGraphViz and BenchQGraphViz under $BUILD_DIR; build src/QGraphViz.pro first" >&2
+    exit 1
+fi
+
+WORK_DIR=$(mktemp -d) || exit 1
+trap 'rm -rf "$WORK_DIR"' EXIT
+
+for TYPE in $TYPES; do
+    for SIZE in $SIZES; do
+        "$GENERATOR" --type "$TYPE" --nodes "$SIZE" --output "$WORK_DIR/$TYPE-$SIZE.dot" || exit 1
+    done
+done
+
+cat > "$WORK_DIR/escapes.gv" <<'DOT'
+digraph "a \"quoted\" name" {
+    "C:\\" -> "ends with \\\\";
+    "line \
+continued" -> "split " + "across" + " strings";
+    a [label="\N is \"\\N\"", tooltip="tab\tand\\"];
+    b [label=<<b>bold</b> &amp; <i>html</i>>];
+    c [label="// not a comment", xlabel="/* nor this */"];
+    -1.5 -> .5 -> 2.;
+}
+DOT
+
+cat > "$WORK_DIR/keywords.gv" <<'DOT'
+graph {
+    "node" -- "edge" -- "graph";
+    "subgraph" [label="strict"];
+    "{" -- "}";
+    ";" -- "[";
+}
+DOT
+
+cat > "$WORK_DIR/defaults.gv" <<'DOT'
+digraph {
+    a -> b;
+    node [shape=box, color=red];
+    edge [style=dashed];
+    c -> d;
+    a [shape=circle];
+    node [shape=ellipse];
+    e;
+    a [color=blue];
+    subgraph s {
+        node [fillcolor=grey, shape=diamond];
+        edge [arrowhead=none];
+        f -> g;
+        a;
+    }
+    h -> f;
+    node [fillcolor=white];
+    edge [weight=2];
+}
+DOT
+
+cat > "$WORK_DIR/strict.gv" <<'DOT'
+strict graph {
+    a -- b [color=red];
+    b -- a [style=bold];
+    a -- a;
+    a -- {b c} -- d:n:s;
+    subgraph cluster_x { label=inner; c; d }
+}
+DOT
+
+cat > "$WORK_DIR/ports.gv" <<'DOT'
+digraph {
+    rankdir=LR
+    a:out:e -> b:in;
+    {rank=same; a b} -> subgraph t { x y }
+    t -> z;
+}
+DOT
+
+cat > "$WORK_DIR/broken.gv" <<'DOT'
+digraph {
+    a -> ;
+}
+DOT
+
+"$BENCH" --validate "$TEST_DIR" "$WORK_DIR" "$@" > "$WORK_DIR/results.csv"
+STATUS=$?
+
+MISMATCHES=$(tail -n +2 "$WORK_DIR/results.csv" | grep -v ',ok$')
+if [ -n "$MISMATCHES" ]; then
+    head -n 1 "$WORK_DIR/results.csv"
+    echo "$MISMATCHES"
+fi
+
+echo "$(tail -n +2 "$WORK_DIR/results.csv" | wc -l) graphs validated, $(echo "$MISMATCHES" | grep -c .) mismatched" >&2
+exit $STATUS
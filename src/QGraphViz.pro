@@ -17,9 +17,17 @@
 
 TEMPLATE = subdirs
 
-SUBDIRS  = lib test
+SUBDIRS  = lib worker test bench generator
 
 lib.subdir = lib
 
+worker.subdir = worker
+worker.depends = lib
+
 test.subdir = test
 test.depends = lib
+
+bench.subdir = bench
+bench.depends = lib
+
+generator.subdir = generator
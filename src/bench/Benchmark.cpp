@@ -0,0 +1,430 @@
+/*!
+   \file
+   \author Dane Gardner <dane.gardner@gmail.com>
+   \version
+
+   \section LICENSE
+   This file is part of the Parallel Tools GUI Framework (PTGF)
+   Copyright (C) 2010-2011 Argo Navis Technologies, LLC
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+   \section DESCRIPTION
+
+ */
+
+#include "Benchmark.h"
+
+#include <QGraphVizScene.h>
+#include <QGraphVizView.h>
+#include <QGraphVizLayoutCache.h>
+#include <QGraphVizLayoutPool.h>
+#include <QGraphVizDotGraph.h>
+#include <QGraphVizDecompressor.h>
+
+#if defined(Q_OS_WIN)
+#  include <windows.h>
+#  include <psapi.h>
+#elif defined(Q_OS_UNIX)
+#  include <sys/resource.h>
+#endif
+
+
+
+/*! Exposes the item counts, which the scene keeps to itself
+ */
+class BenchmarkScene : public QGraphVizScene
+{
+public:
+    explicit BenchmarkScene(QObject *parent = 0) : QGraphVizScene(parent) {}
+
+    int nodeCount() { return getNodes().count(); }
+    int edgeCount() { return getEdges().count(); }
+};
+
+
+
+Benchmark::Benchmark(QObject *parent) :
+    QObject(parent),
+    m_LayoutEngine("dot"),
+    m_EdgeBatching(false),
+    m_ViewSize(1024, 768),
+    m_Frames(40),
+    m_ComponentPacking(false),
+    m_LayoutPool(false),
+    m_MapFile(false),
+    m_DiscardContent(false),
+    m_NativeParsing(false),
+    m_BinaryContent(false)
+{
+}
+
+QString Benchmark::layoutEngine()
+{
+    return m_LayoutEngine;
+}
+
+void Benchmark::setLayoutEngine(QString layoutEngine)
+{
+    m_LayoutEngine = layoutEngine;
+}
+
+bool Benchmark::isEdgeBatching()
+{
+    return m_EdgeBatching;
+}
+
+void Benchmark::setEdgeBatching(bool edgeBatching)
+{
+    m_EdgeBatching = edgeBatching;
+}
+
+QSize Benchmark::viewSize()
+{
+    return m_ViewSize;
+}
+
+void Benchmark::setViewSize(QSize viewSize)
+{
+    m_ViewSize = viewSize;
+}
+
+int Benchmark::frames()
+{
+    return m_Frames;
+}
+
+void Benchmark::setFrames(int frames)
+{
+    m_Frames = qMax(4, frames);
+}
+
+/*! Lays out through a layout cache in this directory; empty (the default) lays out without one
+ */
+QString Benchmark::layoutCacheDirectory()
+{
+    return m_LayoutCacheDirectory;
+}
+
+void Benchmark::setLayoutCacheDirectory(QString directory)
+{
+    m_LayoutCacheDirectory = directory;
+}
+
+bool Benchmark::isComponentPacking()
+{
+    return m_ComponentPacking;
+}
+
+void Benchmark::setComponentPacking(bool componentPacking)
+{
+    m_ComponentPacking = componentPacking;
+}
+
+/*! Lays out in worker processes, through a QGraphVizLayoutPool, rather than in this process
+ */
+bool Benchmark::isLayoutPool()
+{
+    return m_LayoutPool;
+}
+
+void Benchmark::setLayoutPool(bool layoutPool)
+{
+    m_LayoutPool = layoutPool;
+}
+
+/*! Hands the scene the file name, so it memory maps the file, rather than reading it here; reading is then part of
+    parsing
+ */
+bool Benchmark::isMapFile()
+{
+    return m_MapFile;
+}
+
+void Benchmark::setMapFile(bool mapFile)
+{
+    m_MapFile = mapFile;
+}
+
+bool Benchmark::isDiscardContent()
+{
+    return m_DiscardContent;
+}
+
+void Benchmark::setDiscardContent(bool discardContent)
+{
+    m_DiscardContent = discardContent;
+}
+
+/*! Parses with the library's own DOT parser, rather than GraphViz's
+ */
+bool Benchmark::isNativeParsing()
+{
+    return m_NativeParsing;
+}
+
+void Benchmark::setNativeParsing(bool nativeParsing)
+{
+    m_NativeParsing = nativeParsing;
+}
+
+/*! Converts each graph to the binary form (see QGraphVizDotGraph::toBinary()) after reading it, and hands the scene
+    that instead; the conversion isn't timed.  Mapped files are handed over as they are.
+ */
+bool Benchmark::isBinaryContent()
+{
+    return m_BinaryContent;
+}
+
+void Benchmark::setBinaryContent(bool binaryContent)
+{
+    m_BinaryContent = binaryContent;
+}
+
+
+
+/*! Names of the values returned by run(), in order.  Times are wall clock milliseconds; -1 means the stage didn't run.
+    The node_bytes columns are the scene's estimate of its item memory per node (see QGraphVizScene::itemMemoryUsage()).
+ */
+QStringList Benchmark::columns()
+{
+    return QStringList() << "file" << "engine" << "nodes" << "edges"
+                         << "read_ms" << "parse_ms" << "layout_ms" << "items_ms"
+                         << "first_paint_ms" << "pan_zoom_ms" << "frames"
+                         << "export_ms" << "export_bytes" << "peak_rss_kb" << "components"
+                         << "node_bytes" << "node_bytes_unshared" << "status";
+}
+
+/*! Loads, lays out and renders one graph, timing each stage.  Peak RSS covers the whole process, so the caller should
+    run each graph in a fresh process if it wants per-graph figures.
+ */
+QStringList Benchmark::run(QString fileName)
+{
+    QElapsedTimer timer;
+    m_Error.clear();
+
+    qint64 readTime = -1, firstPaintTime = -1, panZoomTime = -1, exportTime = -1;
+    int nodes = 0, edges = 0, frames = 0, exportBytes = 0;
+    qint64 nodeBytes = -1, nodeBytesUnshared = -1;
+
+    QScopedPointer<QGraphVizLayoutCache> layoutCache;
+    if(!m_LayoutCacheDirectory.isEmpty()) {
+        layoutCache.reset(new QGraphVizLayoutCache(m_LayoutCacheDirectory));
+    }
+
+    QScopedPointer<QGraphVizLayoutPool> layoutPool;
+    if(m_LayoutPool) {
+        layoutPool.reset(new QGraphVizLayoutPool());
+    }
+
+    BenchmarkScene scene;
+    scene.setLayoutCache(layoutCache.data());
+    scene.setLayoutPool(layoutPool.data());
+    scene.setLayoutEngine(m_LayoutEngine);
+    scene.setEdgeBatching(m_EdgeBatching);
+    scene.setComponentPacking(m_ComponentPacking);
+    scene.setDiscardContent(m_DiscardContent);
+    scene.setNativeParsing(m_NativeParsing);
+    connect(&scene, SIGNAL(layoutFailed(QString)), this, SLOT(layoutFailed(QString)));
+
+    timer.start();
+    QFile file(fileName);
+    QByteArray content;
+    if(m_MapFile) {
+        readTime = 0;
+    } else if(file.open(QIODevice::ReadOnly)) {
+        content = file.readAll();
+        file.close();
+        readTime = timer.elapsed();
+    } else {
+        m_Error = file.errorString();
+    }
+
+    if(m_BinaryContent && !m_MapFile && m_Error.isEmpty()) {
+        QGraphVizDotGraph model;
+        if(!model.parse(content)) {
+            m_Error = QString("line %1: %2").arg(model.errorLine()).arg(model.errorString());
+        } else if((content = model.toBinary()).isEmpty()) {
+            m_Error = "graphs with subgraphs can't be converted to the binary form";
+        }
+    }
+
+    if(m_Error.isEmpty()) {
+        try {
+            if(m_MapFile) {
+                scene.setContentFile(fileName);
+            } else {
+                scene.setContent(content);
+                content.clear();
+            }
+        } catch(QString error) {
+            m_Error = error;
+        }
+    }
+
+    if(m_Error.isEmpty()) {
+        nodes = scene.nodeCount();
+        edges = scene.edgeCount();
+
+        QImage image(m_ViewSize, QImage::Format_ARGB32_Premultiplied);
+
+        // The whole graph at once, as the overview shows it
+        image.fill(0xffffffff);
+        timer.restart();
+        {
+            QPainter painter(&image);
+            painter.setRenderHint(QPainter::Antialiasing);
+            scene.render(&painter, QRectF(image.rect()), scene.sceneRect());
+        }
+        firstPaintTime = timer.elapsed();
+
+        // A scripted session through the view: zoom out to the overview, back in, pan corner to corner, and zoom in
+        QGraphVizView view(&scene);
+        view.setAttribute(Qt::WA_DontShowOnScreen);
+        view.resize(m_ViewSize);
+        view.show();
+        QApplication::processEvents();
+
+        const QRectF sceneRect = scene.sceneRect();
+        const int quarter = m_Frames / 4;
+
+        timer.restart();
+        for(frames = 0; frames < m_Frames; ++frames) {
+            if(frames < quarter) {
+                view.zoomOut();
+            } else if(frames < quarter * 2) {
+                view.zoomIn();
+            } else if(frames < quarter * 3) {
+                qreal progress = qreal(frames - (quarter * 2) + 1) / quarter;
+                view.centerOn(sceneRect.topLeft() + ((sceneRect.bottomRight() - sceneRect.topLeft()) * progress));
+            } else {
+                view.zoomIn();
+            }
+
+            view.render(&image);
+        }
+        panZoomTime = timer.elapsed();
+
+        timer.restart();
+        exportBytes = scene.exportContent().size();
+        exportTime = timer.elapsed();
+
+        // Item memory per node, with the styles and shapes shared and as if each item had its own
+        if(nodes > 0) {
+            nodeBytes = scene.itemMemoryUsage(true) / nodes;
+            nodeBytesUnshared = scene.itemMemoryUsage(false) / nodes;
+        }
+    }
+
+    QStringList row;
+    row << QFileInfo(fileName).fileName()
+        << m_LayoutEngine
+        << QString::number(nodes)
+        << QString::number(edges)
+        << QString::number(readTime)
+        << QString::number(scene.stageTime(QGraphVizScene::Stage_Parse))
+        << QString::number(scene.stageTime(QGraphVizScene::Stage_Layout))
+        << QString::number(scene.stageTime(QGraphVizScene::Stage_Render))
+        << QString::number(firstPaintTime)
+        << QString::number(panZoomTime)
+        << QString::number(frames)
+        << QString::number(exportTime)
+        << QString::number(exportBytes)
+        << QString::number(peakResidentKilobytes())
+        << QString::number(scene.componentTimes().count())
+        << QString::number(nodeBytes)
+        << QString::number(nodeBytesUnshared)
+        << (m_Error.isEmpty() ? QString("ok") : QString("failed: %1").arg(m_Error.simplified()));
+
+    return row;
+}
+
+/*! Names of the values returned by validate(), in order
+ */
+QStringList Benchmark::validationColumns()
+{
+    return QStringList() << "file" << "nodes" << "edges" << "native_parse_ms" << "graphviz_parse_ms"
+                         << "native_model_kb" << "status";
+}
+
+/*! Parses one graph with both the native parser and GraphViz, and checks that they agree; the status is "ok" if they
+    do, and describes the first difference if they don't.
+ */
+QStringList Benchmark::validate(QString fileName)
+{
+    qint64 nativeTime = -1, graphvizTime = -1;
+    QGraphVizDotGraph model;
+    QString status;
+
+    QFile file(fileName);
+    if(file.open(QIODevice::ReadOnly)) {
+        QString difference;
+        QByteArray content;
+        QGraphVizDecompressor decompressor(&file);
+        if(QGraphVizDecompressor::isCompressed(file.peek(4)) && decompressor.open(QIODevice::ReadOnly)) {
+            content = decompressor.readAll();
+        } else {
+            content = file.readAll();
+        }
+        if(QGraphVizScene::validateNativeParsing(content, difference, &nativeTime, &graphvizTime, &model)) {
+            status = "ok";
+        } else {
+            status = QString("mismatch: %1").arg(difference.simplified());
+        }
+    } else {
+        status = QString("failed: %1").arg(file.errorString());
+    }
+
+    QStringList row;
+    row << QFileInfo(fileName).fileName()
+        << QString::number(model.nodeCount())
+        << QString::number(model.edgeCount())
+        << QString::number(nativeTime)
+        << QString::number(graphvizTime)
+        << QString::number(model.memoryUsage() / 1024)
+        << status;
+
+    return row;
+}
+
+void Benchmark::layoutFailed(QString message)
+{
+    m_Error = message;
+}
+
+
+
+qint64 Benchmark::peakResidentKilobytes()
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if(!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return -1;
+    }
+    return counters.PeakWorkingSetSize / 1024;
+#elif defined(Q_OS_UNIX)
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage)) {
+        return -1;
+    }
+#  if defined(Q_OS_MAC)
+    return usage.ru_maxrss / 1024;  // Bytes on Mac OS X, kilobytes elsewhere
+#  else
+    return usage.ru_maxrss;
+#  endif
+#else
+    return -1;
+#endif
+}
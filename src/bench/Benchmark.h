@@ -0,0 +1,101 @@
+/*!
+   \file
+   \author Dane Gardner <dane.gardner@gmail.com>
+   \version
+
+   \section LICENSE
+   This file is part of the Parallel Tools GUI Framework (PTGF)
+   Copyright (C) 2010-2011 Argo Navis Technologies, LLC
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+   \section DESCRIPTION
+
+ */
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QtCore>
+#include <QtGui>
+
+class Benchmark : public QObject
+{
+    Q_OBJECT
+public:
+    explicit Benchmark(QObject *parent = 0);
+
+    QString layoutEngine();
+    void setLayoutEngine(QString layoutEngine);
+
+    bool isEdgeBatching();
+    void setEdgeBatching(bool edgeBatching = true);
+
+    QSize viewSize();
+    void setViewSize(QSize viewSize);
+
+    int frames();
+    void setFrames(int frames);
+
+    QString layoutCacheDirectory();
+    void setLayoutCacheDirectory(QString directory);
+
+    bool isComponentPacking();
+    void setComponentPacking(bool componentPacking = true);
+
+    bool isLayoutPool();
+    void setLayoutPool(bool layoutPool = true);
+
+    bool isMapFile();
+    void setMapFile(bool mapFile = true);
+
+    bool isDiscardContent();
+    void setDiscardContent(bool discardContent = true);
+
+    bool isNativeParsing();
+    void setNativeParsing(bool nativeParsing = true);
+
+    bool isBinaryContent();
+    void setBinaryContent(bool binaryContent = true);
+
+    static QStringList columns();
+    QStringList run(QString fileName);
+
+    static QStringList validationColumns();
+    static QStringList validate(QString fileName);
+
+    static qint64 peakResidentKilobytes();
+
+protected slots:
+    void layoutFailed(QString message);
+
+private:
+    QString m_LayoutEngine;
+    bool m_EdgeBatching;
+    QSize m_ViewSize;
+    int m_Frames;
+    QString m_LayoutCacheDirectory;
+    bool m_ComponentPacking;
+    bool m_LayoutPool;
+    bool m_MapFile;
+    bool m_DiscardContent;
+    bool m_NativeParsing;
+    bool m_BinaryContent;
+
+    QString m_Error;
+
+};
+
+#endif // BENCHMARK_H
@@ -0,0 +1,216 @@
+/*!
+   \file
+   \author Dane Gardner <dane.gardner@gmail.com>
+   \version
+
+   \section LICENSE
+   This file is part of the Parallel Tools GUI Framework (PTGF)
+   Copyright (C) 2010-2011 Argo Navis Technologies, LLC
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+   \section DESCRIPTION
+
+ */
+
+#include <QtCore>
+#include <QtGui>
+
+#include "Benchmark.h"
+
+/*! \note Runs headless on the offscreen platform plugin where Qt provides one (QPA builds); an X11 build of Qt4 still
+          needs a display, e.g. under xvfb-run.  No window is ever shown on screen either way. */
+
+static void usage()
+{
+    QTextStream(stderr)
+            << "Usage: " << QFileInfo(QCoreApplication::applicationFilePath()).fileName()
+            << " [options] [file|directory ...]" << endl
+            << "Lays out and renders each graph, and writes the stage timings as CSV to standard output." << endl
+            << "Defaults to the graphs in " << BENCHMARK_DATA_PATH << endl << endl
+            << "  --engine <name>   GraphViz layout engine (default dot)" << endl
+            << "  --edge-batching   draw edges through the batched edge layers" << endl
+            << "  --frames <count>  frames in the scripted pan/zoom sequence (default 40)" << endl
+            << "  --size <w>x<h>    size of the rendered view (default 1024x768)" << endl
+            << "  --layout-cache <dir>  lay out through a layout cache in this directory" << endl
+            << "  --pack-components lay out each connected component separately, and pack them" << endl
+            << "  --layout-pool     lay out in worker processes instead of in process" << endl
+            << "  --map-file        hand the scene the file name, to memory map, instead of the content" << endl
+            << "  --discard-content let the scene drop the content once the graph is laid out" << endl
+            << "  --native-parser   parse with the library's own DOT parser instead of GraphViz's" << endl
+            << "  --binary          convert each graph to the binary form first, and load that" << endl
+            << "  --validate        parse each graph with both parsers and compare them, instead of benchmarking;" << endl
+            << "                    exits with 1 if any of them differ" << endl
+            << "  --timeout <sec>   give up on a graph after this long (default 600)" << endl
+            << "  --single          benchmark the one given file in this process, without a header" << endl;
+}
+
+static QString csvRow(const QStringList &values)
+{
+    QStringList fields;
+    foreach(QString value, values) {
+        if(value.contains(',') || value.contains('"')) {
+            value = QString("\"%1\"").arg(value.replace("\"", "\"\""));
+        }
+        fields << value;
+    }
+    return fields.join(",");
+}
+
+int main(int argc, char *argv[])
+{
+    if(qgetenv("QT_QPA_PLATFORM").isEmpty()) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    QApplication a(argc, argv);
+    QTextStream out(stdout);
+
+    Benchmark benchmark;
+    bool single = false;
+    bool validate = false;
+    int timeout = 600;
+    QStringList forwarded;
+    QStringList paths;
+
+    QStringList arguments = QCoreApplication::arguments();
+    arguments.removeFirst();
+    while(!arguments.isEmpty()) {
+        QString argument = arguments.takeFirst();
+
+        if(argument == "--single") {
+            single = true;
+        } else if(argument == "--edge-batching") {
+            benchmark.setEdgeBatching(true);
+            forwarded << argument;
+        } else if(argument == "--layout-pool") {
+            benchmark.setLayoutPool(true);
+            forwarded << argument;
+        } else if(argument == "--map-file") {
+            benchmark.setMapFile(true);
+            forwarded << argument;
+        } else if(argument == "--discard-content") {
+            benchmark.setDiscardContent(true);
+            forwarded << argument;
+        } else if(argument == "--native-parser") {
+            benchmark.setNativeParsing(true);
+            forwarded << argument;
+        } else if(argument == "--binary") {
+            benchmark.setBinaryContent(true);
+            forwarded << argument;
+        } else if(argument == "--validate") {
+            validate = true;
+        } else if(argument == "--pack-components") {
+            benchmark.setComponentPacking(true);
+            forwarded << argument;
+        } else if(argument == "--engine" && !arguments.isEmpty()) {
+            benchmark.setLayoutEngine(arguments.first());
+            forwarded << argument << arguments.takeFirst();
+        } else if(argument == "--frames" && !arguments.isEmpty()) {
+            benchmark.setFrames(arguments.first().toInt());
+            forwarded << argument << arguments.takeFirst();
+        } else if(argument == "--size" && !arguments.isEmpty()) {
+            QStringList size = arguments.first().split('x');
+            if(size.count() == 2) {
+                benchmark.setViewSize(QSize(size.at(0).toInt(), size.at(1).toInt()));
+            }
+            forwarded << argument << arguments.takeFirst();
+        } else if(argument == "--layout-cache" && !arguments.isEmpty()) {
+            benchmark.setLayoutCacheDirectory(arguments.first());
+            forwarded << argument << arguments.takeFirst();
+        } else if(argument == "--timeout" && !arguments.isEmpty()) {
+            timeout = arguments.takeFirst().toInt();
+        } else if(argument.startsWith("-")) {
+            usage();
+            return (argument == "--help" || argument == "-h") ? 0 : 1;
+        } else {
+            paths << argument;
+        }
+    }
+
+    if(paths.isEmpty()) {
+        paths << QString(BENCHMARK_DATA_PATH);
+    }
+
+    QStringList files;
+    foreach(QString path, paths) {
+        QFileInfo info(path);
+        if(info.isDir()) {
+            QDir dir(path);
+            foreach(QString fileName, dir.entryList(QStringList() << "*.dot" << "*.gv" << "*.gz" << "*.zst" << "*.qgvb",
+                                                     QDir::Files, QDir::Name)) {
+                files << dir.absoluteFilePath(fileName);
+            }
+        } else {
+            files << path;
+        }
+    }
+
+    // Validation needs no display and uses little memory, so it all runs in this process
+    if(validate) {
+        bool matches = true;
+        out << csvRow(Benchmark::validationColumns()) << endl;
+        foreach(QString fileName, files) {
+            const QStringList row = Benchmark::validate(fileName);
+            matches = matches && (row.last() == "ok");
+            out << csvRow(row) << endl;
+        }
+        return matches ? 0 : 1;
+    }
+
+    if(single) {
+        if(files.count() != 1) {
+            usage();
+            return 1;
+        }
+        out << csvRow(benchmark.run(files.first())) << endl;
+        return 0;
+    }
+
+    out << csvRow(Benchmark::columns()) << endl;
+
+    // Each graph gets a process of its own, so the peak RSS is its own and a crash only loses the one row
+    foreach(QString fileName, files) {
+        QProcess process;
+        process.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+        process.start(QCoreApplication::applicationFilePath(), QStringList() << forwarded << "--single" << fileName);
+
+        QString row;
+        if(!process.waitForFinished(timeout * 1000)) {
+            process.kill();
+            process.waitForFinished();
+            row = QString("timed out after %1s").arg(timeout);
+        } else if(process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0) {
+            row = QString("crashed (exit code %1)").arg(process.exitCode());
+        } else {
+            row = QString(process.readAllStandardOutput()).trimmed();
+        }
+
+        if(!row.contains(',')) {
+            // Fill in the columns the child never got to report
+            QStringList values;
+            values << QFileInfo(fileName).fileName() << benchmark.layoutEngine();
+            while(values.count() < Benchmark::columns().count() - 1) {
+                values << "-1";
+            }
+            values << QString("failed: %1").arg(row);
+            row = csvRow(values);
+        }
+
+        out << row << endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,366 @@
+/*!
+   \file
+   \author Dane Gardner <dane.gardner@gmail.com>
+   \version
+
+   \section LICENSE
+   This file is part of the Parallel Tools GUI Framework (PTGF)
+   Copyright (C) 2010-2011 Argo Navis Technologies, LLC
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+   \section DESCRIPTION
+
+ */
+
+#include "GraphGenerator.h"
+
+/*! \note The output mimics the STAT call graphs in test/: record shaped nodes with a fill color, rank range labels on
+          the edges, and a pos attribute on every node.  Unless asked for real positions, pos is "0,0" just like STAT
+          writes it. */
+
+static const qreal Pi = 3.14159265358979323846264338327950288419717;
+
+// Spacing, in points, of the positions written with --positions
+#define POSITION_SPACING_X 180.0
+#define POSITION_SPACING_Y 72.0
+
+static const char *FunctionPrefixes[] = {
+    "mpi_", "PMPI_", "MPID_", "mod_comm_mp_", "tp_core_mp_", "dyn_comp_mp_", "stepon_mp_", "phys_", "smpi_", "__libc_"
+};
+static const char *FunctionStems[] = {
+    "wait", "waitall", "recv", "send", "barrier", "allreduce", "poll_cq", "run", "step", "compute",
+    "exchange", "progress", "spin_lock", "device_check", "ga_get4d_r8", "trac2d", "xtpv", "ytp"
+};
+
+
+
+GraphGenerator::GraphGenerator() :
+    m_Topology(Topology_CallTree),
+    m_NodeCount(1000),
+    m_Seed(1),
+    m_State(1),
+    m_Dimensions(3),
+    m_Degree(2.0),
+    m_Positions(false)
+{
+}
+
+GraphGenerator::Topology GraphGenerator::topology()
+{
+    return m_Topology;
+}
+
+void GraphGenerator::setTopology(Topology topology)
+{
+    m_Topology = topology;
+}
+
+bool GraphGenerator::topologyFromName(QString name, Topology &topology)
+{
+    name = name.toLower();
+    if(name == "calltree") {
+        topology = Topology_CallTree;
+    } else if(name == "ring") {
+        topology = Topology_Ring;
+    } else if(name == "torus") {
+        topology = Topology_Torus;
+    } else if(name == "dag") {
+        topology = Topology_Dag;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+int GraphGenerator::nodeCount()
+{
+    return m_NodeCount;
+}
+
+void GraphGenerator::setNodeCount(int nodeCount)
+{
+    m_NodeCount = qMax(1, nodeCount);
+}
+
+quint32 GraphGenerator::seed()
+{
+    return m_Seed;
+}
+
+void GraphGenerator::setSeed(quint32 seed)
+{
+    m_Seed = seed;
+}
+
+/*! Dimensions of the torus; 2 or 3
+ */
+int GraphGenerator::dimensions()
+{
+    return m_Dimensions;
+}
+
+void GraphGenerator::setDimensions(int dimensions)
+{
+    m_Dimensions = qBound(2, dimensions, 3);
+}
+
+/*! Average out degree of the random DAG
+ */
+qreal GraphGenerator::degree()
+{
+    return m_Degree;
+}
+
+void GraphGenerator::setDegree(qreal degree)
+{
+    m_Degree = qMax(qreal(0.0), degree);
+}
+
+/*! Writes real coordinates in the pos attributes, instead of the "0,0" placeholder
+ */
+bool GraphGenerator::hasPositions()
+{
+    return m_Positions;
+}
+
+void GraphGenerator::setPositions(bool positions)
+{
+    m_Positions = positions;
+}
+
+
+
+void GraphGenerator::generate(QTextStream &out)
+{
+    m_State = m_Seed ? m_Seed : 1;
+
+    out << "digraph G {\n";
+    out << "\tnode [shape=record,style=filled,labeljust=c,height=0.2];\n";
+
+    switch(m_Topology) {
+    case Topology_CallTree:
+        generateCallTree(out);
+        break;
+    case Topology_Ring:
+        generateRing(out);
+        break;
+    case Topology_Torus:
+        generateTorus(out);
+        break;
+    case Topology_Dag:
+        generateDag(out);
+        break;
+    }
+
+    out << "}\n";
+    out.flush();
+}
+
+/*! A STAT style merged call tree.  Most frames have a single callee, some fan out a little, and a few (the MPI
+    progress engine, say) fan out a lot; the ranks are split among the callees on the way down.
+ */
+void GraphGenerator::generateCallTree(QTextStream &out)
+{
+    const int ranks = qMax(4, m_NodeCount / 4);
+
+    QVector<int> depths(m_NodeCount);
+    QVector<int> firstRanks(m_NodeCount);
+    QVector<int> lastRanks(m_NodeCount);
+    QVector<int> columns(m_NodeCount);
+    QVector<int> nextColumn;
+
+    depths[0] = 0;
+    firstRanks[0] = 0;
+    lastRanks[0] = ranks - 1;
+    columns[0] = 0;
+    nextColumn.append(1);
+    writeNode(out, 0, "/", "#AAAAAA", 0.0, 0.0);
+
+    int created = 1;
+    for(int parent = 0; parent < created && created < m_NodeCount; ++parent) {
+        int children;
+        int roll = random(100);
+        if(roll < 60) {
+            children = 1;
+        } else if(roll < 85) {
+            children = 2 + random(2);
+        } else {
+            children = 4 + random(12);
+        }
+
+        // Every frame has a callee, so the tree keeps growing until it's big enough
+        children = qMin(children, m_NodeCount - created);
+
+        const int parentRanks = lastRanks.at(parent) - firstRanks.at(parent) + 1;
+        int rank = firstRanks.at(parent);
+
+        for(int i = 0; i < children; ++i) {
+            const int child = created++;
+            const int depth = depths.at(parent) + 1;
+
+            // Split the parent's ranks among the children, but let every child have at least one
+            int share = qMax(1, parentRanks / children);
+            depths[child] = depth;
+            firstRanks[child] = qMin(rank, lastRanks.at(parent));
+            lastRanks[child] = (i == children - 1) ? lastRanks.at(parent) : qMin(rank + share - 1, lastRanks.at(parent));
+            rank += share;
+
+            if(nextColumn.count() <= depth) {
+                nextColumn.append(0);
+            }
+            columns[child] = nextColumn[depth]++;
+
+            writeNode(out, child, functionName(child), depthColor(depth),
+                      columns.at(child) * POSITION_SPACING_X, -depth * POSITION_SPACING_Y);
+            writeEdge(out, parent, child, QString("[%1-%2]").arg(firstRanks.at(child)).arg(lastRanks.at(child)));
+        }
+    }
+}
+
+/*! One node per rank, each sending to the next; like the communication pattern of mpi_ringtopo
+ */
+void GraphGenerator::generateRing(QTextStream &out)
+{
+    const qreal radius = (m_NodeCount * POSITION_SPACING_X) / (2.0 * Pi);
+
+    for(int i = 0; i < m_NodeCount; ++i) {
+        const qreal angle = (2.0 * Pi * i) / m_NodeCount;
+        writeNode(out, i, QString("rank %1").arg(i), depthColor(i % 16),
+                  radius * qCos(angle), radius * qSin(angle));
+    }
+
+    for(int i = 0; i < m_NodeCount && m_NodeCount > 1; ++i) {
+        writeEdge(out, i, (i + 1) % m_NodeCount, QString("[%1]").arg(i));
+    }
+}
+
+/*! One node per rank on a 2D or 3D torus, each connected to its neighbour in every dimension (with wrap around).  The
+    torus is as close to square (or cubic) as the node count allows; any ranks left over are left out.
+ */
+void GraphGenerator::generateTorus(QTextStream &out)
+{
+    int size[3];
+    size[0] = qMax(1, (int)qFloor(qPow(m_NodeCount, 1.0 / m_Dimensions) + 0.5));
+    size[1] = size[0];
+    size[2] = (m_Dimensions == 3) ? qMax(1, m_NodeCount / (size[0] * size[1])) : 1;
+    if(m_Dimensions == 2) {
+        size[1] = qMax(1, m_NodeCount / size[0]);
+    }
+
+    const int count = size[0] * size[1] * size[2];
+
+    // Each plane of a 3D torus is laid out beside the previous one
+    for(int i = 0; i < count; ++i) {
+        const int x = i % size[0];
+        const int y = (i / size[0]) % size[1];
+        const int z = i / (size[0] * size[1]);
+        writeNode(out, i, QString("rank %1 (%2,%3,%4)").arg(i).arg(x).arg(y).arg(z), depthColor(z),
+                  (x + (z * (size[0] + 1))) * POSITION_SPACING_X, -y * POSITION_SPACING_Y);
+    }
+
+    for(int i = 0; i < count; ++i) {
+        const int x = i % size[0];
+        const int y = (i / size[0]) % size[1];
+        const int z = i / (size[0] * size[1]);
+        const int plane = z * size[0] * size[1];
+
+        if(size[0] > 1) {
+            writeEdge(out, i, plane + (y * size[0]) + ((x + 1) % size[0]), QString("[%1]").arg(i));
+        }
+        if(size[1] > 1) {
+            writeEdge(out, i, plane + (((y + 1) % size[1]) * size[0]) + x, QString("[%1]").arg(i));
+        }
+        if(size[2] > 1) {
+            writeEdge(out, i, (((z + 1) % size[2]) * size[0] * size[1]) + (y * size[0]) + x, QString("[%1]").arg(i));
+        }
+    }
+}
+
+/*! A random DAG: edges only ever point from a node to a later one, and mostly to a nearby one, so the graph has depth
+    rather than collapsing into a few wide ranks.
+ */
+void GraphGenerator::generateDag(QTextStream &out)
+{
+    const int width = qMax(1, (int)qSqrt(m_NodeCount));
+
+    for(int i = 0; i < m_NodeCount; ++i) {
+        writeNode(out, i, functionName(i), depthColor(i / width),
+                  (i % width) * POSITION_SPACING_X, -(i / width) * POSITION_SPACING_Y);
+    }
+
+    const qint64 edges = qRound64(m_Degree * m_NodeCount);
+    for(qint64 e = 0; e < edges && m_NodeCount > 1; ++e) {
+        const int tail = random(m_NodeCount - 1);
+        const int reach = qMin(m_NodeCount - tail - 1, (random(10) == 0) ? m_NodeCount : (width * 2));
+        const int head = tail + 1 + random(reach);
+        writeEdge(out, tail, head, QString("[%1-%2]").arg(tail).arg(head));
+    }
+}
+
+
+
+void GraphGenerator::writeNode(QTextStream &out, qint64 id, const QString &label, const QString &fillColor, qreal x, qreal y)
+{
+    out << '\t' << id << " [pos=\"";
+    if(m_Positions) {
+        out << QString::number(x, 'f', 1) << ',' << QString::number(y, 'f', 1);
+    } else {
+        out << "0,0";
+    }
+    out << "\", label=\"" << label << "\", fillcolor=\"" << fillColor << "\",fontcolor=\"#000000\"];\n";
+}
+
+void GraphGenerator::writeEdge(QTextStream &out, qint64 tail, qint64 head, const QString &label)
+{
+    out << '\t' << tail << " -> " << head << " [label=\"" << label << "\"]\n";
+}
+
+/*! Xorshift; the same seed gives the same graph on every platform, which qrand() doesn't promise
+ */
+quint32 GraphGenerator::random()
+{
+    m_State ^= m_State << 13;
+    m_State ^= m_State >> 17;
+    m_State ^= m_State << 5;
+    return m_State;
+}
+
+int GraphGenerator::random(int bound)
+{
+    if(bound <= 0) {
+        return 0;
+    }
+    return random() % bound;
+}
+
+QString GraphGenerator::functionName(int index)
+{
+    const int prefixes = sizeof(FunctionPrefixes) / sizeof(FunctionPrefixes[0]);
+    const int stems = sizeof(FunctionStems) / sizeof(FunctionStems[0]);
+
+    return QString("%1%2_%3").arg(FunctionPrefixes[random(prefixes)]).arg(FunctionStems[random(stems)]).arg(index);
+}
+
+/*! STAT shades the call tree from yellow towards white with depth; this cycles through the same ramp
+ */
+QString GraphGenerator::depthColor(int depth)
+{
+    const int step = depth % 16;
+    return QString("#%1%2%3")
+            .arg(0xfe - step, 2, 16, QChar('0'))
+            .arg(0xfe - (2 * step), 2, 16, QChar('0'))
+            .arg(0x15 + (step * 0x0e), 2, 16, QChar('0'));
+}
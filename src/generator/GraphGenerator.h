@@ -0,0 +1,86 @@
+/*!
+   \file
+   \author Dane Gardner <dane.gardner@gmail.com>
+   \version
+
+   \section LICENSE
+   This file is part of the Parallel Tools GUI Framework (PTGF)
+   Copyright (C) 2010-2011 Argo Navis Technologies, LLC
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+   \section DESCRIPTION
+
+ */
+
+#ifndef GRAPHGENERATOR_H
+#define GRAPHGENERATOR_H
+
+#include <QtCore>
+
+class GraphGenerator
+{
+public:
+    enum Topology { Topology_CallTree, Topology_Ring, Topology_Torus, Topology_Dag };
+
+    GraphGenerator();
+
+    Topology topology();
+    void setTopology(Topology topology);
+    static bool topologyFromName(QString name, Topology &topology);
+
+    int nodeCount();
+    void setNodeCount(int nodeCount);
+
+    quint32 seed();
+    void setSeed(quint32 seed);
+
+    int dimensions();
+    void setDimensions(int dimensions);
+
+    qreal degree();
+    void setDegree(qreal degree);
+
+    bool hasPositions();
+    void setPositions(bool positions = true);
+
+    void generate(QTextStream &out);
+
+protected:
+    void generateCallTree(QTextStream &out);
+    void generateRing(QTextStream &out);
+    void generateTorus(QTextStream &out);
+    void generateDag(QTextStream &out);
+
+    void writeNode(QTextStream &out, qint64 id, const QString &label, const QString &fillColor, qreal x, qreal y);
+    void writeEdge(QTextStream &out, qint64 tail, qint64 head, const QString &label);
+
+    quint32 random();
+    int random(int bound);
+    QString functionName(int index);
+    static QString depthColor(int depth);
+
+private:
+    Topology m_Topology;
+    int m_NodeCount;
+    quint32 m_Seed;
+    quint32 m_State;
+    int m_Dimensions;
+    qreal m_Degree;
+    bool m_Positions;
+
+};
+
+#endif // GRAPHGENERATOR_H
@@ -0,0 +1,120 @@
+/*!
+   \file
+   \author Dane Gardner <dane.gardner@gmail.com>
+   \version
+
+   \section LICENSE
+   This file is part of the Parallel Tools GUI Framework (PTGF)
+   Copyright (C) 2010-2011 Argo Navis Technologies, LLC
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+   \section DESCRIPTION
+
+ */
+
+#include <QtCore>
+
+#include "GraphGenerator.h"
+
+static void usage()
+{
+    QTextStream(stderr)
+            << "Usage: " << QFileInfo(QCoreApplication::applicationFilePath()).fileName() << " [options]" << endl
+            << "Writes a synthetic graph, in the style of the STAT graphs in test/, as DOT." << endl << endl
+            << "  --type <name>       calltree, ring, torus or dag (default calltree)" << endl
+            << "  --nodes <count>     number of nodes (default 1000); accepts k and M suffixes" << endl
+            << "  --seed <number>     random seed (default 1)" << endl
+            << "  --dimensions <2|3>  torus dimensions (default 3)" << endl
+            << "  --degree <number>   average out degree of the dag (default 2)" << endl
+            << "  --positions         write real coordinates in pos, instead of 0,0" << endl
+            << "  --output <file>     write to a file instead of standard output" << endl;
+}
+
+static int parseCount(QString value, bool *ok)
+{
+    int multiplier = 1;
+    if(value.endsWith('k', Qt::CaseInsensitive)) {
+        multiplier = 1000;
+        value.chop(1);
+    } else if(value.endsWith('M')) {
+        multiplier = 1000000;
+        value.chop(1);
+    }
+    return value.toInt(ok) * multiplier;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    GraphGenerator generator;
+    QString output;
+
+    QStringList arguments = QCoreApplication::arguments();
+    arguments.removeFirst();
+    while(!arguments.isEmpty()) {
+        QString argument = arguments.takeFirst();
+        bool ok = true;
+
+        if(argument == "--positions") {
+            generator.setPositions(true);
+        } else if(argument == "--help" || argument == "-h") {
+            usage();
+            return 0;
+        } else if(arguments.isEmpty()) {
+            ok = false;
+        } else if(argument == "--type") {
+            GraphGenerator::Topology topology = generator.topology();
+            ok = GraphGenerator::topologyFromName(arguments.takeFirst(), topology);
+            if(ok) {
+                generator.setTopology(topology);
+            }
+        } else if(argument == "--nodes") {
+            generator.setNodeCount(parseCount(arguments.takeFirst(), &ok));
+        } else if(argument == "--seed") {
+            generator.setSeed(arguments.takeFirst().toUInt(&ok));
+        } else if(argument == "--dimensions") {
+            generator.setDimensions(arguments.takeFirst().toInt(&ok));
+        } else if(argument == "--degree") {
+            generator.setDegree(arguments.takeFirst().toDouble(&ok));
+        } else if(argument == "--output") {
+            output = arguments.takeFirst();
+        } else {
+            ok = false;
+        }
+
+        if(!ok) {
+            usage();
+            return 1;
+        }
+    }
+
+    QFile file;
+    if(output.isEmpty()) {
+        file.open(stdout, QIODevice::WriteOnly);
+    } else {
+        file.setFileName(output);
+        if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            QTextStream(stderr) << output << ": " << file.errorString() << endl;
+            return 1;
+        }
+    }
+
+    QTextStream out(&file);
+    generator.generate(out);
+
+    return 0;
+}
@@ -0,0 +1,280 @@
+/*!
+   \file
+   \author Dane Gardner <dane.gardner@gmail.com>
+   \version
+
+   \section LICENSE
+   This file is part of the Parallel Tools GUI Framework (PTGF)
+   Copyright (C) 2010-2011 Argo Navis Technologies, LLC
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+   \section DESCRIPTION
+
+ */
+
+
+#include "QGraphVizAttributes.h"
+
+#include <graphviz/graph.h>
+
+static const char *Names[QGraphVizAttributes::Name_Count] = {
+    "color", "fillcolor", "fontcolor", "fontname", "fontsize", "label", "penwidth", "shape", "style"
+};
+
+QGraphVizAttributes::QGraphVizAttributes(QObject *parent) :
+    QObject(parent),
+    m_Graph(NULL)
+{
+    invalidate();
+}
+
+graph_t *QGraphVizAttributes::graph()
+{
+    return m_Graph;
+}
+
+void QGraphVizAttributes::setGraph(graph_t *graph)
+{
+    if(graph == m_Graph) {
+        return;
+    }
+
+    m_Graph = graph;
+    invalidate();
+}
+
+/*! Forgets the symbols resolved so far; attributes declared since then, or a new graph that happens to be at the same
+    address as the old one, are picked up.  The interned values are kept, as they don't depend on the graph.
+ */
+void QGraphVizAttributes::invalidate()
+{
+    for(int kind = 0; kind < Kind_Count; ++kind) {
+        for(int name = 0; name < Name_Count; ++name) {
+            m_Symbols[kind][name] = -2;
+        }
+    }
+}
+
+int QGraphVizAttributes::symbol(Kind kind, Name name)
+{
+    int &symbol = m_Symbols[kind][name];
+    if(symbol == -2) {
+        symbol = this->symbol(kind, Names[name]);
+    }
+    return symbol;
+}
+
+/*! The symbol for any attribute, through GraphViz's own dictionary of them; -1 if the graph doesn't have it
+ */
+int QGraphVizAttributes::symbol(Kind kind, const char *name)
+{
+    void *object = prototype(kind);
+    if(!object) {
+        return -1;
+    }
+
+    Agsym_t *symbol = agfindattr(object, const_cast<char*>(name));
+    return symbol ? symbol->index : -1;
+}
+
+const char *QGraphVizAttributes::name(Name name)
+{
+    return Names[name];
+}
+
+/*! The value as GraphViz has it, defaults included; NULL if the graph doesn't have the attribute at all.  The object is
+    a graph_t, node_t or edge_t, of the kind the symbol is for.
+ */
+const char *QGraphVizAttributes::value(void *object, int symbol)
+{
+    if(!object || symbol < 0) {
+        return NULL;
+    }
+
+    return agxget(object, symbol);
+}
+
+QString QGraphVizAttributes::string(void *object, int symbol)
+{
+    return QString::fromLocal8Bit(value(object, symbol));
+}
+
+double QGraphVizAttributes::number(void *object, int symbol, double defaultValue)
+{
+    return number(value(object, symbol), defaultValue);
+}
+
+double QGraphVizAttributes::number(const char *value, double defaultValue)
+{
+    if(!value || !*value) {
+        return defaultValue;
+    }
+
+    Value &entry = intern(value);
+    if(!entry.numberParsed) {
+        entry.number = entry.text.toDouble(&entry.isNumber);
+        entry.numberParsed = true;
+    }
+
+    return entry.isNumber ? entry.number : defaultValue;
+}
+
+QColor QGraphVizAttributes::color(void *object, int symbol, const QColor &defaultColor)
+{
+    return color(value(object, symbol), defaultColor);
+}
+
+/*! Any GraphViz color; #rrggbb, #rrggbbaa, "h,s,v", or a name, optionally with its scheme (/x11/red).  Only the first
+    color of a list is used.
+ */
+QColor QGraphVizAttributes::color(const char *value, const QColor &defaultColor)
+{
+    if(!value || !*value) {
+        return defaultColor;
+    }
+
+    Value &entry = intern(value);
+    if(!entry.colorParsed) {
+        entry.color = parseColor(entry.text);
+        entry.colorParsed = true;
+    }
+
+    return entry.color.isValid() ? entry.color : defaultColor;
+}
+
+/*! How many distinct values have been interned
+ */
+int QGraphVizAttributes::valueCount()
+{
+    return m_Values.count();
+}
+
+/*! The entry for the value, added the first time it's seen; FNV-1a, with open addressing
+ */
+QGraphVizAttributes::Value &QGraphVizAttributes::intern(const char *value)
+{
+    uint hash = 2166136261u;
+    int length = 0;
+    for(const char *c = value; *c; ++c, ++length) {
+        hash = (hash ^ (uchar)*c) * 16777619u;
+    }
+
+    if(m_Buckets.count() < 2 * (m_Values.count() + 1)) {
+        const int size = qMax(256, m_Buckets.count() * 2);
+        m_Buckets.fill(-1, size);
+        for(int i = 0; i < m_Values.count(); ++i) {
+            int bucket = m_Values.at(i).hash & (size - 1);
+            while(m_Buckets.at(bucket) >= 0) {
+                bucket = (bucket + 1) & (size - 1);
+            }
+            m_Buckets[bucket] = i;
+        }
+    }
+
+    const int mask = m_Buckets.count() - 1;
+    int bucket = hash & mask;
+    for(; m_Buckets.at(bucket) >= 0; bucket = (bucket + 1) & mask) {
+        Value &entry = m_Values[m_Buckets.at(bucket)];
+        if(entry.hash == hash && entry.text.size() == length && !qstrcmp(entry.text.constData(), value)) {
+            return entry;
+        }
+    }
+
+    Value entry;
+    entry.hash = hash;
+    entry.text = QByteArray(value, length);
+    entry.colorParsed = false;
+    entry.numberParsed = false;
+    entry.isNumber = false;
+    entry.number = 0.0;
+
+    m_Buckets[bucket] = m_Values.count();
+    m_Values.append(entry);
+    return m_Values.last();
+}
+
+/*! The object that carries the declarations, and defaults, for the kind
+ */
+void *QGraphVizAttributes::prototype(Kind kind)
+{
+    if(!m_Graph) {
+        return NULL;
+    }
+
+    switch(kind) {
+    case Kind_Graph:
+        return m_Graph;
+    case Kind_Node:
+        return agprotonode(m_Graph);
+    case Kind_Edge:
+        return agprotoedge(m_Graph);
+    default:
+        return NULL;
+    }
+}
+
+QColor QGraphVizAttributes::parseColor(const QByteArray &text)
+{
+    QByteArray color = text.trimmed();
+
+    // Lists of colors, with optional weights, for gradients and the like; red;0.3:blue
+    const int separator = color.indexOf(':');
+    if(separator >= 0) {
+        color.truncate(separator);
+    }
+    const int weight = color.indexOf(';');
+    if(weight >= 0) {
+        color.truncate(weight);
+    }
+
+    // #rrggbbaa; Qt only takes the alpha at the front
+    if(color.startsWith('#') && color.size() == 9) {
+        bool ok = false;
+        const uint rgba = color.mid(1).toUInt(&ok, 16);
+        if(!ok) {
+            return QColor();
+        }
+        return QColor((rgba >> 24) & 0xff, (rgba >> 16) & 0xff, (rgba >> 8) & 0xff, rgba & 0xff);
+    }
+
+    // h,s,v, each from 0 to 1, and separated by commas and/or spaces
+    if(!color.isEmpty() && (color.at(0) == '.' || (color.at(0) >= '0' && color.at(0) <= '9'))) {
+        QList<QByteArray> values = color.replace(',', ' ').simplified().split(' ');
+        if(values.count() != 3) {
+            return QColor();
+        }
+
+        qreal hsv[3];
+        for(int i = 0; i < 3; ++i) {
+            bool ok = false;
+            hsv[i] = values.at(i).toDouble(&ok);
+            if(!ok) {
+                return QColor();
+            }
+        }
+        return QColor::fromHsvF(qBound(qreal(0.0), hsv[0], qreal(1.0)), qBound(qreal(0.0), hsv[1], qreal(1.0)),
+                               qBound(qreal(0.0), hsv[2], qreal(1.0)));
+    }
+
+    // Color schemes; /x11/red, or /accent3/1 (which Qt can't do anything with anyway)
+    if(color.startsWith('/')) {
+        color = color.mid(color.lastIndexOf('/') + 1);
+    }
+
+    QColor result;
+    result.setNamedColor(QString::fromLatin1(color));
+    return result;
+}
@@ -0,0 +1,100 @@
+/*!
+   \file
+   \author Dane Gardner <dane.gardner@gmail.com>
+   \version
+
+   \section LICENSE
+   This file is part of the Parallel Tools GUI Framework (PTGF)
+   Copyright (C) 2010-2011 Argo Navis Technologies, LLC
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+   \section DESCRIPTION
+
+ */
+
+
+#ifndef QGRAPHVIZATTRIBUTES_H
+#define QGRAPHVIZATTRIBUTES_H
+
+#include <QtCore>
+#include <QtGui>
+
+#include <graphviz/types.h>
+
+#include "QGraphVizLibrary.h"
+
+/*! The attributes of a scene's graph, read without building strings.  Attribute names resolve to symbols (GraphViz's
+    own indices into each object's attribute values) once per generation, and every distinct value that's read as a
+    color or a number is interned along with what it parsed to, so reading it again is a hash of the value and a table
+    lookup, and allocates nothing.
+ */
+class QGRAPHVIZ_EXPORT QGraphVizAttributes : public QObject
+{
+    Q_OBJECT
+public:
+    enum Kind { Kind_Graph, Kind_Node, Kind_Edge, Kind_Count };
+
+    enum Name {
+        Name_Color, Name_FillColor, Name_FontColor, Name_FontName, Name_FontSize, Name_Label, Name_PenWidth, Name_Shape,
+        Name_Style, Name_Count
+    };
+
+    explicit QGraphVizAttributes(QObject *parent = 0);
+
+    graph_t *graph();
+    void setGraph(graph_t *graph);
+    void invalidate();
+
+    int symbol(Kind kind, Name name);
+    int symbol(Kind kind, const char *name);
+    static const char *name(Name name);
+
+    const char *value(void *object, int symbol);
+    QString string(void *object, int symbol);
+    double number(void *object, int symbol, double defaultValue = 0.0);
+    double number(const char *value, double defaultValue = 0.0);
+    QColor color(void *object, int symbol, const QColor &defaultColor = QColor());
+    QColor color(const char *value, const QColor &defaultColor = QColor());
+
+    int valueCount();
+
+protected:
+    struct Value {
+        uint hash;
+        QByteArray text;
+        bool colorParsed;
+        QColor color;
+        bool numberParsed;
+        bool isNumber;
+        double number;
+    };
+
+    Value &intern(const char *value);
+    void *prototype(Kind kind);
+    static QColor parseColor(const QByteArray &text);
+
+private:
+    graph_t *m_Graph;
+
+    // Symbols for the well known names; -2 until resolved, and -1 if the graph doesn't have the attribute
+    int m_Symbols[Kind_Count][Name_Count];
+
+    QVector<Value> m_Values;
+    QVector<int> m_Buckets;
+
+};
+
+#endif // QGRAPHVIZATTRIBUTES_H
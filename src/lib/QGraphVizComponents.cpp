@@ -0,0 +1,365 @@
+/*!
+   \file
+   \author Dane Gardner <dane.gardner@gmail.com>
+   \version
+
+   \section LICENSE
+   This file is part of the Parallel Tools GUI Framework (PTGF)
+   Copyright (C) 2010-2011 Argo Navis Technologies, LLC
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+   \section DESCRIPTION
+
+ */
+
+
+#include "QGraphVizComponents.h"
+
+#include <graphviz/graph.h>
+
+// Space GraphViz leaves between packed components, in points, unless the graph's pack attribute says otherwise
+static const qreal PackMargin = 8.0;
+
+// Graph attributes that are about the drawing as a whole; in each component, they'd scale or stretch the pieces on
+// their own, and they'd no longer fit together the way the whole graph asked for
+static const char *const DrawingAttributes[] = { "label", "size", "ratio", "page", "pagedir", "center", "margin",
+                                                 "viewport", NULL };
+
+
+
+/*! Appends an ID in DOT syntax; quoted, unless it's an HTML string
+ */
+static void appendId(QByteArray &content, const char *id)
+{
+    if(aghtmlstr(const_cast<char*>(id))) {
+        content += '<';
+        content += id;
+        content += '>';
+        return;
+    }
+
+    content += '"';
+    for(const char *c = id; *c; ++c) {
+        if(*c == '"') {
+            content += '\\';
+        }
+        content += *c;
+    }
+    content += '"';
+}
+
+static bool contains(const char *const *names, const char *name)
+{
+    for(; names && *names; ++names) {
+        if(!qstrcmp(*names, name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*! Appends the attribute list of a graph, node or edge; with changedOnly, just the ones that differ from the defaults
+ */
+static void appendAttributes(QByteArray &content, void *object, bool changedOnly, const char *const *skip = NULL)
+{
+    bool first = true;
+    for(Agsym_t *attribute = agfstattr(object); attribute; attribute = agnxtattr(object, attribute)) {
+        const char *value = agxget(object, attribute->index);
+        if(!value || !*value || (changedOnly && !qstrcmp(value, attribute->value)) || contains(skip, attribute->name)) {
+            continue;
+        }
+
+        content += first ? " [" : ", ";
+        first = false;
+
+        appendId(content, attribute->name);
+        content += '=';
+        appendId(content, value);
+    }
+
+    if(!first) {
+        content += ']';
+    }
+}
+
+/*! The attributes the prototype node or edge's attributes are declared with, as the graph's first default statement
+    for them; so they're declared the same way again, and the nodes and edges only need the values that differ
+ */
+static void appendDeclarations(QByteArray &content, void *prototype)
+{
+    bool first = true;
+    for(Agsym_t *attribute = agfstattr(prototype); attribute; attribute = agnxtattr(prototype, attribute)) {
+        if(!attribute->value || !*attribute->value) {
+            continue;
+        }
+
+        content += first ? " [" : ", ";
+        first = false;
+
+        appendId(content, attribute->name);
+        content += '=';
+        appendId(content, attribute->value);
+    }
+
+    if(!first) {
+        content += ']';
+    }
+}
+
+/*! The opening of a graph; its attributes, and the defaults for its nodes and edges.  A component leaves out the
+    attributes about the whole drawing.
+ */
+static void appendHeader(QByteArray &content, graph_t *graph, bool component)
+{
+    if(AG_IS_STRICT(graph)) {
+        content += "strict ";
+    }
+    content += AG_IS_DIRECTED(graph) ? "digraph " : "graph ";
+    appendId(content, graph->name);
+    content += " {\n\tgraph";
+    appendAttributes(content, graph, false, component ? DrawingAttributes : NULL);
+    content += ";\n\tnode";
+    appendDeclarations(content, agprotonode(graph));
+    content += ";\n\tedge";
+    appendDeclarations(content, agprotoedge(graph));
+    content += ";\n";
+}
+
+/*! The closing of a graph; the defaults its nodes and edges have come to, where they differ from the declared ones,
+    for nodes and edges added after it's parsed again
+ */
+static void appendFooter(QByteArray &content, graph_t *graph)
+{
+    QByteArray defaults;
+    appendAttributes(defaults, agprotonode(graph), true);
+    if(!defaults.isEmpty()) {
+        content += "\tnode" + defaults + ";\n";
+    }
+
+    defaults.clear();
+    appendAttributes(defaults, agprotoedge(graph), true);
+    if(!defaults.isEmpty()) {
+        content += "\tedge" + defaults + ";\n";
+    }
+
+    content += "}\n";
+}
+
+static void appendNode(QByteArray &content, node_t *node)
+{
+    content += '\t';
+    appendId(content, node->name);
+    appendAttributes(content, node, true);
+    content += ";\n";
+}
+
+/*! The edges out of the node, in the order GraphViz keeps them
+ */
+static void appendEdges(QByteArray &content, graph_t *graph, node_t *node)
+{
+    const bool directed = AG_IS_DIRECTED(graph);
+    for(edge_t *edge = agfstout(graph, node); edge; edge = agnxtout(graph, edge)) {
+        content += '\t';
+        appendId(content, edge->tail->name);
+        content += directed ? " -> " : " -- ";
+        appendId(content, edge->head->name);
+        appendAttributes(content, edge, true);
+        content += ";\n";
+    }
+}
+
+static int findRoot(QVector<int> &parent, int node)
+{
+    while(parent.at(node) != node) {
+        parent[node] = parent.at(parent.at(node));
+        node = parent.at(node);
+    }
+    return node;
+}
+
+
+
+/*! Writes each connected component of the graph out as DOT content of its own, with the graph's attributes and
+    defaults, and the nodes and edges in their original order; so geometry from laying the pieces out matches the
+    whole graph by name.  The graph's own label isn't repeated in the pieces, nor are the attributes that size or
+    shape the drawing as a whole.  The number of nodes in each component goes in sizes.
+
+    Returns an empty list if there's nothing to gain from splitting; a single component, or subgraphs (clusters and
+    rank constraints can tie the components together).  The caller must hold the GraphViz context mutex.
+ */
+QList<QByteArray> QGraphVizComponents::split(graph_t *graph, QList<int> &sizes)
+{
+    QList<QByteArray> components;
+    sizes.clear();
+    if(!graph || hasSubgraphs(graph)) {
+        return components;
+    }
+
+    QHash<node_t*, int> index;
+    QVector<node_t*> nodes;
+    for(node_t *node = agfstnode(graph); node; node = agnxtnode(graph, node)) {
+        index.insert(node, nodes.count());
+        nodes.append(node);
+    }
+
+    // Union find, joining the ends of every edge
+    QVector<int> parent(nodes.count());
+    for(int i = 0; i < parent.count(); ++i) {
+        parent[i] = i;
+    }
+    foreach(node_t *node, nodes) {
+        for(edge_t *edge = agfstout(graph, node); edge; edge = agnxtout(graph, edge)) {
+            const int tail = findRoot(parent, index.value(edge->tail));
+            const int head = findRoot(parent, index.value(edge->head));
+            if(tail != head) {
+                parent[qMax(tail, head)] = qMin(tail, head);
+            }
+        }
+    }
+
+    // Number the components in the order their first nodes appear
+    QVector<int> component(nodes.count(), -1);
+    int count = 0;
+    for(int i = 0; i < nodes.count(); ++i) {
+        const int root = findRoot(parent, i);
+        if(component.at(root) < 0) {
+            component[root] = count++;
+        }
+        component[i] = component.at(root);
+    }
+
+    if(count < 2) {
+        return components;
+    }
+
+    QByteArray header;
+    appendHeader(header, graph, true);
+
+    QVector<QByteArray> contents(count, header);
+    QVector<int> counts(count, 0);
+
+    for(int i = 0; i < nodes.count(); ++i) {
+        appendNode(contents[component.at(i)], nodes.at(i));
+        ++counts[component.at(i)];
+    }
+
+    for(int i = 0; i < nodes.count(); ++i) {
+        appendEdges(contents[component.at(i)], graph, nodes.at(i));
+    }
+
+    for(int i = 0; i < count; ++i) {
+        contents[i] += "}\n";
+        components.append(contents.at(i));
+        sizes.append(counts.at(i));
+    }
+
+    return components;
+}
+
+/*! The whole graph as DOT, written the same way as split() writes the components; for graphs that have been changed
+    since they were parsed.  Returns an empty array for graphs with subgraphs, which it can't write.  The caller must
+    hold the GraphViz context mutex.
+ */
+QByteArray QGraphVizComponents::content(graph_t *graph)
+{
+    QByteArray content;
+    if(!graph || hasSubgraphs(graph)) {
+        return content;
+    }
+
+    appendHeader(content, graph, false);
+
+    for(node_t *node = agfstnode(graph); node; node = agnxtnode(graph, node)) {
+        appendNode(content, node);
+    }
+    for(node_t *node = agfstnode(graph); node; node = agnxtnode(graph, node)) {
+        appendEdges(content, graph, node);
+    }
+
+    appendFooter(content, graph);
+    return content;
+}
+
+/*! Space to leave between packed components, in points; the graph's pack attribute, as GraphViz reads it
+ */
+qreal QGraphVizComponents::margin(graph_t *graph)
+{
+    bool ok = false;
+    const int margin = QString(agget(graph, (char*)"pack")).toInt(&ok);
+    return (ok && margin >= 0) ? margin : PackMargin;
+}
+
+/*! Shelf packing: the components go left to right, tallest first, in rows about as wide as the whole lot would be
+    if it were square.  The first row is at the top, GraphViz's y axis pointing up.
+ */
+QGraphVizGeometry QGraphVizComponents::pack(const QList<QGraphVizGeometry> &components, qreal margin)
+{
+    QGraphVizGeometry packed;
+
+    qreal area = 0.0;
+    qreal widest = 0.0;
+    QVector<QPair<qreal, int> > order;
+    for(int i = 0; i < components.count(); ++i) {
+        const QRectF &box = components.at(i).boundingBox();
+        area += (box.width() + margin) * (box.height() + margin);
+        widest = qMax(widest, box.width());
+        order.append(qMakePair(-box.height(), i));
+    }
+    qStableSort(order.begin(), order.end());
+
+    const qreal rowWidth = qMax(widest, qSqrt(area));
+
+    QRectF boundingBox;
+    qreal x = 0.0;
+    qreal y = 0.0;
+    qreal rowHeight = 0.0;
+
+    for(int i = 0; i < order.count(); ++i) {
+        QGraphVizGeometry component = components.at(order.at(i).second);
+        const QRectF box = component.boundingBox();
+
+        if(x > 0.0 && (x + box.width()) > rowWidth) {
+            x = 0.0;
+            y += rowHeight + margin;
+            rowHeight = 0.0;
+        }
+
+        // The top of a GraphViz box is its largest y
+        component.translate(QPointF(x - box.left(), -y - box.bottom()));
+        boundingBox |= component.boundingBox();
+
+        foreach(const QGraphVizGeometry::Node &node, component.nodes()) {
+            packed.addNode(node);
+        }
+        foreach(const QGraphVizGeometry::Edge &edge, component.edges()) {
+            packed.addEdge(edge);
+        }
+
+        x += box.width() + margin;
+        rowHeight = qMax(rowHeight, box.height());
+    }
+
+    packed.setBoundingBox(boundingBox);
+    return packed;
+}
+
+/*! Subgraphs hang off the graph's node in the meta graph
+ */
+bool QGraphVizComponents::hasSubgraphs(graph_t *graph)
+{
+    graph_t *meta = graph->meta_node->graph;
+    return agfstout(meta, graph->meta_node) != NULL;
+}
@@ -0,0 +1,54 @@
+/*!
+   \file
+   \author Dane Gardner <dane.gardner@gmail.com>
+   \version
+
+   \section LICENSE
+   This file is part of the Parallel Tools GUI Framework (PTGF)
+   Copyright (C) 2010-2011 Argo Navis Technologies, LLC
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+   \section DESCRIPTION
+
+ */
+
+
+#ifndef QGRAPHVIZCOMPONENTS_H
+#define QGRAPHVIZCOMPONENTS_H
+
+#include <QtCore>
+
+#include <graphviz/types.h>
+
+#include "QGraphVizLibrary.h"
+#include "QGraphVizGeometry.h"
+
+/*! Splits a graph into its connected components, so they can be laid out separately (and concurrently), and packs
+    their layouts back together into one geometry for the whole graph.
+ */
+class QGRAPHVIZ_EXPORT QGraphVizComponents
+{
+public:
+    static QList<QByteArray> split(graph_t *graph, QList<int> &sizes);
+    static QByteArray content(graph_t *graph);
+    static qreal margin(graph_t *graph);
+    static QGraphVizGeometry pack(const QList<QGraphVizGeometry> &components, qreal margin);
+
+protected:
+    static bool hasSubgraphs(graph_t *graph);
+};
+
+#endif // QGRAPHVIZCOMPONENTS_H
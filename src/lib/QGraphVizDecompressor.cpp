@@ -0,0 +1,287 @@
+/*!
+   \file
+   \author Dane Gardner <dane.gardner@gmail.com>
+   \version
+
+   \section LICENSE
+   This file is part of the Parallel Tools GUI Framework (PTGF)
+   Copyright (C) 2010-2011 Argo Navis Technologies, LLC
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+   \section DESCRIPTION
+
+ */
+
+
+#include "QGraphVizDecompressor.h"
+
+#include <zlib.h>
+
+#ifdef QGRAPHVIZ_ZSTD
+#  include <zstd.h>
+#endif
+
+// How much compressed content is read from the source at a time
+static const int ChunkSize = 64 * 1024;
+
+QGraphVizDecompressor::QGraphVizDecompressor(QIODevice *source, QObject *parent) :
+    QIODevice(parent),
+    m_Source(source),
+    m_Format(Format_None),
+    m_Stream(NULL),
+    m_Finished(false),
+    m_InputSize(0),
+    m_InputPosition(0)
+{
+}
+
+QGraphVizDecompressor::~QGraphVizDecompressor()
+{
+    close();
+}
+
+/*! Recognizes the format from the magic number at the start of the content
+ */
+QGraphVizDecompressor::Format QGraphVizDecompressor::format(const QByteArray &header)
+{
+    const uchar *data = reinterpret_cast<const uchar*>(header.constData());
+
+    if(header.size() >= 2 && data[0] == 0x1f && data[1] == 0x8b) {
+        return Format_Gzip;
+    }
+
+    if(header.size() >= 4 && data[0] == 0x28 && data[1] == 0xb5 && data[2] == 0x2f && data[3] == 0xfd) {
+        return Format_Zstd;
+    }
+
+    return Format_None;
+}
+
+bool QGraphVizDecompressor::isCompressed(const QByteArray &header)
+{
+    return format(header) != Format_None;
+}
+
+QIODevice *QGraphVizDecompressor::source()
+{
+    return m_Source;
+}
+
+/*! The format of the content; only known once the device is open
+ */
+QGraphVizDecompressor::Format QGraphVizDecompressor::format()
+{
+    return m_Format;
+}
+
+/*! The source has to be open for reading already; the format is picked up from the start of it
+ */
+bool QGraphVizDecompressor::open(OpenMode mode)
+{
+    if(isOpen()) {
+        close();
+    }
+
+    if(mode & WriteOnly) {
+        setErrorString(tr("Compressed content can only be read"));
+        return false;
+    }
+
+    if(!m_Source || !m_Source->isReadable()) {
+        setErrorString(tr("The compressed content isn't open for reading"));
+        return false;
+    }
+
+    m_Format = format(m_Source->peek(4));
+    m_Finished = false;
+    m_InputSize = 0;
+    m_InputPosition = 0;
+
+    if(m_Format == Format_Gzip) {
+        z_stream *stream = new z_stream;
+        qMemSet(stream, 0, sizeof(z_stream));
+
+        // 32 has zlib take the gzip header
+        if(inflateInit2(stream, 15 + 32) != Z_OK) {
+            setErrorString(tr("Failed to start decompressing: %1").arg(stream->msg ? stream->msg : ""));
+            delete stream;
+            return false;
+        }
+        m_Stream = stream;
+    } else if(m_Format == Format_Zstd) {
+#ifdef QGRAPHVIZ_ZSTD
+        ZSTD_DStream *stream = ZSTD_createDStream();
+        if(!stream || ZSTD_isError(ZSTD_initDStream(stream))) {
+            setErrorString(tr("Failed to start decompressing"));
+            ZSTD_freeDStream(stream);
+            return false;
+        }
+        m_Stream = stream;
+#else
+        setErrorString(tr("The library was built without zstd support"));
+        return false;
+#endif
+    } else {
+        setErrorString(tr("The content isn't in a known compressed format"));
+        return false;
+    }
+
+    if(m_Input.size() != ChunkSize) {
+        m_Input.resize(ChunkSize);
+    }
+
+    return QIODevice::open(mode);
+}
+
+void QGraphVizDecompressor::close()
+{
+    if(m_Stream) {
+        if(m_Format == Format_Gzip) {
+            z_stream *stream = static_cast<z_stream*>(m_Stream);
+            inflateEnd(stream);
+            delete stream;
+        }
+#ifdef QGRAPHVIZ_ZSTD
+        else if(m_Format == Format_Zstd) {
+            ZSTD_freeDStream(static_cast<ZSTD_DStream*>(m_Stream));
+        }
+#endif
+        m_Stream = NULL;
+    }
+
+    m_Input = QByteArray();
+    m_InputSize = 0;
+    m_InputPosition = 0;
+
+    QIODevice::close();
+}
+
+bool QGraphVizDecompressor::isSequential() const
+{
+    return true;
+}
+
+bool QGraphVizDecompressor::atEnd() const
+{
+    return m_Finished && QIODevice::bytesAvailable() == 0;
+}
+
+/*! Returns as much as was asked for unless the content ends first; a read of nothing means the end, to QIODevice
+ */
+qint64 QGraphVizDecompressor::readData(char *data, qint64 maxSize)
+{
+    if(!m_Stream) {
+        return -1;
+    }
+
+    qint64 produced = 0;
+    while(produced < maxSize && !m_Finished) {
+        if(!hasInput() && !fill()) {
+            if(produced) {
+                break;
+            }
+            setErrorString(tr("The compressed content ends early"));
+            return -1;
+        }
+
+        qint64 written = 0;
+        if(!decompress(data + produced, maxSize - produced, written)) {
+            return produced ? produced : -1;
+        }
+        produced += written;
+    }
+
+    return produced;
+}
+
+qint64 QGraphVizDecompressor::writeData(const char *data, qint64 maxSize)
+{
+    Q_UNUSED(data)
+    Q_UNUSED(maxSize)
+    return -1;
+}
+
+bool QGraphVizDecompressor::hasInput()
+{
+    return m_InputPosition < m_InputSize;
+}
+
+/*! Reads the next chunk of compressed content; false once the source has no more
+ */
+bool QGraphVizDecompressor::fill()
+{
+    const qint64 read = m_Source->read(m_Input.data(), m_Input.size());
+
+    m_InputPosition = 0;
+    m_InputSize = (read > 0) ? (int)read : 0;
+
+    return m_InputSize > 0;
+}
+
+/*! One step of the decoder, from what's left of the chunk; at the end of a stream, carries on into the next one if
+    there's any more content
+ */
+bool QGraphVizDecompressor::decompress(char *data, qint64 maxSize, qint64 &written)
+{
+    bool streamEnd = false;
+
+    if(m_Format == Format_Gzip) {
+        z_stream *stream = static_cast<z_stream*>(m_Stream);
+        stream->next_in = reinterpret_cast<Bytef*>(m_Input.data() + m_InputPosition);
+        stream->avail_in = m_InputSize - m_InputPosition;
+        stream->next_out = reinterpret_cast<Bytef*>(data);
+        stream->avail_out = (uInt)qMin<qint64>(maxSize, 0x40000000);
+
+        const int result = inflate(stream, Z_NO_FLUSH);
+
+        written = reinterpret_cast<char*>(stream->next_out) - data;
+        m_InputPosition = m_InputSize - stream->avail_in;
+
+        if(result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR) {
+            setErrorString(tr("Corrupt compressed content: %1").arg(stream->msg ? stream->msg : ""));
+            return false;
+        }
+
+        streamEnd = (result == Z_STREAM_END);
+        if(streamEnd) {
+            inflateReset(stream);
+        }
+    }
+#ifdef QGRAPHVIZ_ZSTD
+    else if(m_Format == Format_Zstd) {
+        ZSTD_inBuffer input = { m_Input.constData() + m_InputPosition, size_t(m_InputSize - m_InputPosition), 0 };
+        ZSTD_outBuffer output = { data, size_t(maxSize), 0 };
+
+        const size_t result = ZSTD_decompressStream(static_cast<ZSTD_DStream*>(m_Stream), &output, &input);
+        if(ZSTD_isError(result)) {
+            setErrorString(tr("Corrupt compressed content: %1").arg(ZSTD_getErrorName(result)));
+            return false;
+        }
+
+        written = output.pos;
+        m_InputPosition += (int)input.pos;
+
+        // A frame is done, and all of it has been written out
+        streamEnd = (result == 0);
+    }
+#endif
+
+    if(streamEnd && !hasInput() && !fill()) {
+        m_Finished = true;
+    }
+
+    return true;
+}
@@ -0,0 +1,82 @@
+/*!
+   \file
+   \author Dane Gardner <dane.gardner@gmail.com>
+   \version
+
+   \section LICENSE
+   This file is part of the Parallel Tools GUI Framework (PTGF)
+   Copyright (C) 2010-2011 Argo Navis Technologies, LLC
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+   \section DESCRIPTION
+
+ */
+
+
+#ifndef QGRAPHVIZDECOMPRESSOR_H
+#define QGRAPHVIZDECOMPRESSOR_H
+
+#include <QtCore>
+
+#include "QGraphVizLibrary.h"
+
+/*! A read only device that decompresses gzip (or zstd) content from another device as it's read, a chunk at a time,
+    so the content never has to be held whole, compressed or not.  Concatenated streams are read one after the other.
+    Zstd support is only there when the library is built with QGRAPHVIZ_ZSTD defined.
+ */
+class QGRAPHVIZ_EXPORT QGraphVizDecompressor : public QIODevice
+{
+    Q_OBJECT
+public:
+    enum Format { Format_None, Format_Gzip, Format_Zstd };
+
+    explicit QGraphVizDecompressor(QIODevice *source, QObject *parent = 0);
+    ~QGraphVizDecompressor();
+
+    static Format format(const QByteArray &header);
+    static bool isCompressed(const QByteArray &header);
+
+    QIODevice *source();
+    Format format();
+
+    bool open(OpenMode mode);
+    void close();
+    bool isSequential() const;
+    bool atEnd() const;
+
+protected:
+    qint64 readData(char *data, qint64 maxSize);
+    qint64 writeData(const char *data, qint64 maxSize);
+
+    bool fill();
+    bool decompress(char *data, qint64 maxSize, qint64 &written);
+    bool hasInput();
+
+private:
+    QIODevice *m_Source;
+    Format m_Format;
+
+    // The decoder's state; a z_stream or a ZSTD_DStream, kept out of the header
+    void *m_Stream;
+    bool m_Finished;
+
+    QByteArray m_Input;
+    int m_InputSize;
+    int m_InputPosition;
+
+};
+
+#endif // QGRAPHVIZDECOMPRESSOR_H
@@ -0,0 +1,1927 @@
+/*!
+   \file
+   \author Dane Gardner <dane.gardner@gmail.com>
+   \version
+
+   \section LICENSE
+   This file is part of the Parallel Tools GUI Framework (PTGF)
+   Copyright (C) 2010-2011 Argo Navis Technologies, LLC
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+   \section DESCRIPTION
+
+ */
+
+
+#include "QGraphVizDotGraph.h"
+
+#include <graphviz/graph.h>
+
+// Character classes for the tokenizer; one table lookup per byte, rather than a chain of comparisons
+enum CharacterClass {
+    Class_Blank = 0x01,
+    Class_IdStart = 0x02,
+    Class_Digit = 0x04
+};
+
+struct CharacterClasses {
+    unsigned char table[256];
+
+    CharacterClasses()
+    {
+        qMemSet(table, 0, sizeof(table));
+        table[(unsigned char)' '] = table[(unsigned char)'\t'] = table[(unsigned char)'\r'] = Class_Blank;
+        table[(unsigned char)'\n'] = table[(unsigned char)'\f'] = table[(unsigned char)'\v'] = Class_Blank;
+        for(int c = 'a'; c <= 'z'; ++c) {
+            table[c] = table[c - 'a' + 'A'] = Class_IdStart;
+        }
+        table[(unsigned char)'_'] = Class_IdStart;
+        for(int c = 128; c < 256; ++c) {
+            table[c] = Class_IdStart;
+        }
+        for(int c = '0'; c <= '9'; ++c) {
+            table[c] = Class_Digit;
+        }
+    }
+};
+
+static const CharacterClasses Classes;
+
+static inline bool hasClass(char c, int classes)
+{
+    return Classes.table[(unsigned char)c] & classes;
+}
+
+/*! FNV-1a; HTML strings hash apart from plain ones with the same text
+ */
+static inline uint hashString(const char *data, int length, bool html)
+{
+    uint hash = html ? 2166136261u ^ 0x9e3779b9u : 2166136261u;
+    for(int i = 0; i < length; ++i) {
+        hash = (hash ^ (unsigned char)data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// The binary form; see QGraphVizDotGraph::toBinary()
+static const char BinaryMagic[] = "QGVB";
+static const quint32 BinaryVersion = 2;
+static const quint32 BinaryHtml = 0x80000000u;
+static const quint32 BinaryNone = 0xffffffffu;
+
+static inline void appendNumber(QByteArray &data, quint32 value)
+{
+    uchar bytes[4];
+    qToLittleEndian(value, bytes);
+    data.append(reinterpret_cast<const char*>(bytes), 4);
+}
+
+/*! Reads the binary form straight out of the content, checking every read against the end of it
+ */
+struct BinaryReader {
+    const uchar *position;
+    const uchar *end;
+
+    const uchar *take(qint64 size)
+    {
+        if(size < 0 || size > end - position) {
+            return NULL;
+        }
+        const uchar *data = position;
+        position += size;
+        return data;
+    }
+
+    bool read(quint32 &value)
+    {
+        const uchar *data = take(4);
+        if(data) {
+            value = qFromLittleEndian<quint32>(data);
+        }
+        return data;
+    }
+};
+
+static int countLines(const char *begin, const char *end)
+{
+    int lines = 0;
+    while(begin < end && (begin = static_cast<const char*>(memchr(begin, '\n', end - begin)))) {
+        ++lines;
+        ++begin;
+    }
+    return lines;
+}
+
+
+
+/*! Recursive descent over the DOT grammar, straight into a QGraphVizDotGraph
+ */
+class QGraphVizDotParser
+{
+public:
+    QGraphVizDotParser(QGraphVizDotGraph &graph, const QByteArray &content);
+    bool parse();
+
+private:
+    enum Token {
+        Token_End, Token_Error, Token_Id, Token_EdgeOp, Token_LeftBracket, Token_RightBracket, Token_LeftBrace,
+        Token_RightBrace, Token_Equals, Token_Comma, Token_Semicolon, Token_Colon
+    };
+
+    struct Scope {
+        int subgraph;
+        int nodeDefaults;
+        int edgeDefaults;
+        QVector<int> members;
+        QSet<int> memberSet;
+    };
+
+    typedef QVector<QPair<int, int> > AttributeList;
+
+    Token next();
+    Token peek();
+    Token lex(int &symbol, bool &quoted, bool &directed);
+    bool skipBlanks();
+    Token readQuoted(int &symbol);
+    Token readHtml(int &symbol);
+    bool isKeyword(const char *keyword) const;
+    bool fail(const QString &message);
+
+    bool parseStatements();
+    bool parseStatement();
+    bool parseAttributes(AttributeList &attributes);
+    bool parseSubgraph(QVector<int> &nodes);
+    bool parseEndpoint(QVector<int> &nodes, int &port);
+    bool parseNodeId(int &node, int &port);
+    int addNode(int name);
+    void addMember(int node);
+    void addEdge(int tail, int head, int attributes, int tailPort, int headPort);
+    int merge(int chain, int attributes);
+    void declareNodeAttribute(int name, int value);
+    void declareEdgeAttribute(int name, int value);
+    void updateDefaults();
+
+    QGraphVizDotGraph &m_Graph;
+    const char *m_Position;
+    const char *m_End;
+    const char *m_LineStart;
+    int m_Line;
+    QByteArray m_Buffer;
+
+    // The token just consumed, and the one after it if it has been peeked at
+    Token m_Token;
+    int m_Symbol;
+    bool m_Quoted;
+    bool m_Directed;
+    bool m_Peeked;
+    Token m_PeekToken;
+    int m_PeekSymbol;
+    bool m_PeekQuoted;
+    bool m_PeekDirected;
+
+    QVector<Scope> m_Scopes;
+    QHash<int, int> m_SubgraphsByName;
+    QHash<qint64, int> m_StrictEdges;
+    QSet<int> m_NodeAttributeNames;
+    QSet<int> m_EdgeAttributeNames;
+    int m_True;
+    int m_TailPort;
+    int m_HeadPort;
+};
+
+QGraphVizDotParser::QGraphVizDotParser(QGraphVizDotGraph &graph, const QByteArray &content) :
+    m_Graph(graph),
+    m_Position(content.constData()),
+    m_End(content.constData() + content.size()),
+    m_LineStart(content.constData()),
+    m_Line(1),
+    m_Token(Token_End),
+    m_Symbol(-1),
+    m_Quoted(false),
+    m_Directed(false),
+    m_Peeked(false),
+    m_PeekToken(Token_End),
+    m_PeekSymbol(-1),
+    m_PeekQuoted(false),
+    m_PeekDirected(false)
+{
+    m_True = m_Graph.intern("true", 4);
+    m_TailPort = m_Graph.intern("tailport", 8);
+    m_HeadPort = m_Graph.intern("headport", 8);
+
+    // Creating a GraphViz context declares the node label, so the graph's first label default isn't its declaration
+    declareNodeAttribute(m_Graph.intern("label", 5), m_Graph.intern("\\N", 2));
+}
+
+bool QGraphVizDotParser::parse()
+{
+    Token token = next();
+    if(token == Token_Id && isKeyword("strict")) {
+        m_Graph.m_Strict = true;
+        token = next();
+    }
+
+    if(token != Token_Id || !(isKeyword("graph") || isKeyword("digraph"))) {
+        return fail(QObject::tr("expected graph or digraph"));
+    }
+    m_Graph.m_Directed = isKeyword("digraph");
+
+    token = next();
+    if(token == Token_Id) {
+        m_Graph.m_Name = m_Symbol;
+        token = next();
+    }
+
+    if(token != Token_LeftBrace) {
+        return fail(QObject::tr("expected {"));
+    }
+
+    QGraphVizDotGraph::Subgraph root;
+    root.name = m_Graph.m_Name;
+    root.parent = -1;
+    root.attributes = -1;
+    root.nodeDefaults = -1;
+    root.edgeDefaults = -1;
+    m_Graph.m_Subgraphs.append(root);
+
+    Scope scope;
+    scope.subgraph = 0;
+    scope.nodeDefaults = -1;
+    scope.edgeDefaults = -1;
+    m_Scopes.append(scope);
+
+    // Anything after the first graph is ignored, as GraphViz does
+    return parseStatements();
+}
+
+QGraphVizDotParser::Token QGraphVizDotParser::next()
+{
+    if(m_Peeked) {
+        m_Peeked = false;
+        m_Token = m_PeekToken;
+        m_Symbol = m_PeekSymbol;
+        m_Quoted = m_PeekQuoted;
+        m_Directed = m_PeekDirected;
+        return m_Token;
+    }
+
+    m_Token = lex(m_Symbol, m_Quoted, m_Directed);
+    return m_Token;
+}
+
+QGraphVizDotParser::Token QGraphVizDotParser::peek()
+{
+    if(!m_Peeked) {
+        m_PeekToken = lex(m_PeekSymbol, m_PeekQuoted, m_PeekDirected);
+        m_Peeked = true;
+    }
+    return m_PeekToken;
+}
+
+QGraphVizDotParser::Token QGraphVizDotParser::lex(int &symbol, bool &quoted, bool &directed)
+{
+    symbol = -1;
+    quoted = false;
+
+    if(!skipBlanks()) {
+        return Token_Error;
+    }
+
+    if(m_Position >= m_End) {
+        return Token_End;
+    }
+
+    const char c = *m_Position;
+    switch(c) {
+    case '[': ++m_Position; return Token_LeftBracket;
+    case ']': ++m_Position; return Token_RightBracket;
+    case '{': ++m_Position; return Token_LeftBrace;
+    case '}': ++m_Position; return Token_RightBrace;
+    case '=': ++m_Position; return Token_Equals;
+    case ',': ++m_Position; return Token_Comma;
+    case ';': ++m_Position; return Token_Semicolon;
+    case ':': ++m_Position; return Token_Colon;
+    case '"':
+        quoted = true;
+        return readQuoted(symbol);
+    case '<':
+        quoted = true;
+        return readHtml(symbol);
+    default:
+        break;
+    }
+
+    if(c == '-' && m_Position + 1 < m_End && (m_Position[1] == '>' || m_Position[1] == '-')) {
+        directed = (m_Position[1] == '>');
+        m_Position += 2;
+        return Token_EdgeOp;
+    }
+
+    const char *start = m_Position;
+
+    if(hasClass(c, Class_IdStart)) {
+        while(m_Position < m_End && hasClass(*m_Position, Class_IdStart | Class_Digit)) {
+            ++m_Position;
+        }
+        symbol = m_Graph.intern(start, m_Position - start);
+        return Token_Id;
+    }
+
+    // Numerals; -?(.[0-9]+ | [0-9]+(.[0-9]*)?)
+    if(c == '-' || c == '.' || hasClass(c, Class_Digit)) {
+        if(*m_Position == '-') {
+            ++m_Position;
+        }
+        int digits = 0;
+        while(m_Position < m_End && hasClass(*m_Position, Class_Digit)) {
+            ++m_Position;
+            ++digits;
+        }
+        if(m_Position < m_End && *m_Position == '.') {
+            ++m_Position;
+            while(m_Position < m_End && hasClass(*m_Position, Class_Digit)) {
+                ++m_Position;
+                ++digits;
+            }
+        }
+        if(!digits) {
+            fail(QObject::tr("malformed number"));
+            return Token_Error;
+        }
+        symbol = m_Graph.intern(start, m_Position - start);
+        return Token_Id;
+    }
+
+    fail(QObject::tr("unexpected character '%1'").arg(QString::fromLocal8Bit(&c, 1)));
+    return Token_Error;
+}
+
+/*! Skips white space and comments, including preprocessor output lines (a # at the start of a line)
+ */
+bool QGraphVizDotParser::skipBlanks()
+{
+    for(;;) {
+        while(m_Position < m_End && hasClass(*m_Position, Class_Blank)) {
+            if(*m_Position == '\n') {
+                ++m_Line;
+                m_LineStart = m_Position + 1;
+            }
+            ++m_Position;
+        }
+
+        if(m_Position >= m_End) {
+            return true;
+        }
+
+        const char c = *m_Position;
+        const char following = (m_Position + 1 < m_End) ? m_Position[1] : '\0';
+
+        if((c == '#' && m_Position == m_LineStart) || (c == '/' && following == '/')) {
+            const char *newline = static_cast<const char*>(memchr(m_Position, '\n', m_End - m_Position));
+            m_Position = newline ? newline : m_End;
+        } else if(c == '/' && following == '*') {
+            const char *end = m_Position + 2;
+            while(end < m_End && (end = static_cast<const char*>(memchr(end, '*', m_End - end)))) {
+                if(end + 1 < m_End && end[1] == '/') {
+                    break;
+                }
+                ++end;
+            }
+            if(!end || end >= m_End) {
+                return fail(QObject::tr("unterminated comment"));
+            }
+            m_Line += countLines(m_Position, end);
+            m_Position = end + 2;
+        } else {
+            return true;
+        }
+    }
+}
+
+/*! A double quoted string, with \" unescaped and backslash-newline continuations removed, and any strings
+    concatenated onto it with + appended.  Strings without either are interned straight out of the content.  A
+    backslash always takes the character after it along, so "C:\\" ends at its last quote, and keeps both backslashes.
+ */
+QGraphVizDotParser::Token QGraphVizDotParser::readQuoted(int &symbol)
+{
+    const char *firstStart = NULL;
+    const char *firstEnd = NULL;
+    bool copied = false;
+    m_Buffer.clear();
+
+    for(;;) {
+        const char *start = ++m_Position;
+        const char *quote = start;
+        for(;;) {
+            quote = static_cast<const char*>(memchr(quote, '"', m_End - quote));
+            if(!quote) {
+                fail(QObject::tr("unterminated string"));
+                return Token_Error;
+            }
+            // Escaped, if there's an odd number of backslashes before it; each one escapes the character after it
+            const char *backslash = quote;
+            while(backslash > start && backslash[-1] == '\\') {
+                --backslash;
+            }
+            if((quote - backslash) % 2) {
+                ++quote;
+                continue;
+            }
+            break;
+        }
+
+        m_Line += countLines(start, quote);
+        m_Position = quote + 1;
+
+        const bool escaped = memchr(start, '\\', quote - start) != NULL;
+        if(!copied && !escaped && !firstStart) {
+            firstStart = start;
+            firstEnd = quote;
+        } else {
+            if(!copied && firstStart) {
+                m_Buffer.append(firstStart, firstEnd - firstStart);
+            }
+            copied = true;
+
+            for(const char *c = start; c < quote; ++c) {
+                if(*c == '\\' && c + 1 < quote) {
+                    if(c[1] == '\\') {
+                        m_Buffer.append(c, 2);
+                        ++c;
+                        continue;
+                    }
+                    if(c[1] == '"') {
+                        m_Buffer.append('"');
+                        ++c;
+                        continue;
+                    }
+                    if(c[1] == '\n') {
+                        ++c;
+                        continue;
+                    }
+                    if(c[1] == '\r' && c + 2 < quote && c[2] == '\n') {
+                        c += 2;
+                        continue;
+                    }
+                }
+                m_Buffer.append(*c);
+            }
+        }
+
+        // "a" + "b"
+        const char *position = m_Position;
+        const char *lineStart = m_LineStart;
+        const int line = m_Line;
+        if(!skipBlanks()) {
+            return Token_Error;
+        }
+        if(m_Position < m_End && *m_Position == '+') {
+            ++m_Position;
+            if(!skipBlanks()) {
+                return Token_Error;
+            }
+            if(m_Position < m_End && *m_Position == '"') {
+                if(!copied) {
+                    m_Buffer.append(firstStart, firstEnd - firstStart);
+                    copied = true;
+                }
+                continue;
+            }
+            fail(QObject::tr("expected a string after +"));
+            return Token_Error;
+        }
+
+        m_Position = position;
+        m_LineStart = lineStart;
+        m_Line = line;
+        break;
+    }
+
+    if(copied) {
+        symbol = m_Graph.intern(m_Buffer.constData(), m_Buffer.size());
+    } else {
+        symbol = m_Graph.intern(firstStart, firstEnd - firstStart);
+    }
+    return Token_Id;
+}
+
+/*! An HTML string; <...> with balanced angle brackets, kept without the outermost pair
+ */
+QGraphVizDotParser::Token QGraphVizDotParser::readHtml(int &symbol)
+{
+    const char *start = m_Position + 1;
+    int depth = 0;
+    const char *c = m_Position;
+    for(; c < m_End; ++c) {
+        if(*c == '<') {
+            ++depth;
+        } else if(*c == '>' && !--depth) {
+            break;
+        }
+    }
+
+    if(c >= m_End) {
+        fail(QObject::tr("unterminated HTML string"));
+        return Token_Error;
+    }
+
+    m_Line += countLines(start, c);
+    m_Position = c + 1;
+    symbol = m_Graph.intern(start, c - start, true);
+    return Token_Id;
+}
+
+/*! Whether the token just consumed is the keyword; keywords are case insensitive, and never quoted
+ */
+bool QGraphVizDotParser::isKeyword(const char *keyword) const
+{
+    if(m_Token != Token_Id || m_Quoted) {
+        return false;
+    }
+
+    const QGraphVizDotGraph::Symbol &symbol = m_Graph.m_Symbols.at(m_Symbol);
+    return !symbol.html && !qstricmp(m_Graph.m_Strings.constData() + symbol.offset, keyword);
+}
+
+/*! Records the first error; always returns false
+ */
+bool QGraphVizDotParser::fail(const QString &message)
+{
+    if(m_Graph.m_ErrorString.isEmpty()) {
+        m_Graph.m_ErrorString = message;
+        m_Graph.m_ErrorLine = m_Line;
+    }
+    return false;
+}
+
+/*! Statements up to, and including, the closing brace
+ */
+bool QGraphVizDotParser::parseStatements()
+{
+    for(;;) {
+        switch(peek()) {
+        case Token_RightBrace:
+            next();
+            return true;
+        case Token_Semicolon:
+            next();
+            break;
+        case Token_End:
+            return fail(QObject::tr("unexpected end of content; expected }"));
+        case Token_Error:
+            return false;
+        default:
+            if(!parseStatement()) {
+                return false;
+            }
+            break;
+        }
+    }
+}
+
+bool QGraphVizDotParser::parseStatement()
+{
+    const Token token = next();
+
+    // Attribute statements
+    if(isKeyword("graph") || isKeyword("node") || isKeyword("edge")) {
+        const bool graph = isKeyword("graph");
+        const bool node = isKeyword("node");
+
+        if(next() != Token_LeftBracket) {
+            return fail(QObject::tr("expected ["));
+        }
+
+        AttributeList attributes;
+        if(!parseAttributes(attributes)) {
+            return false;
+        }
+
+        for(int i = 0; i < attributes.count(); ++i) {
+            if(graph) {
+                QGraphVizDotGraph::Subgraph &subgraph = m_Graph.m_Subgraphs[m_Scopes.last().subgraph];
+                subgraph.attributes = m_Graph.addAttribute(subgraph.attributes, attributes.at(i).first, attributes.at(i).second);
+            } else if(node) {
+                declareNodeAttribute(attributes.at(i).first, (m_Scopes.count() == 1) ? attributes.at(i).second : -1);
+                m_Scopes.last().nodeDefaults = m_Graph.addAttribute(m_Scopes.last().nodeDefaults,
+                                                                    attributes.at(i).first, attributes.at(i).second);
+            } else {
+                declareEdgeAttribute(attributes.at(i).first, (m_Scopes.count() == 1) ? attributes.at(i).second : -1);
+                m_Scopes.last().edgeDefaults = m_Graph.addAttribute(m_Scopes.last().edgeDefaults,
+                                                                    attributes.at(i).first, attributes.at(i).second);
+            }
+        }
+        updateDefaults();
+        return true;
+    }
+
+    QVector<int> nodes;
+    int port = -1;
+
+    if(token == Token_LeftBrace || isKeyword("subgraph")) {
+        if(!parseSubgraph(nodes)) {
+            return false;
+        }
+    } else if(token == Token_Id) {
+        // ID = ID
+        const int name = m_Symbol;
+        if(peek() == Token_Equals) {
+            next();
+            if(next() != Token_Id) {
+                return fail(QObject::tr("expected a value"));
+            }
+            QGraphVizDotGraph::Subgraph &subgraph = m_Graph.m_Subgraphs[m_Scopes.last().subgraph];
+            subgraph.attributes = m_Graph.addAttribute(subgraph.attributes, name, m_Symbol);
+            return true;
+        }
+
+        int node = -1;
+        if(!parseNodeId(node, port)) {
+            return false;
+        }
+        nodes.append(node);
+
+        // Node statement
+        if(peek() != Token_EdgeOp) {
+            if(peek() == Token_LeftBracket) {
+                next();
+                AttributeList attributes;
+                if(!parseAttributes(attributes)) {
+                    return false;
+                }
+                QGraphVizDotGraph::Node &graphNode = m_Graph.m_Nodes[node];
+                for(int i = 0; i < attributes.count(); ++i) {
+                    declareNodeAttribute(attributes.at(i).first, -1);
+                    graphNode.attributes = m_Graph.addAttribute(graphNode.attributes, attributes.at(i).first, attributes.at(i).second);
+                }
+            }
+            return true;
+        }
+    } else if(token == Token_Error) {
+        return false;
+    } else {
+        return fail(QObject::tr("expected a statement"));
+    }
+
+    // Edge statement
+    QVector<QVector<int> > endpoints;
+    QVector<int> ports;
+    endpoints.append(nodes);
+    ports.append(port);
+
+    while(peek() == Token_EdgeOp) {
+        next();
+        if(m_Directed != m_Graph.m_Directed) {
+            return fail(m_Graph.m_Directed ? QObject::tr("-- in a digraph") : QObject::tr("-> in an undirected graph"));
+        }
+
+        QVector<int> headNodes;
+        int headPort = -1;
+        if(!parseEndpoint(headNodes, headPort)) {
+            return false;
+        }
+        endpoints.append(headNodes);
+        ports.append(headPort);
+    }
+
+    AttributeList attributes;
+    if(peek() == Token_LeftBracket) {
+        next();
+        if(!parseAttributes(attributes)) {
+            return false;
+        }
+    }
+
+    // Every edge of the statement shares the one chain of attributes
+    int chain = -1;
+    for(int i = 0; i < attributes.count(); ++i) {
+        declareEdgeAttribute(attributes.at(i).first, -1);
+        chain = m_Graph.addAttribute(chain, attributes.at(i).first, attributes.at(i).second);
+    }
+
+    for(int i = 0; i + 1 < endpoints.count(); ++i) {
+        foreach(int tail, endpoints.at(i)) {
+            foreach(int head, endpoints.at(i + 1)) {
+                addEdge(tail, head, chain, ports.at(i), ports.at(i + 1));
+            }
+        }
+    }
+
+    return true;
+}
+
+/*! One or more attribute lists; the opening bracket has been consumed.  A name without a value is set to true.
+ */
+bool QGraphVizDotParser::parseAttributes(AttributeList &attributes)
+{
+    for(;;) {
+        const Token token = next();
+
+        if(token == Token_RightBracket) {
+            if(peek() != Token_LeftBracket) {
+                return true;
+            }
+            next();
+            continue;
+        }
+
+        if(token == Token_Comma || token == Token_Semicolon) {
+            continue;
+        }
+
+        if(token != Token_Id) {
+            return fail(QObject::tr("expected an attribute name"));
+        }
+
+        const int name = m_Symbol;
+        if(peek() != Token_Equals) {
+            attributes.append(qMakePair(name, m_True));
+            continue;
+        }
+
+        next();
+        if(next() != Token_Id) {
+            return fail(QObject::tr("expected a value for %1").arg(QString::fromLocal8Bit(m_Graph.string(name))));
+        }
+        attributes.append(qMakePair(name, m_Symbol));
+    }
+}
+
+/*! A subgraph, anonymous or named, or a reference to one already defined; the subgraph keyword or the opening brace
+    has been consumed.  Its nodes are returned, for edges.
+ */
+bool QGraphVizDotParser::parseSubgraph(QVector<int> &nodes)
+{
+    int name = -1;
+
+    if(m_Token != Token_LeftBrace) {
+        const Token token = next();
+        if(token == Token_Id) {
+            name = m_Symbol;
+
+            // Just a reference to a subgraph already defined
+            if(peek() != Token_LeftBrace) {
+                const int subgraph = m_SubgraphsByName.value(name, -1);
+                if(subgraph < 0) {
+                    return fail(QObject::tr("expected {"));
+                }
+
+                for(int i = 0; i < m_Graph.m_Memberships.count(); ++i) {
+                    if(m_Graph.m_Memberships.at(i).first == subgraph) {
+                        nodes.append(m_Graph.m_Memberships.at(i).second);
+                        addMember(nodes.last());
+                    }
+                }
+                return true;
+            }
+            next();
+        } else if(token != Token_LeftBrace) {
+            return (token == Token_Error) ? false : fail(QObject::tr("expected {"));
+        }
+    }
+
+    int subgraph = (name >= 0) ? m_SubgraphsByName.value(name, -1) : -1;
+    if(subgraph < 0) {
+        QGraphVizDotGraph::Subgraph graphSubgraph;
+        graphSubgraph.name = name;
+        graphSubgraph.parent = m_Scopes.last().subgraph;
+        graphSubgraph.attributes = -1;
+        graphSubgraph.nodeDefaults = -1;
+        graphSubgraph.edgeDefaults = -1;
+        subgraph = m_Graph.m_Subgraphs.count();
+        m_Graph.m_Subgraphs.append(graphSubgraph);
+        if(name >= 0) {
+            m_SubgraphsByName.insert(name, subgraph);
+        }
+    }
+
+    Scope scope;
+    scope.subgraph = subgraph;
+    scope.nodeDefaults = m_Scopes.last().nodeDefaults;
+    scope.edgeDefaults = m_Scopes.last().edgeDefaults;
+    m_Scopes.append(scope);
+    updateDefaults();
+
+    if(!parseStatements()) {
+        return false;
+    }
+
+    nodes = m_Scopes.last().members;
+    m_Scopes.removeLast();
+    return true;
+}
+
+/*! The head of an edge; a node or a subgraph
+ */
+bool QGraphVizDotParser::parseEndpoint(QVector<int> &nodes, int &port)
+{
+    const Token token = next();
+
+    if(token == Token_LeftBrace || isKeyword("subgraph")) {
+        return parseSubgraph(nodes);
+    }
+
+    if(token != Token_Id) {
+        return (token == Token_Error) ? false : fail(QObject::tr("expected a node or a subgraph"));
+    }
+
+    int node = -1;
+    if(!parseNodeId(node, port)) {
+        return false;
+    }
+    nodes.append(node);
+    return true;
+}
+
+/*! The node named by the token just consumed, with its port (and compass point) if it has one
+ */
+bool QGraphVizDotParser::parseNodeId(int &node, int &port)
+{
+    node = addNode(m_Symbol);
+    port = -1;
+
+    if(peek() != Token_Colon) {
+        return true;
+    }
+
+    next();
+    if(next() != Token_Id) {
+        return fail(QObject::tr("expected a port"));
+    }
+    port = m_Symbol;
+
+    if(peek() == Token_Colon) {
+        next();
+        if(next() != Token_Id) {
+            return fail(QObject::tr("expected a compass point"));
+        }
+        const QByteArray portName = m_Graph.string(port) + ':' + m_Graph.string(m_Symbol);
+        port = m_Graph.intern(portName.constData(), portName.size());
+    }
+
+    return true;
+}
+
+/*! The node with the name, created with the defaults in scope if it's new
+ */
+int QGraphVizDotParser::addNode(int name)
+{
+    QVector<int> &nodesBySymbol = m_Graph.m_NodeBySymbol;
+    if(name >= nodesBySymbol.count()) {
+        const int count = nodesBySymbol.count();
+        nodesBySymbol.resize(m_Graph.m_Symbols.count());
+        for(int i = count; i < nodesBySymbol.count(); ++i) {
+            nodesBySymbol[i] = -1;
+        }
+    }
+
+    int node = nodesBySymbol.at(name);
+    if(node < 0) {
+        QGraphVizDotGraph::Node graphNode;
+        graphNode.name = name;
+        graphNode.attributes = -1;
+        graphNode.defaults = m_Scopes.last().nodeDefaults;
+        node = m_Graph.m_Nodes.count();
+        m_Graph.m_Nodes.append(graphNode);
+        nodesBySymbol[name] = node;
+    }
+
+    addMember(node);
+    return node;
+}
+
+/*! Adds the node to the subgraphs in scope, innermost first; one that's in a subgraph is already in all those around
+    it
+ */
+void QGraphVizDotParser::addMember(int node)
+{
+    for(int i = m_Scopes.count() - 1; i > 0; --i) {
+        Scope &scope = m_Scopes[i];
+        if(scope.memberSet.contains(node)) {
+            break;
+        }
+        scope.memberSet.insert(node);
+        scope.members.append(node);
+        m_Graph.m_Memberships.append(qMakePair(scope.subgraph, node));
+    }
+}
+
+void QGraphVizDotParser::addEdge(int tail, int head, int attributes, int tailPort, int headPort)
+{
+    if(tailPort >= 0) {
+        declareEdgeAttribute(m_TailPort, -1);
+        attributes = m_Graph.addAttribute(attributes, m_TailPort, tailPort);
+    }
+    if(headPort >= 0) {
+        declareEdgeAttribute(m_HeadPort, -1);
+        attributes = m_Graph.addAttribute(attributes, m_HeadPort, headPort);
+    }
+
+    // A strict graph has one edge between any two nodes; later statements just add attributes to it
+    if(m_Graph.m_Strict) {
+        const int first = m_Graph.m_Directed ? tail : qMin(tail, head);
+        const int second = m_Graph.m_Directed ? head : qMax(tail, head);
+        const qint64 key = (qint64(first) << 32) | quint32(second);
+
+        const int edge = m_StrictEdges.value(key, -1);
+        if(edge >= 0) {
+            m_Graph.m_Edges[edge].attributes = merge(m_Graph.m_Edges.at(edge).attributes, attributes);
+            return;
+        }
+        m_StrictEdges.insert(key, m_Graph.m_Edges.count());
+    }
+
+    QGraphVizDotGraph::Edge edge;
+    edge.tail = tail;
+    edge.head = head;
+    edge.subgraph = m_Scopes.last().subgraph;
+    edge.attributes = attributes;
+    edge.defaults = m_Scopes.last().edgeDefaults;
+    m_Graph.m_Edges.append(edge);
+}
+
+/*! Notes that nodes have the attribute.  As in GraphViz, the first time the graph itself gives it a default (the
+    value; -1 for none), every node there already is takes that default too.  Later defaults, and defaults given in
+    subgraphs, only apply to new nodes.
+ */
+void QGraphVizDotParser::declareNodeAttribute(int name, int value)
+{
+    if(m_NodeAttributeNames.contains(name)) {
+        return;
+    }
+    m_NodeAttributeNames.insert(name);
+    m_Graph.m_NodeDeclarations.append(qMakePair(name, value));
+
+    if(value >= 0) {
+        for(int i = 0; i < m_Graph.m_Nodes.count(); ++i) {
+            QGraphVizDotGraph::Node &node = m_Graph.m_Nodes[i];
+            node.attributes = m_Graph.addAttribute(node.attributes, name, value);
+        }
+    }
+}
+
+/*! As declareNodeAttribute(), for edges
+ */
+void QGraphVizDotParser::declareEdgeAttribute(int name, int value)
+{
+    if(m_EdgeAttributeNames.contains(name)) {
+        return;
+    }
+    m_EdgeAttributeNames.insert(name);
+    m_Graph.m_EdgeDeclarations.append(qMakePair(name, value));
+
+    if(value >= 0) {
+        for(int i = 0; i < m_Graph.m_Edges.count(); ++i) {
+            QGraphVizDotGraph::Edge &edge = m_Graph.m_Edges[i];
+            edge.attributes = m_Graph.addAttribute(edge.attributes, name, value);
+        }
+    }
+}
+
+/*! Notes the defaults in scope as the subgraph's own, for nodes and edges added to it after parsing
+ */
+void QGraphVizDotParser::updateDefaults()
+{
+    QGraphVizDotGraph::Subgraph &subgraph = m_Graph.m_Subgraphs[m_Scopes.last().subgraph];
+    subgraph.nodeDefaults = m_Scopes.last().nodeDefaults;
+    subgraph.edgeDefaults = m_Scopes.last().edgeDefaults;
+}
+
+/*! Puts copies of the attributes on top of the chain, in the same order, so they override it
+ */
+int QGraphVizDotParser::merge(int chain, int attributes)
+{
+    QVarLengthArray<int, 32> entries;
+    for(int i = attributes; i >= 0; i = m_Graph.m_Attributes.at(i).next) {
+        entries.append(i);
+    }
+
+    for(int i = entries.count() - 1; i >= 0; --i) {
+        const QGraphVizDotGraph::Attribute attribute = m_Graph.m_Attributes.at(entries.at(i));
+        chain = m_Graph.addAttribute(chain, attribute.name, attribute.value);
+    }
+
+    return chain;
+}
+
+
+
+QGraphVizDotGraph::QGraphVizDotGraph() :
+    m_Strict(false),
+    m_Directed(false),
+    m_Name(-1),
+    m_ErrorLine(0)
+{
+}
+
+/*! Parses DOT content into the model, replacing whatever it held.  On failure, errorString() and errorLine() say what
+    went wrong, and where.
+ */
+bool QGraphVizDotGraph::parse(const QByteArray &content)
+{
+    clear();
+
+    if(isBinary(content)) {
+        return parseBinary(content);
+    }
+
+    QGraphVizDotParser parser(*this, content);
+    if(!parser.parse()) {
+        if(m_ErrorString.isEmpty()) {
+            m_ErrorString = QObject::tr("syntax error");
+        }
+        return false;
+    }
+
+    m_NodeBySymbol.squeeze();
+    m_Attributes.squeeze();
+    m_Nodes.squeeze();
+    m_Edges.squeeze();
+    m_Strings.squeeze();
+    m_Symbols.squeeze();
+    return true;
+}
+
+/*! Whether the content is in the binary form, rather than DOT; parse() takes either
+ */
+bool QGraphVizDotGraph::isBinary(const QByteArray &content)
+{
+    return content.startsWith(BinaryMagic);
+}
+
+/*! Writes the model out in the binary form, which is an edge list; graphs with subgraphs can't be written, and give an
+    empty array.  Numbers are 32 bit, little endian, unsigned.
+
+    \code
+    "QGVB", version (2), flags (1 directed, 2 strict)
+    strings, string bytes, the length of each string (the top bit set for HTML strings), then the strings back to back
+    graph name (a string, or 0xffffffff)
+    graph attributes, then that many pairs of (name, value) strings
+    node attributes declared, then that many pairs of (name, default) strings; the default is 0xffffffff if it has none
+    edge attributes declared, likewise
+    node defaults, then that many pairs of (name, value) strings; then edge defaults, likewise
+    nodes, the name string of each node, then for each node its attribute count and (name, value) pairs
+    edges, the tail node of each edge, the head node of each edge, then for each edge its attribute count and pairs
+    \endcode
+
+    Every string is stored once, and referred to everywhere by its index; attribute values repeated over thousands of
+    nodes cost four bytes apiece.  The attributes of each node and edge include its defaults.
+ */
+QByteArray QGraphVizDotGraph::toBinary() const
+{
+    if(m_Subgraphs.count() != 1) {
+        return QByteArray();
+    }
+
+    QByteArray data;
+    data.reserve(m_Strings.size() + (m_Symbols.count() + m_Nodes.count() + (m_Edges.count() * 2)) * 4 + 64);
+
+    data.append(BinaryMagic, 4);
+    appendNumber(data, BinaryVersion);
+    appendNumber(data, (m_Directed ? 1 : 0) | (m_Strict ? 2 : 0));
+
+    quint32 bytes = 0;
+    for(int i = 0; i < m_Symbols.count(); ++i) {
+        bytes += m_Symbols.at(i).length;
+    }
+    appendNumber(data, m_Symbols.count());
+    appendNumber(data, bytes);
+    for(int i = 0; i < m_Symbols.count(); ++i) {
+        appendNumber(data, m_Symbols.at(i).length | (m_Symbols.at(i).html ? BinaryHtml : 0));
+    }
+    for(int i = 0; i < m_Symbols.count(); ++i) {
+        data.append(m_Strings.constData() + m_Symbols.at(i).offset, m_Symbols.at(i).length);
+    }
+
+    appendNumber(data, (m_Name >= 0) ? quint32(m_Name) : BinaryNone);
+
+    QList<QPair<int, int> > attributes;
+    QVarLengthArray<int, 32> seen;
+    collect(m_Subgraphs.first().attributes, attributes, seen);
+    appendNumber(data, attributes.count());
+    for(int i = 0; i < attributes.count(); ++i) {
+        appendNumber(data, attributes.at(i).first);
+        appendNumber(data, attributes.at(i).second);
+    }
+
+    for(int kind = 0; kind < 2; ++kind) {
+        const QVector<QPair<int, int> > &declarations = kind ? m_EdgeDeclarations : m_NodeDeclarations;
+        appendNumber(data, declarations.count());
+        for(int i = 0; i < declarations.count(); ++i) {
+            appendNumber(data, declarations.at(i).first);
+            appendNumber(data, (declarations.at(i).second >= 0) ? quint32(declarations.at(i).second) : BinaryNone);
+        }
+    }
+
+    for(int kind = 0; kind < 2; ++kind) {
+        attributes = chainAttributes(kind ? m_Subgraphs.first().edgeDefaults : m_Subgraphs.first().nodeDefaults);
+        appendNumber(data, attributes.count());
+        for(int i = 0; i < attributes.count(); ++i) {
+            appendNumber(data, attributes.at(i).first);
+            appendNumber(data, attributes.at(i).second);
+        }
+    }
+
+    appendNumber(data, m_Nodes.count());
+    for(int i = 0; i < m_Nodes.count(); ++i) {
+        appendNumber(data, m_Nodes.at(i).name);
+    }
+    for(int i = 0; i < m_Nodes.count(); ++i) {
+        attributes = nodeAttributes(i);
+        appendNumber(data, attributes.count());
+        for(int j = 0; j < attributes.count(); ++j) {
+            appendNumber(data, attributes.at(j).first);
+            appendNumber(data, attributes.at(j).second);
+        }
+    }
+
+    appendNumber(data, m_Edges.count());
+    for(int i = 0; i < m_Edges.count(); ++i) {
+        appendNumber(data, m_Edges.at(i).tail);
+    }
+    for(int i = 0; i < m_Edges.count(); ++i) {
+        appendNumber(data, m_Edges.at(i).head);
+    }
+    for(int i = 0; i < m_Edges.count(); ++i) {
+        attributes = edgeAttributes(i);
+        appendNumber(data, attributes.count());
+        for(int j = 0; j < attributes.count(); ++j) {
+            appendNumber(data, attributes.at(j).first);
+            appendNumber(data, attributes.at(j).second);
+        }
+    }
+
+    return data;
+}
+
+/*! Reads the binary form; the strings are interned as they come, and everything else is copied straight into place
+ */
+bool QGraphVizDotGraph::parseBinary(const QByteArray &content)
+{
+    BinaryReader reader;
+    reader.position = reinterpret_cast<const uchar*>(content.constData());
+    reader.end = reader.position + content.size();
+    reader.take(4);
+
+    quint32 version = 0, flags = 0, stringCount = 0, stringBytes = 0;
+    if(!reader.read(version) || version != BinaryVersion) {
+        m_ErrorString = QObject::tr("unsupported version of the binary form");
+        return false;
+    }
+
+    if(!reader.read(flags) || !reader.read(stringCount) || !reader.read(stringBytes)) {
+        m_ErrorString = QObject::tr("the binary content is truncated");
+        return false;
+    }
+    m_Directed = flags & 1;
+    m_Strict = flags & 2;
+
+    const uchar *lengths = reader.take(qint64(stringCount) * 4);
+    const char *strings = reinterpret_cast<const char*>(reader.take(stringBytes));
+    if(!lengths || !strings) {
+        m_ErrorString = QObject::tr("the binary content is truncated");
+        return false;
+    }
+
+    // The strings' indices in the content, as symbols
+    QVector<int> symbols(stringCount);
+    quint32 offset = 0;
+    for(quint32 i = 0; i < stringCount; ++i) {
+        const quint32 length = qFromLittleEndian<quint32>(lengths + (i * 4));
+        const quint32 size = length & ~BinaryHtml;
+        if(size > stringBytes - offset) {
+            m_ErrorString = QObject::tr("a string runs past the end of the strings");
+            return false;
+        }
+        symbols[i] = intern(strings + offset, size, length & BinaryHtml);
+        offset += size;
+    }
+    m_NodeBySymbol.fill(-1, m_Symbols.count());
+
+    quint32 name = 0;
+    if(!reader.read(name) || (name != BinaryNone && name >= stringCount)) {
+        m_ErrorString = QObject::tr("the graph name is invalid");
+        return false;
+    }
+    m_Name = (name == BinaryNone) ? -1 : symbols.at(name);
+
+    Subgraph root;
+    root.name = m_Name;
+    root.parent = -1;
+    root.attributes = -1;
+    root.nodeDefaults = -1;
+    root.edgeDefaults = -1;
+    m_Subgraphs.append(root);
+
+    if(!readBinaryAttributes(reader.position, reader.end, symbols, m_Subgraphs.first().attributes)) {
+        m_ErrorString = QObject::tr("the graph attributes are invalid");
+        return false;
+    }
+
+    if(!readBinaryDeclarations(reader.position, reader.end, symbols, m_NodeDeclarations)
+            || !readBinaryDeclarations(reader.position, reader.end, symbols, m_EdgeDeclarations)
+            || !readBinaryAttributes(reader.position, reader.end, symbols, m_Subgraphs.first().nodeDefaults)
+            || !readBinaryAttributes(reader.position, reader.end, symbols, m_Subgraphs.first().edgeDefaults)) {
+        m_ErrorString = QObject::tr("the default attributes are invalid");
+        return false;
+    }
+
+    quint32 nodeCount = 0;
+    const uchar *names = NULL;
+    if(!reader.read(nodeCount) || !(names = reader.take(qint64(nodeCount) * 4))) {
+        m_ErrorString = QObject::tr("the binary content is truncated");
+        return false;
+    }
+
+    m_Nodes.reserve(nodeCount);
+    for(quint32 i = 0; i < nodeCount; ++i) {
+        const quint32 nodeName = qFromLittleEndian<quint32>(names + (i * 4));
+        if(nodeName >= stringCount || m_NodeBySymbol.at(symbols.at(nodeName)) >= 0) {
+            m_ErrorString = QObject::tr("node %1 has an invalid name").arg(i);
+            return false;
+        }
+
+        Node node;
+        node.name = symbols.at(nodeName);
+        node.defaults = -1;
+        if(!readBinaryAttributes(reader.position, reader.end, symbols, node.attributes)) {
+            m_ErrorString = QObject::tr("the attributes of node %1 are invalid").arg(i);
+            return false;
+        }
+
+        m_NodeBySymbol[node.name] = m_Nodes.count();
+        m_Nodes.append(node);
+    }
+
+    quint32 edgeCount = 0;
+    const uchar *tails = NULL;
+    const uchar *heads = NULL;
+    if(!reader.read(edgeCount) || !(tails = reader.take(qint64(edgeCount) * 4))
+            || !(heads = reader.take(qint64(edgeCount) * 4))) {
+        m_ErrorString = QObject::tr("the binary content is truncated");
+        return false;
+    }
+
+    m_Edges.reserve(edgeCount);
+    for(quint32 i = 0; i < edgeCount; ++i) {
+        Edge edge;
+        edge.tail = qFromLittleEndian<quint32>(tails + (i * 4));
+        edge.head = qFromLittleEndian<quint32>(heads + (i * 4));
+        edge.subgraph = 0;
+        edge.defaults = -1;
+        if((quint32)edge.tail >= nodeCount || (quint32)edge.head >= nodeCount) {
+            m_ErrorString = QObject::tr("edge %1 joins nodes that don't exist").arg(i);
+            return false;
+        }
+        if(!readBinaryAttributes(reader.position, reader.end, symbols, edge.attributes)) {
+            m_ErrorString = QObject::tr("the attributes of edge %1 are invalid").arg(i);
+            return false;
+        }
+        m_Edges.append(edge);
+    }
+
+    return true;
+}
+
+/*! An attribute count and (name, value) pairs, at the position; chained from the last, so the first is on top
+ */
+bool QGraphVizDotGraph::readBinaryAttributes(const uchar *&position, const uchar *end, const QVector<int> &symbols,
+                                             int &chain)
+{
+    if(end - position < 4) {
+        return false;
+    }
+
+    const quint32 count = qFromLittleEndian<quint32>(position);
+    if(qint64(count) * 8 > end - position - 4) {
+        return false;
+    }
+
+    const uchar *pairs = position + 4;
+    position = pairs + (qint64(count) * 8);
+
+    chain = -1;
+    for(quint32 i = count; i > 0; --i) {
+        const quint32 name = qFromLittleEndian<quint32>(pairs + ((i - 1) * 8));
+        const quint32 value = qFromLittleEndian<quint32>(pairs + ((i - 1) * 8) + 4);
+        if(name >= (quint32)symbols.count() || value >= (quint32)symbols.count()) {
+            return false;
+        }
+        chain = addAttribute(chain, symbols.at(name), symbols.at(value));
+    }
+
+    return true;
+}
+
+/*! A declaration count and (name, default) pairs, at the position
+ */
+bool QGraphVizDotGraph::readBinaryDeclarations(const uchar *&position, const uchar *end, const QVector<int> &symbols,
+                                               QVector<QPair<int, int> > &declarations)
+{
+    if(end - position < 4) {
+        return false;
+    }
+
+    const quint32 count = qFromLittleEndian<quint32>(position);
+    if(qint64(count) * 8 > end - position - 4) {
+        return false;
+    }
+
+    const uchar *pairs = position + 4;
+    position = pairs + (qint64(count) * 8);
+
+    declarations.reserve(count);
+    for(quint32 i = 0; i < count; ++i) {
+        const quint32 name = qFromLittleEndian<quint32>(pairs + (i * 8));
+        const quint32 value = qFromLittleEndian<quint32>(pairs + (i * 8) + 4);
+        if(name >= (quint32)symbols.count() || (value != BinaryNone && value >= (quint32)symbols.count())) {
+            return false;
+        }
+        declarations.append(qMakePair(symbols.at(name), (value == BinaryNone) ? -1 : symbols.at(value)));
+    }
+
+    return true;
+}
+
+void QGraphVizDotGraph::clear()
+{
+    m_Strict = false;
+    m_Directed = false;
+    m_Name = -1;
+    m_Strings.clear();
+    m_Symbols.clear();
+    m_Buckets.clear();
+    m_Attributes.clear();
+    m_Nodes.clear();
+    m_Edges.clear();
+    m_Subgraphs.clear();
+    m_Memberships.clear();
+    m_NodeBySymbol.clear();
+    m_NodeDeclarations.clear();
+    m_EdgeDeclarations.clear();
+    m_ErrorString.clear();
+    m_ErrorLine = 0;
+}
+
+QString QGraphVizDotGraph::errorString() const
+{
+    return m_ErrorString;
+}
+
+int QGraphVizDotGraph::errorLine() const
+{
+    return m_ErrorLine;
+}
+
+bool QGraphVizDotGraph::isStrict() const
+{
+    return m_Strict;
+}
+
+bool QGraphVizDotGraph::isDirected() const
+{
+    return m_Directed;
+}
+
+QByteArray QGraphVizDotGraph::name() const
+{
+    return string(m_Name);
+}
+
+int QGraphVizDotGraph::nodeCount() const
+{
+    return m_Nodes.count();
+}
+
+const QGraphVizDotGraph::Node &QGraphVizDotGraph::node(int index) const
+{
+    return m_Nodes.at(index);
+}
+
+/*! The index of the node with the name, or -1
+ */
+int QGraphVizDotGraph::findNode(const QByteArray &name) const
+{
+    const int symbol = findSymbol(name);
+    return (symbol >= 0 && symbol < m_NodeBySymbol.count()) ? m_NodeBySymbol.at(symbol) : -1;
+}
+
+int QGraphVizDotGraph::edgeCount() const
+{
+    return m_Edges.count();
+}
+
+const QGraphVizDotGraph::Edge &QGraphVizDotGraph::edge(int index) const
+{
+    return m_Edges.at(index);
+}
+
+/*! Subgraph 0 is the graph itself
+ */
+int QGraphVizDotGraph::subgraphCount() const
+{
+    return m_Subgraphs.count();
+}
+
+const QGraphVizDotGraph::Subgraph &QGraphVizDotGraph::subgraph(int index) const
+{
+    return m_Subgraphs.at(index);
+}
+
+QByteArray QGraphVizDotGraph::string(int symbol) const
+{
+    if(symbol < 0 || symbol >= m_Symbols.count()) {
+        return QByteArray();
+    }
+
+    const Symbol &entry = m_Symbols.at(symbol);
+    return QByteArray(m_Strings.constData() + entry.offset, entry.length);
+}
+
+bool QGraphVizDotGraph::isHtml(int symbol) const
+{
+    return symbol >= 0 && symbol < m_Symbols.count() && m_Symbols.at(symbol).html;
+}
+
+/*! The symbol of the string, or -1 if it isn't in the graph anywhere
+ */
+int QGraphVizDotGraph::findSymbol(const QByteArray &string, bool html) const
+{
+    if(m_Buckets.isEmpty()) {
+        return -1;
+    }
+
+    const uint hash = hashString(string.constData(), string.size(), html);
+    const int mask = m_Buckets.count() - 1;
+    for(int i = hash & mask; ; i = (i + 1) & mask) {
+        const int symbol = m_Buckets.at(i);
+        if(symbol < 0) {
+            return -1;
+        }
+
+        const Symbol &entry = m_Symbols.at(symbol);
+        if(entry.hash == hash && entry.length == string.size() && entry.html == html
+                && !memcmp(m_Strings.constData() + entry.offset, string.constData(), entry.length)) {
+            return symbol;
+        }
+    }
+}
+
+QByteArray QGraphVizDotGraph::graphAttribute(const QByteArray &name) const
+{
+    if(m_Subgraphs.isEmpty()) {
+        return QByteArray();
+    }
+    return string(lookup(m_Subgraphs.first().attributes, findSymbol(name)));
+}
+
+QByteArray QGraphVizDotGraph::nodeAttribute(int node, const QByteArray &name) const
+{
+    const int symbol = findSymbol(name);
+    const Node &graphNode = m_Nodes.at(node);
+
+    int value = lookup(graphNode.attributes, symbol);
+    if(value < 0) {
+        value = lookup(graphNode.defaults, symbol);
+    }
+    return string(value);
+}
+
+QByteArray QGraphVizDotGraph::edgeAttribute(int edge, const QByteArray &name) const
+{
+    const int symbol = findSymbol(name);
+    const Edge &graphEdge = m_Edges.at(edge);
+
+    int value = lookup(graphEdge.attributes, symbol);
+    if(value < 0) {
+        value = lookup(graphEdge.defaults, symbol);
+    }
+    return string(value);
+}
+
+/*! Every attribute the node has, its own and its defaults, as (name, value) symbols
+ */
+QList<QPair<int, int> > QGraphVizDotGraph::nodeAttributes(int node) const
+{
+    QList<QPair<int, int> > attributes;
+    QVarLengthArray<int, 32> seen;
+    collect(m_Nodes.at(node).attributes, attributes, seen);
+    collect(m_Nodes.at(node).defaults, attributes, seen);
+    return attributes;
+}
+
+QList<QPair<int, int> > QGraphVizDotGraph::edgeAttributes(int edge) const
+{
+    QList<QPair<int, int> > attributes;
+    QVarLengthArray<int, 32> seen;
+    collect(m_Edges.at(edge).attributes, attributes, seen);
+    collect(m_Edges.at(edge).defaults, attributes, seen);
+    return attributes;
+}
+
+/*! Roughly how many bytes the model takes up
+ */
+qint64 QGraphVizDotGraph::memoryUsage() const
+{
+    return qint64(m_Strings.capacity())
+            + qint64(m_Symbols.capacity()) * sizeof(Symbol)
+            + qint64(m_Buckets.capacity()) * sizeof(int)
+            + qint64(m_Attributes.capacity()) * sizeof(Attribute)
+            + qint64(m_Nodes.capacity()) * sizeof(Node)
+            + qint64(m_Edges.capacity()) * sizeof(Edge)
+            + qint64(m_Subgraphs.capacity()) * sizeof(Subgraph)
+            + qint64(m_Memberships.capacity()) * sizeof(QPair<int, int>)
+            + qint64(m_NodeBySymbol.capacity()) * sizeof(int)
+            + qint64(m_NodeDeclarations.capacity() + m_EdgeDeclarations.capacity()) * sizeof(QPair<int, int>);
+}
+
+/*! Builds the GraphViz graph; the caller must hold whatever lock guards GraphViz.  The attributes are declared as
+    GraphViz's parser declares them, with the same defaults, and each node and edge only gets the values that differ
+    from those; so GraphViz sees the same values it would have parsed.  Each subgraph's prototype node and edge get the
+    defaults in force at its end, for nodes and edges added to the graph later.
+ */
+graph_t *QGraphVizDotGraph::toGraph() const
+{
+    if(m_Subgraphs.isEmpty()) {
+        return NULL;
+    }
+
+    const int kind = m_Directed ? (m_Strict ? AGDIGRAPHSTRICT : AGDIGRAPH) : (m_Strict ? AGRAPHSTRICT : AGRAPH);
+    QByteArray graphName = (m_Name >= 0) ? string(m_Name) : QByteArray("_anonymous_0");
+    graph_t *graph = agopen(graphName.data(), kind);
+    if(!graph) {
+        return NULL;
+    }
+
+    QVector<graph_t*> subgraphs(m_Subgraphs.count());
+    subgraphs[0] = graph;
+
+    setAttributes(graph, chainAttributes(m_Subgraphs.first().attributes));
+    declareAttributes(graph, m_NodeDeclarations, true);
+    declareAttributes(graph, m_EdgeDeclarations, false);
+
+    for(int i = 1; i < m_Subgraphs.count(); ++i) {
+        const Subgraph &subgraph = m_Subgraphs.at(i);
+        QByteArray name = (subgraph.name >= 0) ? string(subgraph.name) : "_anonymous_" + QByteArray::number(i);
+        subgraphs[i] = agsubg(subgraphs.at(subgraph.parent), name.data());
+        setAttributes(subgraphs.at(i), chainAttributes(subgraph.attributes));
+    }
+
+    QVector<node_t*> nodes(m_Nodes.count());
+    for(int i = 0; i < m_Nodes.count(); ++i) {
+        const Symbol &name = m_Symbols.at(m_Nodes.at(i).name);
+        nodes[i] = agnode(graph, const_cast<char*>(m_Strings.constData() + name.offset));
+        setAttributes(nodes.at(i), nodeAttributes(i));
+    }
+
+    for(int i = 0; i < m_Memberships.count(); ++i) {
+        graph_t *subgraph = subgraphs.at(m_Memberships.at(i).first);
+        node_t *node = nodes.at(m_Memberships.at(i).second);
+        if(!agidnode(subgraph, node->id)) {
+            aginsert(subgraph, node);
+        }
+    }
+
+    for(int i = 0; i < m_Edges.count(); ++i) {
+        const Edge &edge = m_Edges.at(i);
+        edge_t *graphEdge = agedge(subgraphs.at(edge.subgraph), nodes.at(edge.tail), nodes.at(edge.head));
+        setAttributes(graphEdge, edgeAttributes(i));
+    }
+
+    // Only now; nodes and edges take their prototype's values when they're created
+    for(int i = 0; i < m_Subgraphs.count(); ++i) {
+        setAttributes(agprotonode(subgraphs.at(i)), chainAttributes(m_Subgraphs.at(i).nodeDefaults));
+        setAttributes(agprotoedge(subgraphs.at(i)), chainAttributes(m_Subgraphs.at(i).edgeDefaults));
+    }
+
+    return graph;
+}
+
+/*! Checks the model against GraphViz's own parse of the same content; the same nodes in the same order, the same edges,
+    and the same value for every attribute.  An attribute the model doesn't have matches GraphViz's default for it.
+    The node and edge attributes have to be declared with the same defaults, and the graph's prototype node and edge
+    have to hold the same defaults as the model.  The first difference is described in difference.  The caller must
+    hold whatever lock guards GraphViz.
+ */
+bool QGraphVizDotGraph::compare(graph_t *graph, QString &difference) const
+{
+    difference.clear();
+
+    if(!graph) {
+        difference = QObject::tr("GraphViz failed to parse the content");
+        return false;
+    }
+
+    if(bool(AG_IS_DIRECTED(graph)) != m_Directed || bool(AG_IS_STRICT(graph)) != m_Strict) {
+        difference = QObject::tr("the kind of graph differs");
+        return false;
+    }
+
+    if(agnnodes(graph) != m_Nodes.count() || agnedges(graph) != m_Edges.count()) {
+        difference = QObject::tr("GraphViz has %1 nodes and %2 edges, rather than %3 and %4")
+                .arg(agnnodes(graph)).arg(agnedges(graph)).arg(m_Nodes.count()).arg(m_Edges.count());
+        return false;
+    }
+
+    if(!compareAttributes(graph, chainAttributes(m_Subgraphs.first().attributes), QObject::tr("graph"), difference)) {
+        return false;
+    }
+
+    if(!compareDeclarations(agprotonode(graph), m_NodeDeclarations, QObject::tr("node defaults"), difference)
+            || !compareDeclarations(agprotoedge(graph), m_EdgeDeclarations, QObject::tr("edge defaults"), difference)
+            || !compareAttributes(agprotonode(graph), chainAttributes(m_Subgraphs.first().nodeDefaults),
+                                  QObject::tr("node defaults"), difference)
+            || !compareAttributes(agprotoedge(graph), chainAttributes(m_Subgraphs.first().edgeDefaults),
+                                  QObject::tr("edge defaults"), difference)) {
+        return false;
+    }
+
+    QHash<node_t*, int> indices;
+    int index = 0;
+    for(node_t *node = agfstnode(graph); node; node = agnxtnode(graph, node), ++index) {
+        const QString what = QObject::tr("node %1").arg(QString::fromLocal8Bit(node->name));
+        if(string(m_Nodes.at(index).name) != node->name) {
+            difference = QObject::tr("%1 is %2 in the model").arg(what).arg(QString::fromLocal8Bit(string(m_Nodes.at(index).name)));
+            return false;
+        }
+        if(!compareAttributes(node, nodeAttributes(index), what, difference)) {
+            return false;
+        }
+        indices.insert(node, index);
+    }
+
+    // Parallel edges are told apart by their order
+    QHash<QPair<int, int>, QVector<int> > edges;
+    for(int i = 0; i < m_Edges.count(); ++i) {
+        edges[qMakePair(m_Edges.at(i).tail, m_Edges.at(i).head)].append(i);
+    }
+
+    for(node_t *node = agfstnode(graph); node; node = agnxtnode(graph, node)) {
+        QHash<node_t*, int> ordinals;
+        for(edge_t *edge = agfstout(graph, node); edge; edge = agnxtout(graph, edge)) {
+            const QString what = QObject::tr("edge %1 -> %2").arg(QString::fromLocal8Bit(edge->tail->name))
+                    .arg(QString::fromLocal8Bit(edge->head->name));
+            const QVector<int> candidates = edges.value(qMakePair(indices.value(edge->tail), indices.value(edge->head)));
+            const int ordinal = ordinals[edge->head]++;
+            if(ordinal >= candidates.count()) {
+                difference = QObject::tr("%1 isn't in the model").arg(what);
+                return false;
+            }
+            if(!compareAttributes(edge, edgeAttributes(candidates.at(ordinal)), what, difference)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/*! Compares every attribute GraphViz has for the object, and makes sure it has all of the model's
+ */
+bool QGraphVizDotGraph::compareAttributes(void *object, const QList<QPair<int, int> > &attributes, const QString &what,
+                                          QString &difference) const
+{
+    for(Agsym_t *symbol = agfstattr(object); symbol; symbol = agnxtattr(object, symbol)) {
+        const char *actual = agxget(object, symbol->index);
+        if(!actual) {
+            actual = "";
+        }
+
+        const int name = findSymbol(QByteArray(symbol->name));
+        int value = -1;
+        for(int i = 0; name >= 0 && i < attributes.count(); ++i) {
+            if(attributes.at(i).first == name) {
+                value = attributes.at(i).second;
+                break;
+            }
+        }
+
+        const bool matches = (value >= 0) ? (string(value) == actual) : (!*actual || !qstrcmp(actual, symbol->value));
+        if(!matches) {
+            difference = QObject::tr("%1: %2 is \"%3\" rather than \"%4\"").arg(what)
+                    .arg(QString::fromLocal8Bit(symbol->name)).arg(QString::fromLocal8Bit(actual))
+                    .arg(QString::fromLocal8Bit(string(value)));
+            return false;
+        }
+    }
+
+    for(int i = 0; i < attributes.count(); ++i) {
+        QByteArray name = string(attributes.at(i).first);
+        if(!agfindattr(object, name.data())) {
+            difference = QObject::tr("%1: GraphViz has no %2").arg(what).arg(QString::fromLocal8Bit(name));
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*! Checks that GraphViz declares the same attributes, with the same defaults, as the model
+ */
+bool QGraphVizDotGraph::compareDeclarations(void *prototype, const QVector<QPair<int, int> > &declarations,
+                                            const QString &what, QString &difference) const
+{
+    int count = 0;
+    for(Agsym_t *symbol = agfstattr(prototype); symbol; symbol = agnxtattr(prototype, symbol), ++count) {
+        const int name = findSymbol(QByteArray(symbol->name));
+        int declaration = -1;
+        for(int i = 0; name >= 0 && i < declarations.count() && declaration < 0; ++i) {
+            if(declarations.at(i).first == name) {
+                declaration = i;
+            }
+        }
+
+        const char *declared = symbol->value ? symbol->value : "";
+        if(declaration < 0) {
+            difference = QObject::tr("%1: the model doesn't declare %2").arg(what)
+                    .arg(QString::fromLocal8Bit(symbol->name));
+            return false;
+        }
+        const int value = declarations.at(declaration).second;
+        if(string(value) != declared) {
+            difference = QObject::tr("%1: %2 is declared with \"%3\" rather than \"%4\"").arg(what)
+                    .arg(QString::fromLocal8Bit(symbol->name)).arg(QString::fromLocal8Bit(declared))
+                    .arg(QString::fromLocal8Bit(string(value)));
+            return false;
+        }
+    }
+
+    if(count != declarations.count()) {
+        difference = QObject::tr("%1: GraphViz declares %2 attributes, rather than %3").arg(what).arg(count)
+                .arg(declarations.count());
+        return false;
+    }
+
+    return true;
+}
+
+int QGraphVizDotGraph::intern(const char *data, int length, bool html)
+{
+    // Open addressing, at most half full
+    if(m_Buckets.count() < 2 * (m_Symbols.count() + 1)) {
+        const int size = qMax(1024, m_Buckets.count() * 2);
+        m_Buckets.fill(-1, size);
+        const int mask = size - 1;
+        for(int symbol = 0; symbol < m_Symbols.count(); ++symbol) {
+            int i = m_Symbols.at(symbol).hash & mask;
+            while(m_Buckets.at(i) >= 0) {
+                i = (i + 1) & mask;
+            }
+            m_Buckets[i] = symbol;
+        }
+    }
+
+    const uint hash = hashString(data, length, html);
+    const int mask = m_Buckets.count() - 1;
+    for(int i = hash & mask; ; i = (i + 1) & mask) {
+        const int symbol = m_Buckets.at(i);
+        if(symbol < 0) {
+            Symbol entry;
+            entry.offset = m_Strings.size();
+            entry.length = length;
+            entry.hash = hash;
+            entry.html = html;
+
+            // Null terminated, so GraphViz can take them as they are
+            m_Strings.append(data, length);
+            m_Strings.append('\0');
+
+            m_Buckets[i] = m_Symbols.count();
+            m_Symbols.append(entry);
+            return m_Buckets.at(i);
+        }
+
+        const Symbol &entry = m_Symbols.at(symbol);
+        if(entry.hash == hash && entry.length == length && entry.html == html
+                && !memcmp(m_Strings.constData() + entry.offset, data, length)) {
+            return symbol;
+        }
+    }
+}
+
+/*! Puts the attribute on top of the chain, where it overrides any earlier value; returns the new top
+ */
+int QGraphVizDotGraph::addAttribute(int chain, int name, int value)
+{
+    Attribute attribute;
+    attribute.name = name;
+    attribute.value = value;
+    attribute.next = chain;
+    m_Attributes.append(attribute);
+    return m_Attributes.count() - 1;
+}
+
+int QGraphVizDotGraph::lookup(int chain, int name) const
+{
+    if(name < 0) {
+        return -1;
+    }
+
+    for(int i = chain; i >= 0; i = m_Attributes.at(i).next) {
+        if(m_Attributes.at(i).name == name) {
+            return m_Attributes.at(i).value;
+        }
+    }
+    return -1;
+}
+
+/*! Appends the attributes in the chain that aren't overridden by ones already seen
+ */
+void QGraphVizDotGraph::collect(int chain, QList<QPair<int, int> > &attributes, QVarLengthArray<int, 32> &seen) const
+{
+    for(int i = chain; i >= 0; i = m_Attributes.at(i).next) {
+        const Attribute &attribute = m_Attributes.at(i);
+
+        bool overridden = false;
+        for(int j = 0; j < seen.count() && !overridden; ++j) {
+            overridden = (seen.at(j) == attribute.name);
+        }
+        if(overridden) {
+            continue;
+        }
+
+        seen.append(attribute.name);
+        attributes.append(qMakePair(attribute.name, attribute.value));
+    }
+}
+
+/*! Every attribute in the chain that isn't overridden
+ */
+QList<QPair<int, int> > QGraphVizDotGraph::chainAttributes(int chain) const
+{
+    QList<QPair<int, int> > attributes;
+    QVarLengthArray<int, 32> seen;
+    collect(chain, attributes, seen);
+    return attributes;
+}
+
+/*! Declares the node or edge attributes in the graph, in order, each with its default (empty if it has none)
+ */
+void QGraphVizDotGraph::declareAttributes(graph_t *graph, const QVector<QPair<int, int> > &declarations,
+                                          bool nodes) const
+{
+    for(int i = 0; i < declarations.count(); ++i) {
+        char *name = const_cast<char*>(m_Strings.constData() + m_Symbols.at(declarations.at(i).first).offset);
+        char *value = (char*)"";
+        char *html = NULL;
+        if(declarations.at(i).second >= 0) {
+            const Symbol &symbol = m_Symbols.at(declarations.at(i).second);
+            value = const_cast<char*>(m_Strings.constData() + symbol.offset);
+            if(symbol.html) {
+                value = html = agstrdup_html(value);
+            }
+        }
+
+        if(nodes) {
+            agnodeattr(graph, name, value);
+        } else {
+            agedgeattr(graph, name, value);
+        }
+
+        if(html) {
+            agstrfree(html);
+        }
+    }
+}
+
+/*! Sets the attributes that the object doesn't have already; declared ones it has from its default, or its prototype.
+    HTML strings have to stay HTML strings; GraphViz keeps one copy of each string, so setting the attribute to the
+    HTML copy's text picks up that copy.
+ */
+void QGraphVizDotGraph::setAttributes(void *object, const QList<QPair<int, int> > &attributes) const
+{
+    for(int i = 0; i < attributes.count(); ++i) {
+        char *name = const_cast<char*>(m_Strings.constData() + m_Symbols.at(attributes.at(i).first).offset);
+        const Symbol &value = m_Symbols.at(attributes.at(i).second);
+        char *text = const_cast<char*>(m_Strings.constData() + value.offset);
+
+        Agsym_t *symbol = agfindattr(object, name);
+        if(symbol) {
+            char *current = agxget(object, symbol->index);
+            if(current && !qstrcmp(current, text) && bool(aghtmlstr(current)) == value.html) {
+                continue;
+            }
+        }
+
+        if(value.html) {
+            char *html = agstrdup_html(text);
+            agsafeset(object, name, html, (char*)"");
+            agstrfree(html);
+        } else {
+            agsafeset(object, name, text, (char*)"");
+        }
+    }
+}
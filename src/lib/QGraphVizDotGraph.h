@@ -0,0 +1,168 @@
+/*!
+   \file
+   \author Dane Gardner <dane.gardner@gmail.com>
+   \version
+
+   \section LICENSE
+   This file is part of the Parallel Tools GUI Framework (PTGF)
+   Copyright (C) 2010-2011 Argo Navis Technologies, LLC
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+   \section DESCRIPTION
+
+ */
+
+
+#ifndef QGRAPHVIZDOTGRAPH_H
+#define QGRAPHVIZDOTGRAPH_H
+
+#include <QtCore>
+
+#include <graphviz/types.h>
+
+#include "QGraphVizLibrary.h"
+
+/*! A compact model of a DOT graph, parsed by the library itself rather than by GraphViz.  Every string (names,
+    attribute names and values) is interned once into a single buffer, and referred to by its symbol; attributes are
+    kept in one array of records, chained from the nodes, edges and subgraphs that have them.  Parsing takes no locks,
+    so graphs can be parsed side by side on any number of threads; toGraph() builds the GraphViz graph when one is
+    needed.
+
+    Default attributes (node [...] and edge [...]) apply to the nodes and edges created after them in the same
+    subgraph, as in GraphViz; and, also as in GraphViz, a default the graph gives an attribute no node (or edge) had
+    yet applies to the ones already there too.  That first default is the one GraphViz declares the attribute with;
+    the model keeps the declarations in order, and the defaults in force at the end of each subgraph.
+
+    The model can also be written out, and read back, in a compact binary form (see toBinary()), which loads without
+    any parsing at all.
+ */
+class QGRAPHVIZ_EXPORT QGraphVizDotGraph
+{
+public:
+    struct Node {
+        int name;
+        int attributes;
+        int defaults;
+    };
+
+    struct Edge {
+        int tail;
+        int head;
+        int subgraph;
+        int attributes;
+        int defaults;
+    };
+
+    struct Subgraph {
+        int name;
+        int parent;
+        int attributes;
+        int nodeDefaults;
+        int edgeDefaults;
+    };
+
+    QGraphVizDotGraph();
+
+    bool parse(const QByteArray &content);
+    static bool isBinary(const QByteArray &content);
+    QByteArray toBinary() const;
+    QString errorString() const;
+    int errorLine() const;
+
+    bool isStrict() const;
+    bool isDirected() const;
+    QByteArray name() const;
+
+    int nodeCount() const;
+    const Node &node(int index) const;
+    int findNode(const QByteArray &name) const;
+
+    int edgeCount() const;
+    const Edge &edge(int index) const;
+
+    int subgraphCount() const;
+    const Subgraph &subgraph(int index) const;
+
+    QByteArray string(int symbol) const;
+    bool isHtml(int symbol) const;
+    int findSymbol(const QByteArray &string, bool html = false) const;
+
+    QByteArray graphAttribute(const QByteArray &name) const;
+    QByteArray nodeAttribute(int node, const QByteArray &name) const;
+    QByteArray edgeAttribute(int edge, const QByteArray &name) const;
+    QList<QPair<int, int> > nodeAttributes(int node) const;
+    QList<QPair<int, int> > edgeAttributes(int edge) const;
+
+    qint64 memoryUsage() const;
+
+    graph_t *toGraph() const;
+    bool compare(graph_t *graph, QString &difference) const;
+
+protected:
+    struct Symbol {
+        int offset;
+        int length;
+        uint hash;
+        bool html;
+    };
+
+    struct Attribute {
+        int name;
+        int value;
+        int next;
+    };
+
+    bool parseBinary(const QByteArray &content);
+    bool readBinaryAttributes(const uchar *&position, const uchar *end, const QVector<int> &symbols, int &chain);
+    bool readBinaryDeclarations(const uchar *&position, const uchar *end, const QVector<int> &symbols,
+                                QVector<QPair<int, int> > &declarations);
+    int intern(const char *data, int length, bool html = false);
+    int addAttribute(int chain, int name, int value);
+    int lookup(int chain, int name) const;
+    void collect(int chain, QList<QPair<int, int> > &attributes, QVarLengthArray<int, 32> &seen) const;
+    QList<QPair<int, int> > chainAttributes(int chain) const;
+    void declareAttributes(graph_t *graph, const QVector<QPair<int, int> > &declarations, bool nodes) const;
+    void setAttributes(void *object, const QList<QPair<int, int> > &attributes) const;
+    bool compareAttributes(void *object, const QList<QPair<int, int> > &attributes, const QString &what,
+                           QString &difference) const;
+    bool compareDeclarations(void *prototype, const QVector<QPair<int, int> > &declarations, const QString &what,
+                             QString &difference) const;
+    void clear();
+
+    bool m_Strict;
+    bool m_Directed;
+    int m_Name;
+
+    QByteArray m_Strings;
+    QVector<Symbol> m_Symbols;
+    QVector<int> m_Buckets;
+
+    QVector<Attribute> m_Attributes;
+    QVector<Node> m_Nodes;
+    QVector<Edge> m_Edges;
+    QVector<Subgraph> m_Subgraphs;
+    QVector<QPair<int, int> > m_Memberships;
+    QVector<int> m_NodeBySymbol;
+    QVector<QPair<int, int> > m_NodeDeclarations;
+    QVector<QPair<int, int> > m_EdgeDeclarations;
+
+    QString m_ErrorString;
+    int m_ErrorLine;
+
+    friend class QGraphVizDotParser;
+};
+
+#endif // QGRAPHVIZDOTGRAPH_H
@@ -28,6 +28,9 @@
 #include "QGraphVizEdge.h"
 #include "QGraphVizScene.h"
 #include "QGraphVizNode.h"
+#include "QGraphVizEdgeLayer.h"
+#include "QGraphVizLabelCache.h"
+#include "QGraphVizAttributes.h"
 
 
 
@@ -36,17 +39,28 @@ static const double TwoPi = 2.0 * Pi;
 static const double ThirdPi = Pi / 3;
 static const qreal ArrowSize = 10;
 
+/* Tolerance of the finest simplified path level in scene units; each coarser level is LodToleranceStep times looser.
+   A level is drawn once its tolerance maps to no more than LodPixelError device pixels. */
+static const qreal LodToleranceMin = 0.25;
+static const qreal LodToleranceStep = 4.0;
+static const qreal LodPixelError = 0.5;
+static const int LodLevelsMax = 8;
+
 
 
 QGraphVizEdge::QGraphVizEdge(edge_t *edge, QGraphVizScene *graphViz, QGraphicsItem * parent) :
     QGraphicsItem(parent),
     m_GraphVizEdge(edge),
     m_GraphViz(graphViz),
+    m_Index(-1),
+    m_Generation(0),
+    m_Style(-1),
     m_Highlighted(false),
     m_HighlightWidth(3.0),
     m_HighlightColor(Qt::red),
     m_Head(NULL),
-    m_Tail(NULL)
+    m_Tail(NULL),
+    m_Layer(NULL)
 {
     updateGeometry();
 }
@@ -70,24 +84,7 @@ bool QGraphVizEdge::isHighlighted()
 }
 void QGraphVizEdge::setHighlighted(bool highlighted)
 {
-    if(tail()->isTransparent()) {
-        return;
-    }
-
-    if(m_Highlighted == highlighted) {
-        return;
-    }
-
-    m_Highlighted = highlighted;
-
-    if(tail()) {
-        foreach(QGraphVizEdge *edge, tail()->headEdges()) {
-            edge->setHighlighted(m_Highlighted);
-        }
-    }
-
-    prepareGeometryChange();
-    update();
+    m_GraphViz->propagateHighlight(this, highlighted);
 }
 qreal QGraphVizEdge::highlightWidth()
 {
@@ -96,6 +93,10 @@ qreal QGraphVizEdge::highlightWidth()
 void QGraphVizEdge::setHighlightWidth(qreal width)
 {
     m_HighlightWidth = width;
+    if(m_Layer) {
+        m_Layer->invalidate();
+        m_Layer->update();
+    }
     prepareGeometryChange();
     update();
 }
@@ -106,6 +107,10 @@ QColor QGraphVizEdge::highlightColor()
 void QGraphVizEdge::setHighlightColor(QColor color)
 {
     m_HighlightColor = color;
+    if(m_Layer) {
+        m_Layer->invalidate();
+        m_Layer->update();
+    }
     prepareGeometryChange();
     update();
 }
@@ -120,6 +125,8 @@ QRectF QGraphVizEdge::boundingRect() const
 
 void QGraphVizEdge::updateGeometry()
 {
+    m_Generation = m_GraphViz->generation();
+
     QPointF position = m_GraphViz->transformPoint(m_GraphVizEdge->u.spl->list[0].list[0]);
     if(position != pos()) {
         setPos(position);
@@ -131,11 +138,11 @@ void QGraphVizEdge::updateGeometry()
     m_BoundingRect = m_BoundingRect.united(m_Path.boundingRect().adjusted(-5.0, -5.0, 5.0, 5.0));
     m_BoundingRect = m_BoundingRect.united(m_PathArrow.boundingRect().adjusted(-5.0, -5.0, 5.0, 5.0));
 
-    // Pre-render the label to get the bounding box
     updateLabel();
-    QPainterPath label;
-    label.addText(0, 0 , labelFont(), labelText());
-    m_BoundingRect = m_BoundingRect.united(label.boundingRect().translated(labelPosition()).adjusted(-5.0, -5.0, 5.0, 5.0));
+    if(!labelText().isEmpty()) {
+        QRectF label(labelPosition(), m_GraphViz->labelCache()->size(labelText(), labelFont()));
+        m_BoundingRect = m_BoundingRect.united(label.adjusted(-5.0, -5.0, 5.0, 5.0));
+    }
 
     prepareGeometryChange();
     update();
@@ -153,23 +160,17 @@ void QGraphVizEdge::paint(QPainter *painter, const QStyleOptionGraphicsItem *opt
 
     const qreal lod = option->levelOfDetailFromTransform(painter->worldTransform());
 
-    QByteArray currHash = m_GraphViz->getHash(m_GraphVizEdge);
-    if(m_LastHash != currHash) {
+    if(m_Generation != m_GraphViz->generation()) {
         updateGeometry();
-        m_LastHash = currHash;
     }
 
-    if(!graphicsEffect()) {
-        setGraphicsEffect(new QGraphicsOpacityEffect(scene()));
-    }
-
-    QGraphicsOpacityEffect *effect = qobject_cast<QGraphicsOpacityEffect*>(graphicsEffect());
-    if(effect) {
-        if(tail()->isTransparent() || tail()->isCollapsed()) {
-            effect->setOpacity(0.15);
-        } else {
-            effect->setOpacity(1.0);
-        }
+    /*! \note Dimming is done directly on the painter; a graphics effect would render every edge into its own
+              offscreen pixmap on every paint.  The view doesn't save painter state between items, so the opacity
+              has to be set either way. */
+    if(tail()->isTransparent() || tail()->isCollapsed()) {
+        painter->setOpacity(0.15);
+    } else {
+        painter->setOpacity(1.0);
     }
 
     drawBackground(painter, option);
@@ -177,35 +178,33 @@ void QGraphVizEdge::paint(QPainter *painter, const QStyleOptionGraphicsItem *opt
     // Draw path
     if(lod >= 0.05 && !m_Path.isEmpty()) {
 
+        const QGraphVizStyleTable::Style &style = this->style();
         if(this->isHighlighted()) {
-            QPen pen(m_PathPen);
+            QPen pen(style.pen);
             pen.setColor(highlightColor());
             pen.setWidthF(highlightWidth());
             painter->setPen(pen);
         } else {
-            painter->setPen(m_PathPen);
+            painter->setPen(style.pen);
         }
 
-        painter->setBrush(m_PathBrush);
+        painter->setBrush(style.brush);
+
+        painter->drawPath(pathForLevel(levelOfDetail(lod)));
 
-        if(lod >= 0.25 || m_PathSimple.isEmpty()) {
-            painter->drawPath(m_Path);
+        if(lod >= 0.25) {
             if(!m_PathArrow.isEmpty()) {
                 painter->drawPath(m_PathArrow);
             }
-        } else  {
-            painter->drawPath(m_PathSimple);
-            if(lod >= 0.125 && !m_PathArrowSimple.isEmpty()) {
-                painter->drawPath(m_PathArrowSimple);
-            }
+        } else if(lod >= 0.125 && !m_PathArrowSimple.isEmpty()) {
+            painter->drawPath(m_PathArrowSimple);
         }
     }
 
     // Draw label
     if(lod >= 0.45 && !labelText().isEmpty()) {
         painter->setPen(labelColor());
-        painter->setFont(labelFont());
-        painter->drawText(labelPosition(), labelText());
+        m_GraphViz->labelCache()->draw(painter, labelPosition(), labelText(), labelFont());
     }
 
     drawForeground(painter, option);
@@ -229,22 +228,27 @@ void QGraphVizEdge::updatePath()
 {
     if(!m_GraphVizEdge->u.spl) {
         m_Path = QPainterPath();
-        m_PathSimple = QPainterPath();
         m_PathArrow = QPainterPath();
         m_PathArrowSimple = QPainterPath();
+        m_PathLevels.clear();
         return;
     }
 
 
-    m_PathBrush = QBrush(Qt::transparent);
+    QGraphVizStyleTable *styles = m_GraphViz->styleTable();
+    QGraphVizStyleTable::Style style = styles->style(m_Style);
+
+    style.brush = QBrush(Qt::transparent);
+
 
+    style.pen = QPen(Qt::black);
+    style.pen.setWidthF(m_GraphVizEdge->u.weight * 1.5);
 
-    m_PathPen = QPen(Qt::black);
-    m_PathPen.setWidthF(m_GraphVizEdge->u.weight * 1.5);
+    m_Style = styles->addStyle(style);
 
 
     m_Path = QPainterPath();
-    m_PathSimple = QPainterPath();
+    m_PathLevels.clear();
 
     bezier bez = m_GraphVizEdge->u.spl->list[0];  // Only ever one spl
 
@@ -286,7 +290,8 @@ void QGraphVizEdge::updatePath()
     }
 
     m_Path.lineTo(endPoint);
-    m_PathSimple.lineTo(endPoint);
+
+    updatePathLevels();
 
 
     // Add an arrowhead
@@ -339,6 +344,143 @@ void QGraphVizEdge::updatePath()
     update();
 }
 
+/*! Distance from point to the segment (start, end)
+ */
+static qreal segmentDistance(const QPointF &point, const QPointF &start, const QPointF &end)
+{
+    const QPointF segment = end - start;
+    const qreal lengthSquared = segment.x() * segment.x() + segment.y() * segment.y();
+
+    QPointF nearest = start;
+    if(lengthSquared > 0.0) {
+        const QPointF offset = point - start;
+        qreal t = (offset.x() * segment.x() + offset.y() * segment.y()) / lengthSquared;
+        nearest = start + segment * qBound(qreal(0.0), t, qreal(1.0));
+    }
+
+    const QPointF delta = point - nearest;
+    return qSqrt(delta.x() * delta.x() + delta.y() * delta.y());
+}
+
+/*! Douglas-Peucker simplification of a polyline; no point of the original strays further than tolerance from the
+    result.  Uses an explicit stack so a long flattened spline can't overflow the call stack.
+ */
+static QPolygonF simplifyPolyline(const QPolygonF &polyline, qreal tolerance)
+{
+    if(polyline.count() < 3) {
+        return polyline;
+    }
+
+    QVector<bool> keep(polyline.count(), false);
+    keep[0] = true;
+    keep[polyline.count() - 1] = true;
+
+    QVector<QPair<int, int> > stack;
+    stack.append(qMakePair(0, polyline.count() - 1));
+
+    while(!stack.isEmpty()) {
+        const QPair<int, int> range = stack.last();
+        stack.pop_back();
+
+        qreal maximum = 0.0;
+        int index = -1;
+        for(int i = range.first + 1; i < range.second; ++i) {
+            qreal distance = segmentDistance(polyline.at(i), polyline.at(range.first), polyline.at(range.second));
+            if(distance > maximum) {
+                maximum = distance;
+                index = i;
+            }
+        }
+
+        if(index >= 0 && maximum > tolerance) {
+            keep[index] = true;
+            stack.append(qMakePair(range.first, index));
+            stack.append(qMakePair(index, range.second));
+        }
+    }
+
+    QPolygonF simplified;
+    for(int i = 0; i < polyline.count(); ++i) {
+        if(keep.at(i)) {
+            simplified.append(polyline.at(i));
+        }
+    }
+
+    return simplified;
+}
+
+/*! Builds the level-of-detail pyramid for m_Path: the flattened spline simplified at increasing tolerances, down to
+    the straight line between the end points.  Levels that don't drop any points are shared with the previous one.
+ */
+void QGraphVizEdge::updatePathLevels()
+{
+    m_PathLevels.clear();
+
+    QPolygonF polyline;
+    foreach(const QPolygonF &polygon, m_Path.toSubpathPolygons()) {
+        polyline += polygon;
+    }
+
+    if(polyline.count() < 2) {
+        return;
+    }
+
+    qreal tolerance = LodToleranceMin;
+    int previousCount = -1;
+    for(int level = 0; level < LodLevelsMax; ++level, tolerance *= LodToleranceStep) {
+        QPolygonF simplified = simplifyPolyline(polyline, tolerance);
+
+        if(simplified.count() == previousCount) {
+            m_PathLevels.append(m_PathLevels.last());
+        } else {
+            QPainterPath path;
+            path.addPolygon(simplified);
+            m_PathLevels.append(path);
+            previousCount = simplified.count();
+        }
+
+        if(simplified.count() <= 2) {
+            break;
+        }
+    }
+}
+
+/*! Returns the coarsest pyramid level that stays within LodPixelError device pixels of the spline at the given
+    level of detail, or -1 if only the spline itself will do.
+ */
+int QGraphVizEdge::levelOfDetail(qreal lod)
+{
+    if(lod <= 0.0) {
+        return LodLevelsMax - 1;
+    }
+
+    const qreal ratio = LodPixelError / (LodToleranceMin * lod);
+    if(ratio < 1.0) {
+        return -1;
+    }
+
+    int level = qFloor(qLn(ratio) / qLn(LodToleranceStep));
+    return qMin(level, LodLevelsMax - 1);
+}
+
+/*! Returns the path for a level from levelOfDetail(); levels past the coarsest one fall back to the straight line.
+ */
+const QPainterPath &QGraphVizEdge::pathForLevel(int level) const
+{
+    if(level < 0 || m_PathLevels.isEmpty()) {
+        return m_Path;
+    }
+
+    return m_PathLevels.at(qMin(level, m_PathLevels.count() - 1));
+}
+
+/*! The edge's pen, brush and label style, from the scene's style table; valid until the next style is added
+ */
+const QGraphVizStyleTable::Style &QGraphVizEdge::style() const
+{
+    return m_GraphViz->styleTable()->style(m_Style);
+}
+
 void QGraphVizEdge::updateLabel()
 {
     textlabel_t *label = m_GraphVizEdge->u.label;
@@ -349,25 +491,26 @@ void QGraphVizEdge::updateLabel()
 
     m_LabelText = label->text;
 
+    QGraphVizStyleTable *styles = m_GraphViz->styleTable();
+    QGraphVizStyleTable::Style style = styles->style(m_Style);
 
-    m_LabelFont.setStyleHint(QFont::Serif);
-    m_LabelFont.setStyleStrategy((QFont::StyleStrategy)(QFont::PreferAntialias | QFont::PreferQuality));
+    style.labelFont.setStyleHint(QFont::Serif);
+    style.labelFont.setStyleStrategy((QFont::StyleStrategy)(QFont::PreferAntialias | QFont::PreferQuality));
 #if 0
     font.setFamily(label->fontname);    // Usually "Times New Roman"
 #else
     //! \note This was set manually in the STAT GUI, so I'm doing the same here
-    m_LabelFont.setFamily("sans-serif");
+    style.labelFont.setFamily("sans-serif");
 #endif
-    m_LabelFont.setPointSizeF(label->fontsize * .55);
+    style.labelFont.setPointSizeF(label->fontsize * .55);
 
-    m_LabelColor = QColor(label->fontcolor);
+    style.labelColor = m_GraphViz->attributes()->color(label->fontcolor, Qt::black);
 
-    m_LabelPosition = m_GraphViz->transformPoint(label->pos) - pos();
+    m_Style = styles->addStyle(style);
 
-    //HACK: Prerender to get bounding box for centering on position
-    QPainterPath path;
-    path.addText(0, 0, labelFont(), labelText());
-    m_LabelPosition -= path.boundingRect().bottomRight() / 2;
+    // Center the label on its position
+    QSizeF size = m_GraphViz->labelCache()->size(labelText(), labelFont());
+    m_LabelPosition = m_GraphViz->transformPoint(label->pos) - pos() - QPointF(size.width(), size.height()) / 2;
 
     prepareGeometryChange();
     update();
@@ -375,6 +518,8 @@ void QGraphVizEdge::updateLabel()
 
 
 
+/*! Top left corner of the label, relative to the position of the edge
+ */
 QPointF QGraphVizEdge::labelPosition()
 {
     return m_LabelPosition;
@@ -382,12 +527,12 @@ QPointF QGraphVizEdge::labelPosition()
 
 QFont QGraphVizEdge::labelFont()
 {
-    return m_LabelFont;
+    return style().labelFont;
 }
 
 QColor QGraphVizEdge::labelColor()
 {
-    return m_LabelColor;
+    return style().labelColor;
 }
 
 QString QGraphVizEdge::labelText()
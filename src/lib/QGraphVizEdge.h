@@ -34,9 +34,11 @@
 #include <graphviz/types.h>
 
 #include "QGraphVizLibrary.h"
+#include "QGraphVizStyleTable.h"
 
 class QGraphVizNode;
 class QGraphVizScene;
+class QGraphVizEdgeLayer;
 
 class QGRAPHVIZ_EXPORT QGraphVizEdge : public QGraphicsItem
 {
@@ -65,8 +67,14 @@ protected:
 
     void updateGeometry();
     void updatePath();
+    void updatePathLevels();
     void updateLabel();
 
+    static int levelOfDetail(qreal lod);
+    const QPainterPath &pathForLevel(int level) const;
+
+    const QGraphVizStyleTable::Style &style() const;
+
     virtual QPointF labelPosition();
     virtual QFont labelFont();
     virtual QColor labelColor();
@@ -75,21 +83,21 @@ protected:
 private:
     edge_t *m_GraphVizEdge;
     QGraphVizScene *m_GraphViz;
+    int m_Index;
 
-    QByteArray m_LastHash;
+    quint64 m_Generation;
 
     QRectF m_BoundingRect;
 
-    QPen m_PathPen;
-    QBrush m_PathBrush;
+    // Index into the scene's style table; the pen, brush and label style are shared with lookalike edges
+    int m_Style;
+
     QPainterPath m_Path;
     QPainterPath m_PathArrow;
-    QPainterPath m_PathSimple;
     QPainterPath m_PathArrowSimple;
+    QVector<QPainterPath> m_PathLevels;
 
     QPointF m_LabelPosition;
-    QFont m_LabelFont;
-    QColor m_LabelColor;
     QString m_LabelText;
 
     bool m_Highlighted;
@@ -99,8 +107,11 @@ private:
     QGraphVizNode *m_Head;
     QGraphVizNode *m_Tail;
 
+    QGraphVizEdgeLayer *m_Layer;
+
     friend class QGraphVizScene;
     friend class QGraphVizNode;
+    friend class QGraphVizEdgeLayer;
 };
 
 #endif // QGRAPHVIZEDGE_H
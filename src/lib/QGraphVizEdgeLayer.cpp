@@ -0,0 +1,258 @@
+/*!
+   \file
+   \author Dane Gardner <dane.gardner@gmail.com>
+   \version
+
+   \section LICENSE
+   This file is part of the Parallel Tools GUI Framework (PTGF)
+   Copyright (C) 2010-2011 Argo Navis Technologies, LLC
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+   \section DESCRIPTION
+
+ */
+
+#include "QGraphVizEdgeLayer.h"
+#include "QGraphVizScene.h"
+#include "QGraphVizEdge.h"
+#include "QGraphVizNode.h"
+#include "QGraphVizLabelCache.h"
+
+
+
+QGraphVizEdgeLayer::QGraphVizEdgeLayer(QGraphVizScene *graphViz, QGraphicsItem *parent) :
+    QGraphicsItem(parent),
+    m_GraphViz(graphViz),
+    m_Generation(0),
+    m_Dirty(true)
+{
+}
+
+int QGraphVizEdgeLayer::type() const
+{
+    return UserType + 3;
+}
+
+
+
+void QGraphVizEdgeLayer::addEdge(QGraphVizEdge *edge)
+{
+    prepareGeometryChange();
+
+    m_Edges.append(edge);
+    edge->m_Layer = this;
+
+    m_BoundingRect = m_BoundingRect.united(edge->sceneBoundingRect());
+    m_Generation = m_GraphViz->generation();
+    m_Dirty = true;
+}
+
+QList<QGraphVizEdge*> QGraphVizEdgeLayer::edges()
+{
+    return m_Edges;
+}
+
+/*! Finds the topmost edge whose stroke passes through the given scene position
+ */
+QGraphVizEdge *QGraphVizEdgeLayer::edgeAt(const QPointF &pos)
+{
+    QPainterPathStroker stroker;
+
+    for(int i = m_Edges.count() - 1; i >= 0; --i) {
+        QGraphVizEdge *edge = m_Edges.at(i);
+        if(!edge->sceneBoundingRect().contains(pos)) {
+            continue;
+        }
+
+        if(!edge->head() || !edge->tail() || !edge->head()->isVisible() || !edge->tail()->isVisible()) {
+            continue;
+        }
+
+        stroker.setWidth(qMax(edge->style().pen.widthF(), qreal(1.0)) + 4.0);
+        QPointF local = pos - edge->pos();
+        if(stroker.createStroke(edge->m_Path).contains(local) || stroker.createStroke(edge->m_PathArrow).contains(local)) {
+            return edge;
+        }
+    }
+
+    return NULL;
+}
+
+/*! Marks the batched paths as stale; they're rebuilt on the next paint.
+ */
+void QGraphVizEdgeLayer::invalidate()
+{
+    m_Dirty = true;
+}
+
+
+
+QRectF QGraphVizEdgeLayer::boundingRect() const
+{
+    return m_BoundingRect;
+}
+
+void QGraphVizEdgeLayer::updateGeometry()
+{
+    m_Generation = m_GraphViz->generation();
+
+    QRectF boundingRect;
+    foreach(QGraphVizEdge *edge, m_Edges) {
+        if(edge->m_Generation != m_Generation) {
+            edge->updateGeometry();
+        }
+        boundingRect = boundingRect.united(edge->sceneBoundingRect());
+    }
+
+    if(boundingRect != m_BoundingRect) {
+        prepareGeometryChange();
+        m_BoundingRect = boundingRect;
+    }
+
+    m_Dirty = true;
+}
+
+/*! Merges the edges into one path per pen and dim state, so the whole tile is stroked in a handful of calls.
+ */
+void QGraphVizEdgeLayer::updatePaths()
+{
+    m_Buckets.clear();
+
+    QHash<QString, int> buckets;
+    foreach(QGraphVizEdge *edge, m_Edges) {
+        QGraphVizNode *head = edge->head();
+        QGraphVizNode *tail = edge->tail();
+        if(!head || !tail || !head->isVisible() || !tail->isVisible()) {
+            continue;
+        }
+
+        if(edge->m_Path.isEmpty()) {
+            continue;
+        }
+
+        QPen pen(edge->style().pen);
+        if(edge->isHighlighted()) {
+            pen.setColor(edge->highlightColor());
+            pen.setWidthF(edge->highlightWidth());
+        }
+
+        const bool dimmed = tail->isTransparent() || tail->isCollapsed();
+
+        QString key = QString("%1|%2|%3").arg(dimmed).arg(pen.color().rgba()).arg(pen.widthF());
+        int index = buckets.value(key, -1);
+        if(index < 0) {
+            Bucket bucket;
+            bucket.pen = pen;
+            bucket.dimmed = dimmed;
+            index = m_Buckets.count();
+            m_Buckets.append(bucket);
+            buckets.insert(key, index);
+        }
+
+        Bucket &bucket = m_Buckets[index];
+        const QPointF offset = edge->pos();
+
+        bucket.path.addPath(edge->m_Path.translated(offset));
+        if(!edge->m_PathArrow.isEmpty()) {
+            bucket.pathArrow.addPath(edge->m_PathArrow.translated(offset));
+        }
+
+        bucket.edges.append(edge);
+
+        if(!edge->m_PathArrowSimple.isEmpty()) {
+            bucket.pathArrowSimple.addPath(edge->m_PathArrowSimple.translated(offset));
+        }
+    }
+
+    m_Dirty = false;
+}
+
+/*! Returns the merged path of a bucket at a level from QGraphVizEdge::levelOfDetail(), merging it on first use.
+ */
+const QPainterPath &QGraphVizEdgeLayer::bucketPath(Bucket &bucket, int level)
+{
+    if(level < 0) {
+        return bucket.path;
+    }
+
+    QHash<int, QPainterPath>::iterator iterator = bucket.levels.find(level);
+    if(iterator == bucket.levels.end()) {
+        QPainterPath path;
+        foreach(QGraphVizEdge *edge, bucket.edges) {
+            path.addPath(edge->pathForLevel(level).translated(edge->pos()));
+        }
+        iterator = bucket.levels.insert(level, path);
+    }
+
+    return iterator.value();
+}
+
+void QGraphVizEdgeLayer::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+    Q_UNUSED(widget)
+
+    if(m_Generation != m_GraphViz->generation()) {
+        updateGeometry();
+    }
+
+    if(m_Dirty) {
+        updatePaths();
+    }
+
+    const qreal lod = option->levelOfDetailFromTransform(painter->worldTransform());
+
+    // Draw paths
+    if(lod >= 0.05) {
+        painter->setBrush(Qt::NoBrush);
+
+        const int level = QGraphVizEdge::levelOfDetail(lod);
+
+        for(int i = 0; i < m_Buckets.count(); ++i) {
+            Bucket &bucket = m_Buckets[i];
+            painter->setOpacity(bucket.dimmed ? 0.15 : 1.0);
+            painter->setPen(bucket.pen);
+
+            painter->drawPath(bucketPath(bucket, level));
+
+            if(lod >= 0.25) {
+                if(!bucket.pathArrow.isEmpty()) {
+                    painter->drawPath(bucket.pathArrow);
+                }
+            } else if(lod >= 0.125 && !bucket.pathArrowSimple.isEmpty()) {
+                painter->drawPath(bucket.pathArrowSimple);
+            }
+        }
+    }
+
+    // Draw labels; there are few enough of them to do one at a time
+    if(lod >= 0.45) {
+        foreach(QGraphVizEdge *edge, m_Edges) {
+            if(edge->labelText().isEmpty()) {
+                continue;
+            }
+
+            QGraphVizNode *head = edge->head();
+            QGraphVizNode *tail = edge->tail();
+            if(!head || !tail || !head->isVisible() || !tail->isVisible()) {
+                continue;
+            }
+
+            painter->setOpacity((tail->isTransparent() || tail->isCollapsed()) ? 0.15 : 1.0);
+            painter->setPen(edge->labelColor());
+            m_GraphViz->labelCache()->draw(painter, edge->pos() + edge->labelPosition(), edge->labelText(), edge->labelFont());
+        }
+    }
+}
@@ -0,0 +1,82 @@
+/*!
+   \file
+   \author Dane Gardner <dane.gardner@gmail.com>
+   \version
+
+   \section LICENSE
+   This file is part of the Parallel Tools GUI Framework (PTGF)
+   Copyright (C) 2010-2011 Argo Navis Technologies, LLC
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+   \section DESCRIPTION
+
+ */
+
+#ifndef QGRAPHVIZEDGELAYER_H
+#define QGRAPHVIZEDGELAYER_H
+
+#include <QtCore>
+#include <QtGui>
+
+#include "QGraphVizLibrary.h"
+
+class QGraphVizScene;
+class QGraphVizEdge;
+
+class QGRAPHVIZ_EXPORT QGraphVizEdgeLayer : public QGraphicsItem
+{
+public:
+    explicit QGraphVizEdgeLayer(QGraphVizScene *graphViz, QGraphicsItem *parent = 0);
+    int type() const;
+
+    void addEdge(QGraphVizEdge *edge);
+    QList<QGraphVizEdge*> edges();
+    QGraphVizEdge *edgeAt(const QPointF &pos);
+
+    void invalidate();
+
+protected:
+    virtual QRectF boundingRect() const;
+    virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget);
+
+    void updateGeometry();
+    void updatePaths();
+
+private:
+    struct Bucket {
+        QPen pen;
+        bool dimmed;
+        QPainterPath path;
+        QPainterPath pathArrow;
+        QPainterPath pathArrowSimple;
+        QList<QGraphVizEdge*> edges;
+        QHash<int, QPainterPath> levels;   // Merged level-of-detail paths, built as the zoom calls for them
+    };
+
+    const QPainterPath &bucketPath(Bucket &bucket, int level);
+
+    QGraphVizScene *m_GraphViz;
+
+    quint64 m_Generation;
+    bool m_Dirty;
+
+    QRectF m_BoundingRect;
+
+    QList<QGraphVizEdge*> m_Edges;
+    QList<Bucket> m_Buckets;
+};
+
+#endif // QGRAPHVIZEDGELAYER_H
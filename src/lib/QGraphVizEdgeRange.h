@@ -0,0 +1,74 @@
+/*!
+   \file
+   \author Dane Gardner <dane.gardner@gmail.com>
+   \version
+
+   \section LICENSE
+   This file is part of the Parallel Tools GUI Framework (PTGF)
+   Copyright (C) 2010-2011 Argo Navis Technologies, LLC
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+   \section DESCRIPTION
+
+ */
+
+#ifndef QGRAPHVIZEDGERANGE_H
+#define QGRAPHVIZEDGERANGE_H
+
+#include <QtCore>
+
+class QGraphVizEdge;
+
+/*! A lightweight, read-only view into the scene's adjacency index.  It doesn't own anything, so it's cheap to copy
+    and works with foreach(); but it's only valid until items are added to, or removed from, the scene.
+ */
+class QGraphVizEdgeRange
+{
+public:
+    typedef QGraphVizEdge * const * const_iterator;
+    typedef const_iterator iterator;
+
+    QGraphVizEdgeRange() : m_Begin(NULL), m_End(NULL) {}
+    QGraphVizEdgeRange(const_iterator begin, const_iterator end) : m_Begin(begin), m_End(end) {}
+
+    const_iterator begin() const { return m_Begin; }
+    const_iterator end() const { return m_End; }
+    const_iterator constBegin() const { return m_Begin; }
+    const_iterator constEnd() const { return m_End; }
+
+    int count() const { return m_End - m_Begin; }
+    int size() const { return m_End - m_Begin; }
+    bool isEmpty() const { return m_Begin == m_End; }
+
+    QGraphVizEdge *at(int i) const { Q_ASSERT(i >= 0 && i < count()); return m_Begin[i]; }
+    QGraphVizEdge *operator[](int i) const { return at(i); }
+
+    QList<QGraphVizEdge*> toList() const
+    {
+        QList<QGraphVizEdge*> list;
+        list.reserve(count());
+        for(const_iterator i = m_Begin; i != m_End; ++i) {
+            list.append(*i);
+        }
+        return list;
+    }
+
+private:
+    const_iterator m_Begin;
+    const_iterator m_End;
+};
+
+#endif // QGRAPHVIZEDGERANGE_H
@@ -0,0 +1,431 @@
+/*!
+   \file
+   \author Dane Gardner <dane.gardner@gmail.com>
+   \version
+
+   \section LICENSE
+   This file is part of the Parallel Tools GUI Framework (PTGF)
+   Copyright (C) 2010-2011 Argo Navis Technologies, LLC
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+   \section DESCRIPTION
+
+ */
+
+#include "QGraphVizGeometry.h"
+
+#include <graphviz/graph.h>
+
+
+
+QGraphVizGeometry::QGraphVizGeometry()
+{
+}
+
+bool QGraphVizGeometry::isEmpty() const
+{
+    return m_Nodes.isEmpty();
+}
+
+QRectF QGraphVizGeometry::boundingBox() const
+{
+    return m_BoundingBox;
+}
+
+void QGraphVizGeometry::setBoundingBox(const QRectF &boundingBox)
+{
+    m_BoundingBox = boundingBox;
+}
+
+/*! Moves everything, bounding box included, by the offset
+ */
+void QGraphVizGeometry::translate(const QPointF &offset)
+{
+    m_BoundingBox.translate(offset);
+
+    for(int i = 0; i < m_Nodes.count(); ++i) {
+        m_Nodes[i].position += offset;
+    }
+
+    for(int i = 0; i < m_Edges.count(); ++i) {
+        Edge &edge = m_Edges[i];
+        for(int j = 0; j < edge.splines.count(); ++j) {
+            Spline &spline = edge.splines[j];
+            for(int k = 0; k < spline.points.count(); ++k) {
+                spline.points[k] += offset;
+            }
+            spline.start += offset;
+            spline.end += offset;
+        }
+        edge.labelPosition += offset;
+    }
+}
+
+const QVector<QGraphVizGeometry::Node> &QGraphVizGeometry::nodes() const
+{
+    return m_Nodes;
+}
+
+void QGraphVizGeometry::addNode(const Node &node)
+{
+    m_Nodes.append(node);
+}
+
+const QVector<QGraphVizGeometry::Edge> &QGraphVizGeometry::edges() const
+{
+    return m_Edges;
+}
+
+void QGraphVizGeometry::addEdge(const Edge &edge)
+{
+    m_Edges.append(edge);
+}
+
+QByteArray QGraphVizGeometry::edgeKey(const QByteArray &tail, const QByteArray &head, int ordinal)
+{
+    return tail + '\0' + head + '\0' + QByteArray::number(ordinal);
+}
+
+
+
+/*! Reads the geometry out of a graph that has been through gvLayout()
+ */
+QGraphVizGeometry QGraphVizGeometry::fromGraph(graph_t *graph)
+{
+    QGraphVizGeometry geometry;
+    if(!graph) {
+        return geometry;
+    }
+
+    geometry.m_BoundingBox = QRectF(QPointF(graph->u.bb.LL.x, graph->u.bb.LL.y),
+                                    QPointF(graph->u.bb.UR.x, graph->u.bb.UR.y));
+
+    for(node_t *node = agfstnode(graph); node; node = agnxtnode(graph, node)) {
+        Node geometryNode;
+        geometryNode.name = node->name;
+        geometryNode.position = QPointF(node->u.coord.x, node->u.coord.y);
+        geometryNode.size = QSizeF(node->u.width * 72.0, node->u.height * 72.0);
+        geometry.m_Nodes.append(geometryNode);
+
+        QHash<node_t*, int> ordinals;
+        for(edge_t *edge = agfstout(graph, node); edge; edge = agnxtout(graph, edge)) {
+            Edge geometryEdge;
+            geometryEdge.tail = edge->tail->name;
+            geometryEdge.head = edge->head->name;
+            geometryEdge.ordinal = ordinals[edge->head]++;
+            geometryEdge.hasLabel = false;
+
+            if(edge->u.spl) {
+                for(int i = 0; i < edge->u.spl->size; ++i) {
+                    const bezier &bez = edge->u.spl->list[i];
+
+                    Spline spline;
+                    spline.points.reserve(bez.size);
+                    for(int j = 0; j < bez.size; ++j) {
+                        spline.points.append(QPointF(bez.list[j].x, bez.list[j].y));
+                    }
+                    spline.hasStart = bez.sflag;
+                    spline.start = QPointF(bez.sp.x, bez.sp.y);
+                    spline.hasEnd = bez.eflag;
+                    spline.end = QPointF(bez.ep.x, bez.ep.y);
+                    geometryEdge.splines.append(spline);
+                }
+            }
+
+            if(edge->u.label && edge->u.label->set) {
+                geometryEdge.hasLabel = true;
+                geometryEdge.labelPosition = QPointF(edge->u.label->pos.x, edge->u.label->pos.y);
+            }
+
+            geometry.m_Edges.append(geometryEdge);
+        }
+    }
+
+    return geometry;
+}
+
+/*! Formats a point as GraphViz writes it in pos, lp and bb
+ */
+static void appendPoint(QByteArray &text, const QPointF &point)
+{
+    char buffer[64];
+    text.append(buffer, qsnprintf(buffer, sizeof(buffer), "%.2f,%.2f", double(point.x()), double(point.y())));
+}
+
+/*! Sets one attribute on objects of one kind, keeping what each had before.  The symbol is looked up (or declared,
+    empty by default) on the first object, and reused for the rest; an object that didn't have the attribute counts
+    as having it empty, which is what GraphViz takes as unset.
+ */
+class QGraphVizAttributeSetter
+{
+public:
+    QGraphVizAttributeSetter(const char *name, QVector<QGraphVizGeometry::Attribute> &previous) :
+        m_Name(name),
+        m_Symbol(NULL),
+        m_Previous(previous)
+    {
+    }
+
+    void set(void *object, const QByteArray &value)
+    {
+        if(!m_Symbol) {
+            m_Symbol = agfindattr(object, const_cast<char*>(m_Name));
+        }
+
+        if(!m_Symbol) {
+            agsafeset(object, const_cast<char*>(m_Name), const_cast<char*>(value.constData()), (char*)"");
+            m_Symbol = agfindattr(object, const_cast<char*>(m_Name));
+            if(!m_Symbol) {
+                return;
+            }
+            append(object, QByteArray());
+            return;
+        }
+
+        append(object, QByteArray(agxget(object, m_Symbol->index)));
+        agxset(object, m_Symbol->index, const_cast<char*>(value.constData()));
+    }
+
+private:
+    void append(void *object, const QByteArray &value)
+    {
+        QGraphVizGeometry::Attribute attribute;
+        attribute.object = object;
+        attribute.symbol = m_Symbol->index;
+        attribute.value = value;
+        m_Previous.append(attribute);
+    }
+
+    const char *m_Name;
+    Agsym_t *m_Symbol;
+    QVector<QGraphVizGeometry::Attribute> &m_Previous;
+};
+
+/*! The attribute values applyTo() writes, formatted ahead of time; this makes no GraphViz calls, so it can be done
+    without holding whatever lock guards GraphViz.  Edges without splines get no value, and applyTo() turns down any
+    graph that has one.  Nodes with a size get it pinned, since the edges were clipped to it; those without keep
+    whatever size GraphViz gives them.
+ */
+QGraphVizGeometry::Formatted QGraphVizGeometry::format() const
+{
+    Formatted formatted;
+
+    formatted.nodes.reserve(m_Nodes.count());
+    formatted.nodePositions.resize(m_Nodes.count());
+    formatted.nodeWidths.resize(m_Nodes.count());
+    formatted.nodeHeights.resize(m_Nodes.count());
+
+    char buffer[32];
+    for(int i = 0; i < m_Nodes.count(); ++i) {
+        const Node &node = m_Nodes.at(i);
+        formatted.nodes.insert(node.name, i);
+        appendPoint(formatted.nodePositions[i], node.position);
+
+        if(node.size.isValid()) {
+            formatted.nodeWidths[i] = QByteArray(buffer, qsnprintf(buffer, sizeof(buffer), "%.4f", double(node.size.width() / 72.0)));
+            formatted.nodeHeights[i] = QByteArray(buffer, qsnprintf(buffer, sizeof(buffer), "%.4f", double(node.size.height() / 72.0)));
+        }
+    }
+
+    formatted.edges.reserve(m_Edges.count());
+    formatted.edgePositions.resize(m_Edges.count());
+    formatted.edgeLabelPositions.resize(m_Edges.count());
+    for(int i = 0; i < m_Edges.count(); ++i) {
+        const Edge &edge = m_Edges.at(i);
+        formatted.edges.insert(edgeKey(edge.tail, edge.head, edge.ordinal), i);
+
+        QByteArray &pos = formatted.edgePositions[i];
+        foreach(const Spline &spline, edge.splines) {
+            if(!pos.isEmpty()) {
+                pos += ';';
+            }
+            if(spline.hasStart) {
+                pos += "s,";
+                appendPoint(pos, spline.start);
+                pos += ' ';
+            }
+            if(spline.hasEnd) {
+                pos += "e,";
+                appendPoint(pos, spline.end);
+                pos += ' ';
+            }
+            for(int j = 0; j < spline.points.count(); ++j) {
+                if(j) {
+                    pos += ' ';
+                }
+                appendPoint(pos, spline.points.at(j));
+            }
+        }
+
+        if(edge.hasLabel) {
+            appendPoint(formatted.edgeLabelPositions[i], edge.labelPosition);
+        }
+    }
+
+    if(!m_BoundingBox.isNull()) {
+        appendPoint(formatted.boundingBox, m_BoundingBox.topLeft());
+        formatted.boundingBox += ',';
+        appendPoint(formatted.boundingBox, m_BoundingBox.bottomRight());
+    }
+
+    return formatted;
+}
+
+/*! Writes the formatted geometry into the graph's pos, lp and bb attributes, and the node sizes into width, height
+    and fixedsize, in the form the layoutEngine() pass-through reads back; GraphViz still builds the node shapes and
+    labels as usual, at the sizes the edges were routed for.  Returns false, without
+    touching the graph, if any node or edge in the graph has no geometry.
+
+    The values the attributes had before are added to previous; once the pass-through engine has run, restore() has
+    to put them back, or the next layout of the graph with a real engine would start from this one.
+ */
+bool QGraphVizGeometry::applyTo(graph_t *graph, const Formatted &formatted, QVector<Attribute> &previous)
+{
+    if(!graph) {
+        return false;
+    }
+
+    // Match everything up before changing anything
+    QVector<QPair<node_t*, int> > nodeMatches;
+    QVector<QPair<edge_t*, int> > edgeMatches;
+    for(node_t *node = agfstnode(graph); node; node = agnxtnode(graph, node)) {
+        const int nodeIndex = formatted.nodes.value(QByteArray::fromRawData(node->name, qstrlen(node->name)), -1);
+        if(nodeIndex < 0) {
+            return false;
+        }
+        nodeMatches.append(qMakePair(node, nodeIndex));
+
+        QHash<node_t*, int> ordinals;
+        for(edge_t *edge = agfstout(graph, node); edge; edge = agnxtout(graph, edge)) {
+            const int edgeIndex = formatted.edges.value(edgeKey(edge->tail->name, edge->head->name, ordinals[edge->head]++), -1);
+            if(edgeIndex < 0 || formatted.edgePositions.at(edgeIndex).isEmpty()) {
+                return false;
+            }
+            edgeMatches.append(qMakePair(edge, edgeIndex));
+        }
+    }
+
+    previous.reserve(previous.count() + nodeMatches.count() * 4 + edgeMatches.count() * 2 + 2);
+
+    QGraphVizAttributeSetter nodePos("pos", previous);
+    for(int i = 0; i < nodeMatches.count(); ++i) {
+        nodePos.set(nodeMatches.at(i).first, formatted.nodePositions.at(nodeMatches.at(i).second));
+    }
+
+    QGraphVizAttributeSetter width("width", previous);
+    QGraphVizAttributeSetter height("height", previous);
+    QGraphVizAttributeSetter fixedSize("fixedsize", previous);
+    const QByteArray fixed("true");
+    for(int i = 0; i < nodeMatches.count(); ++i) {
+        const int nodeIndex = nodeMatches.at(i).second;
+        if(!formatted.nodeWidths.at(nodeIndex).isEmpty()) {
+            width.set(nodeMatches.at(i).first, formatted.nodeWidths.at(nodeIndex));
+            height.set(nodeMatches.at(i).first, formatted.nodeHeights.at(nodeIndex));
+            fixedSize.set(nodeMatches.at(i).first, fixed);
+        }
+    }
+
+    QGraphVizAttributeSetter edgePos("pos", previous);
+    QGraphVizAttributeSetter labelPos("lp", previous);
+    for(int i = 0; i < edgeMatches.count(); ++i) {
+        const int edgeIndex = edgeMatches.at(i).second;
+        edgePos.set(edgeMatches.at(i).first, formatted.edgePositions.at(edgeIndex));
+        if(!formatted.edgeLabelPositions.at(edgeIndex).isEmpty()) {
+            labelPos.set(edgeMatches.at(i).first, formatted.edgeLabelPositions.at(edgeIndex));
+        }
+    }
+
+    if(!formatted.boundingBox.isEmpty()) {
+        QGraphVizAttributeSetter("bb", previous).set(graph, formatted.boundingBox);
+    }
+    QGraphVizAttributeSetter("notranslate", previous).set(graph, QByteArray("true"));
+
+    return true;
+}
+
+/*! Puts back the attribute values applyTo() replaced, newest first, so an attribute set twice ends up as it started
+ */
+void QGraphVizGeometry::restore(const QVector<Attribute> &previous)
+{
+    for(int i = previous.count() - 1; i >= 0; --i) {
+        const Attribute &attribute = previous.at(i);
+        agxset(attribute.object, attribute.symbol, const_cast<char*>(attribute.value.constData()));
+    }
+}
+
+/*! The GraphViz layout engine (neato -n2) that takes the positions and splines written by applyTo() as they are
+ */
+const char *QGraphVizGeometry::layoutEngine()
+{
+    return "nop2";
+}
+
+
+
+QDataStream &operator<<(QDataStream &stream, const QGraphVizGeometry::Spline &spline)
+{
+    stream << spline.points << spline.hasStart << spline.start << spline.hasEnd << spline.end;
+    return stream;
+}
+
+QDataStream &operator>>(QDataStream &stream, QGraphVizGeometry::Spline &spline)
+{
+    stream >> spline.points >> spline.hasStart >> spline.start >> spline.hasEnd >> spline.end;
+    return stream;
+}
+
+QDataStream &operator<<(QDataStream &stream, const QGraphVizGeometry &geometry)
+{
+    stream << geometry.m_BoundingBox;
+
+    stream << (quint32)geometry.m_Nodes.count();
+    foreach(const QGraphVizGeometry::Node &node, geometry.m_Nodes) {
+        stream << node.name << node.position << node.size;
+    }
+
+    stream << (quint32)geometry.m_Edges.count();
+    foreach(const QGraphVizGeometry::Edge &edge, geometry.m_Edges) {
+        stream << edge.tail << edge.head << (qint32)edge.ordinal << edge.splines << edge.hasLabel << edge.labelPosition;
+    }
+
+    return stream;
+}
+
+QDataStream &operator>>(QDataStream &stream, QGraphVizGeometry &geometry)
+{
+    geometry = QGraphVizGeometry();
+
+    stream >> geometry.m_BoundingBox;
+
+    quint32 count;
+    stream >> count;
+    for(quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QGraphVizGeometry::Node node;
+        stream >> node.name >> node.position >> node.size;
+        geometry.m_Nodes.append(node);
+    }
+
+    stream >> count;
+    for(quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QGraphVizGeometry::Edge edge;
+        qint32 ordinal;
+        stream >> edge.tail >> edge.head >> ordinal >> edge.splines >> edge.hasLabel >> edge.labelPosition;
+        edge.ordinal = ordinal;
+        geometry.m_Edges.append(edge);
+    }
+
+    return stream;
+}
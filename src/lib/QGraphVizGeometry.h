@@ -0,0 +1,121 @@
+/*!
+   \file
+   \author Dane Gardner <dane.gardner@gmail.com>
+   \version
+
+   \section LICENSE
+   This file is part of the Parallel Tools GUI Framework (PTGF)
+   Copyright (C) 2010-2011 Argo Navis Technologies, LLC
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+   \section DESCRIPTION
+
+ */
+
+#ifndef QGRAPHVIZGEOMETRY_H
+#define QGRAPHVIZGEOMETRY_H
+
+#include <QtCore>
+
+#include <graphviz/types.h>
+
+#include "QGraphVizLibrary.h"
+
+/*! Positions, splines and label positions of a laid out graph, in GraphViz coordinates (points, y up), detached from
+    any graph_t.  Nodes are matched by name, and edges by their tail and head names plus their ordinal among parallel
+    edges, so geometry taken from one graph can be applied to another parse of the same content.
+ */
+class QGRAPHVIZ_EXPORT QGraphVizGeometry
+{
+public:
+    struct Node {
+        QByteArray name;
+        QPointF position;
+        QSizeF size;
+    };
+
+    struct Spline {
+        QVector<QPointF> points;
+        bool hasStart;
+        QPointF start;
+        bool hasEnd;
+        QPointF end;
+    };
+
+    struct Edge {
+        QByteArray tail;
+        QByteArray head;
+        int ordinal;
+        QList<Spline> splines;
+        bool hasLabel;
+        QPointF labelPosition;
+    };
+
+    // The attribute values applyTo() writes, by node and edge index; see format()
+    struct Formatted {
+        QHash<QByteArray, int> nodes;
+        QHash<QByteArray, int> edges;
+        QVector<QByteArray> nodePositions;
+        QVector<QByteArray> nodeWidths;
+        QVector<QByteArray> nodeHeights;
+        QVector<QByteArray> edgePositions;
+        QVector<QByteArray> edgeLabelPositions;
+        QByteArray boundingBox;
+    };
+
+    // An attribute value on a node, edge or graph, as it was before applyTo() set it
+    struct Attribute {
+        void *object;
+        int symbol;
+        QByteArray value;
+    };
+
+    QGraphVizGeometry();
+
+    bool isEmpty() const;
+
+    QRectF boundingBox() const;
+    void setBoundingBox(const QRectF &boundingBox);
+    void translate(const QPointF &offset);
+
+    const QVector<Node> &nodes() const;
+    void addNode(const Node &node);
+
+    const QVector<Edge> &edges() const;
+    void addEdge(const Edge &edge);
+
+    static QGraphVizGeometry fromGraph(graph_t *graph);
+    Formatted format() const;
+    static bool applyTo(graph_t *graph, const Formatted &formatted, QVector<Attribute> &previous);
+    static void restore(const QVector<Attribute> &previous);
+
+    static const char *layoutEngine();
+
+private:
+    static QByteArray edgeKey(const QByteArray &tail, const QByteArray &head, int ordinal);
+
+    QRectF m_BoundingBox;
+    QVector<Node> m_Nodes;
+    QVector<Edge> m_Edges;
+
+    friend QGRAPHVIZ_EXPORT QDataStream &operator<<(QDataStream &stream, const QGraphVizGeometry &geometry);
+    friend QGRAPHVIZ_EXPORT QDataStream &operator>>(QDataStream &stream, QGraphVizGeometry &geometry);
+};
+
+QGRAPHVIZ_EXPORT QDataStream &operator<<(QDataStream &stream, const QGraphVizGeometry &geometry);
+QGRAPHVIZ_EXPORT QDataStream &operator>>(QDataStream &stream, QGraphVizGeometry &geometry);
+
+#endif // QGRAPHVIZGEOMETRY_H
@@ -0,0 +1,127 @@
+/*!
+   \file
+   \author Dane Gardner <dane.gardner@gmail.com>
+   \version
+
+   \section LICENSE
+   This file is part of the Parallel Tools GUI Framework (PTGF)
+   Copyright (C) 2010-2011 Argo Navis Technologies, LLC
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+   \section DESCRIPTION
+
+ */
+
+#include "QGraphVizLabelCache.h"
+
+
+
+QGraphVizLabelCache::QGraphVizLabelCache(QObject *parent) :
+    QObject(parent),
+    m_Cache(16384)
+{
+}
+
+/*! The cache size is given in labels; each distinct text, font, width and layout option is one label
+ */
+int QGraphVizLabelCache::cacheLimit()
+{
+    return m_Cache.maxCost();
+}
+
+void QGraphVizLabelCache::setCacheLimit(int labels)
+{
+    // QCache deletes anything inserted past its limit, and staticText() hands out what it just inserted
+    m_Cache.setMaxCost(qMax(1, labels));
+}
+
+void QGraphVizLabelCache::clearCache()
+{
+    m_Cache.clear();
+}
+
+
+
+/*! Returns the laid out size of the text; a negative textWidth lays it out on a single line
+ */
+QSizeF QGraphVizLabelCache::size(const QString &text, const QFont &font, qreal textWidth, const QTextOption &option)
+{
+    if(text.isEmpty()) {
+        return QSizeF();
+    }
+
+    return staticText(text, font, textWidth, option)->size();
+}
+
+/*! Draws the text with its top left corner at the given position, using the current pen
+ */
+void QGraphVizLabelCache::draw(QPainter *painter, const QPointF &topLeft, const QString &text, const QFont &font,
+                               qreal textWidth, const QTextOption &option)
+{
+    if(text.isEmpty()) {
+        return;
+    }
+
+    QStaticText *label = staticText(text, font, textWidth, option);
+    painter->setFont(font);
+    painter->drawStaticText(topLeft, *label);
+}
+
+/*! Draws the text wrapped to the width of rect and centered vertically within it; horizontal placement follows the
+    alignment in option, as with QPainter::drawText()
+ */
+void QGraphVizLabelCache::draw(QPainter *painter, const QRectF &rect, const QString &text, const QFont &font,
+                               const QTextOption &option)
+{
+    if(text.isEmpty()) {
+        return;
+    }
+
+    QStaticText *label = staticText(text, font, rect.width(), option);
+    QPointF topLeft(rect.left(), rect.center().y() - (label->size().height() / 2));
+
+    painter->setFont(font);
+    painter->drawStaticText(topLeft, *label);
+}
+
+
+
+/*! Finds or lays out the text.  Items with identical labels share one layout, so it's done once per distinct label
+    rather than on every paint of every item.
+ */
+QStaticText *QGraphVizLabelCache::staticText(const QString &text, const QFont &font, qreal textWidth, const QTextOption &option)
+{
+    const QString key = QString("%1|%2|%3|%4|")
+            .arg(font.key())
+            .arg(textWidth)
+            .arg((int)option.alignment())
+            .arg((int)option.wrapMode())
+            + text;
+
+    QStaticText *label = m_Cache.object(key);
+    if(!label) {
+        label = new QStaticText(text);
+        label->setTextFormat(Qt::PlainText);
+        label->setTextWidth(textWidth);
+        label->setTextOption(option);
+        label->setPerformanceHint(QStaticText::AggressiveCaching);
+        label->prepare(QTransform(), font);
+
+        m_Cache.insert(key, label);
+    }
+
+    return label;
+}
@@ -0,0 +1,64 @@
+/*!
+   \file
+   \author Dane Gardner <dane.gardner@gmail.com>
+   \version
+
+   \section LICENSE
+   This file is part of the Parallel Tools GUI Framework (PTGF)
+   Copyright (C) 2010-2011 Argo Navis Technologies, LLC
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+   \section DESCRIPTION
+
+ */
+
+#ifndef QGRAPHVIZLABELCACHE_H
+#define QGRAPHVIZLABELCACHE_H
+
+#include <QtCore>
+#include <QtGui>
+
+#include "QGraphVizLibrary.h"
+
+class QGRAPHVIZ_EXPORT QGraphVizLabelCache : public QObject
+{
+    Q_OBJECT
+public:
+    explicit QGraphVizLabelCache(QObject *parent = 0);
+
+    int cacheLimit();
+    void setCacheLimit(int labels);
+
+    QSizeF size(const QString &text, const QFont &font, qreal textWidth = -1.0,
+                const QTextOption &option = QTextOption());
+
+    void draw(QPainter *painter, const QPointF &topLeft, const QString &text, const QFont &font,
+              qreal textWidth = -1.0, const QTextOption &option = QTextOption());
+    void draw(QPainter *painter, const QRectF &rect, const QString &text, const QFont &font,
+              const QTextOption &option = QTextOption());
+
+public slots:
+    void clearCache();
+
+protected:
+    QStaticText *staticText(const QString &text, const QFont &font, qreal textWidth, const QTextOption &option);
+
+private:
+    QCache<QString, QStaticText> m_Cache;
+
+};
+
+#endif // QGRAPHVIZLABELCACHE_H
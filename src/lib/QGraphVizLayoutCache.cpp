@@ -0,0 +1,271 @@
+/*!
+   \file
+   \author Dane Gardner <dane.gardner@gmail.com>
+   \version
+
+   \section LICENSE
+   This file is part of the Parallel Tools GUI Framework (PTGF)
+   Copyright (C) 2010-2011 Argo Navis Technologies, LLC
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+   \section DESCRIPTION
+
+ */
+
+#include "QGraphVizLayoutCache.h"
+
+#include <QtGui>
+
+#if defined(Q_OS_WIN)
+#  include <sys/utime.h>
+#else
+#  include <utime.h>
+#endif
+
+#include "QGraphVizGeometry.h"
+
+// Identifies a cache file, and the version of its layout; bump the version whenever the format changes
+#define LAYOUT_CACHE_MAGIC 0x5147564c
+#define LAYOUT_CACHE_VERSION 2
+#define LAYOUT_CACHE_SUFFIX ".qgvl"
+
+
+
+/*! A directory of laid out graphs, keyed by a hash of the DOT content and the layout engine.  Entries are evicted
+    least recently used first, once the cache grows past its size or entry limits.  The cache can be shared by any
+    number of scenes, and used from any thread.
+
+    The default directory is "layouts" in the platform's cache location.
+ */
+QGraphVizLayoutCache::QGraphVizLayoutCache(QString directory, QObject *parent) :
+    QObject(parent),
+    m_MaximumSize(256 * 1024 * 1024),
+    m_MaximumEntries(0)
+{
+    if(directory.isEmpty()) {
+        directory = QDir(QDesktopServices::storageLocation(QDesktopServices::CacheLocation)).filePath("layouts");
+    }
+
+    setDirectory(directory);
+}
+
+QString QGraphVizLayoutCache::directory()
+{
+    QMutexLocker locker(&m_Mutex);
+    return m_Directory;
+}
+
+void QGraphVizLayoutCache::setDirectory(QString directory)
+{
+    QMutexLocker locker(&m_Mutex);
+    m_Directory = directory;
+    QDir().mkpath(m_Directory);
+}
+
+/*! The total size of the cache files, in bytes; zero is unlimited
+ */
+qint64 QGraphVizLayoutCache::maximumSize()
+{
+    QMutexLocker locker(&m_Mutex);
+    return m_MaximumSize;
+}
+
+void QGraphVizLayoutCache::setMaximumSize(qint64 bytes)
+{
+    {
+        QMutexLocker locker(&m_Mutex);
+        m_MaximumSize = bytes;
+    }
+    evict();
+}
+
+/*! The number of cached layouts; zero is unlimited
+ */
+int QGraphVizLayoutCache::maximumEntries()
+{
+    QMutexLocker locker(&m_Mutex);
+    return m_MaximumEntries;
+}
+
+void QGraphVizLayoutCache::setMaximumEntries(int entries)
+{
+    {
+        QMutexLocker locker(&m_Mutex);
+        m_MaximumEntries = entries;
+    }
+    evict();
+}
+
+qint64 QGraphVizLayoutCache::size()
+{
+    QMutexLocker locker(&m_Mutex);
+
+    qint64 size = 0;
+    foreach(const QFileInfo &entry, entries()) {
+        size += entry.size();
+    }
+    return size;
+}
+
+int QGraphVizLayoutCache::count()
+{
+    QMutexLocker locker(&m_Mutex);
+    return entries().count();
+}
+
+
+
+QByteArray QGraphVizLayoutCache::key(const QByteArray &content, const QString &layoutEngine)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArray::number(LAYOUT_CACHE_VERSION));
+    hash.addData(layoutEngine.toLatin1());
+    hash.addData("\0", 1);
+    hash.addData(content);
+    return hash.result().toHex();
+}
+
+bool QGraphVizLayoutCache::find(const QByteArray &key, QGraphVizGeometry &geometry)
+{
+    QMutexLocker locker(&m_Mutex);
+
+    QFile file(fileName(key));
+    if(!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_4_7);
+    stream.setFloatingPointPrecision(QDataStream::DoublePrecision);
+
+    quint32 magic, version;
+    stream >> magic >> version;
+    if(magic != LAYOUT_CACHE_MAGIC || version != LAYOUT_CACHE_VERSION) {
+        file.remove();
+        return false;
+    }
+
+    stream >> geometry;
+    if(stream.status() != QDataStream::Ok || geometry.isEmpty()) {
+        file.remove();
+        geometry = QGraphVizGeometry();
+        return false;
+    }
+
+    file.close();
+
+    // Eviction goes by modification time, so a hit makes the entry the most recently used
+    utime(QFile::encodeName(file.fileName()).constData(), NULL);
+
+    return true;
+}
+
+void QGraphVizLayoutCache::insert(const QByteArray &key, const QGraphVizGeometry &geometry)
+{
+    if(geometry.isEmpty()) {
+        return;
+    }
+
+    {
+        QMutexLocker locker(&m_Mutex);
+
+        // Write to a temporary file and rename it into place, so a reader never sees half an entry
+        const QString name = fileName(key);
+        QFile file(QString("%1.%2.tmp").arg(name).arg(QCoreApplication::applicationPid()));
+        if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            return;
+        }
+
+        QDataStream stream(&file);
+        stream.setVersion(QDataStream::Qt_4_7);
+        stream.setFloatingPointPrecision(QDataStream::DoublePrecision);
+        stream << (quint32)LAYOUT_CACHE_MAGIC << (quint32)LAYOUT_CACHE_VERSION << geometry;
+
+        if(stream.status() != QDataStream::Ok || file.error() != QFile::NoError) {
+            file.close();
+            file.remove();
+            return;
+        }
+
+        file.close();
+        QFile::remove(name);
+        if(!file.rename(name)) {
+            file.remove();
+            return;
+        }
+    }
+
+    evict();
+}
+
+void QGraphVizLayoutCache::remove(const QByteArray &key)
+{
+    QMutexLocker locker(&m_Mutex);
+    QFile::remove(fileName(key));
+}
+
+void QGraphVizLayoutCache::clear()
+{
+    QMutexLocker locker(&m_Mutex);
+    foreach(const QFileInfo &entry, entries()) {
+        QFile::remove(entry.absoluteFilePath());
+    }
+}
+
+/*! Removes the least recently used entries until the cache is within its limits
+ */
+void QGraphVizLayoutCache::evict()
+{
+    QMutexLocker locker(&m_Mutex);
+
+    if(m_MaximumSize <= 0 && m_MaximumEntries <= 0) {
+        return;
+    }
+
+    QFileInfoList list = entries();  // Oldest first
+
+    qint64 size = 0;
+    foreach(const QFileInfo &entry, list) {
+        size += entry.size();
+    }
+
+    int count = list.count();
+    for(int i = 0; i < list.count(); ++i) {
+        const bool tooBig = m_MaximumSize > 0 && size > m_MaximumSize;
+        const bool tooMany = m_MaximumEntries > 0 && count > m_MaximumEntries;
+        if(!tooBig && !tooMany) {
+            break;
+        }
+
+        if(QFile::remove(list.at(i).absoluteFilePath())) {
+            size -= list.at(i).size();
+            --count;
+        }
+    }
+}
+
+
+
+QString QGraphVizLayoutCache::fileName(const QByteArray &key)
+{
+    return QDir(m_Directory).filePath(QString(key) + LAYOUT_CACHE_SUFFIX);
+}
+
+QFileInfoList QGraphVizLayoutCache::entries()
+{
+    QDir dir(m_Directory);
+    return dir.entryInfoList(QStringList() << QString("*") + LAYOUT_CACHE_SUFFIX, QDir::Files, QDir::Time | QDir::Reversed);
+}
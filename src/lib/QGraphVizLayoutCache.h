@@ -0,0 +1,77 @@
+/*!
+   \file
+   \author Dane Gardner <dane.gardner@gmail.com>
+   \version
+
+   \section LICENSE
+   This file is part of the Parallel Tools GUI Framework (PTGF)
+   Copyright (C) 2010-2011 Argo Navis Technologies, LLC
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+   \section DESCRIPTION
+
+ */
+
+#ifndef QGRAPHVIZLAYOUTCACHE_H
+#define QGRAPHVIZLAYOUTCACHE_H
+
+#include <QtCore>
+
+#include "QGraphVizLibrary.h"
+
+class QGraphVizGeometry;
+
+class QGRAPHVIZ_EXPORT QGraphVizLayoutCache : public QObject
+{
+    Q_OBJECT
+public:
+    explicit QGraphVizLayoutCache(QString directory = QString(), QObject *parent = 0);
+
+    QString directory();
+    void setDirectory(QString directory);
+
+    qint64 maximumSize();
+    void setMaximumSize(qint64 bytes);
+
+    int maximumEntries();
+    void setMaximumEntries(int entries);
+
+    qint64 size();
+    int count();
+
+    static QByteArray key(const QByteArray &content, const QString &layoutEngine);
+
+    bool find(const QByteArray &key, QGraphVizGeometry &geometry);
+    void insert(const QByteArray &key, const QGraphVizGeometry &geometry);
+    void remove(const QByteArray &key);
+
+public slots:
+    void clear();
+    void evict();
+
+protected:
+    QString fileName(const QByteArray &key);
+    QFileInfoList entries();
+
+private:
+    QMutex m_Mutex;
+    QString m_Directory;
+    qint64 m_MaximumSize;
+    int m_MaximumEntries;
+
+};
+
+#endif // QGRAPHVIZLAYOUTCACHE_H
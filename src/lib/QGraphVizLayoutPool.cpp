@@ -0,0 +1,331 @@
+/*!
+   \file
+   \author Dane Gardner <dane.gardner@gmail.com>
+   \version
+
+   \section LICENSE
+   This file is part of the Parallel Tools GUI Framework (PTGF)
+   Copyright (C) 2010-2011 Argo Navis Technologies, LLC
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+   \section DESCRIPTION
+
+ */
+
+
+#include "QGraphVizLayoutPool.h"
+
+#include "QGraphVizGeometry.h"
+
+// Identifies the worker's input and results, and the version of their layout; bump it whenever the format changes
+#define LAYOUT_POOL_MAGIC 0x51475657
+#define LAYOUT_POOL_VERSION 3
+
+
+
+/*! The pool defaultPool() hands out; created on first use, and kept for as long as the process runs
+ */
+QMutex QGraphVizLayoutPool::m_DefaultPoolMutex;
+QGraphVizLayoutPool *QGraphVizLayoutPool::m_DefaultPool = NULL;
+bool QGraphVizLayoutPool::m_DefaultPoolChecked = false;
+
+
+/*! Lays graphs out in worker processes (the LayoutQGraphViz helper built alongside the library) instead of in the
+    calling process; DOT content goes down the worker's standard input, and the geometry comes back on its standard
+    output.  Each layout gets a fresh worker, at most maximumWorkers() at a time, which is killed if it runs past the
+    timeout, and can't allocate more than the memory limit.  The pool can be shared by any number of scenes, and used
+    from any thread.
+
+    The default program is the helper next to the application, or else the one on the path.
+ */
+QGraphVizLayoutPool::QGraphVizLayoutPool(QString program, QObject *parent) :
+    QObject(parent),
+    m_MaximumWorkers(QThread::idealThreadCount()),
+    m_Workers(0),
+    m_Timeout(0),
+    m_MemoryLimit(0)
+{
+    if(program.isEmpty()) {
+        program = defaultProgram();
+    }
+
+    setProgram(program);
+}
+
+QString QGraphVizLayoutPool::program()
+{
+    QMutexLocker locker(&m_Mutex);
+    return m_Program;
+}
+
+void QGraphVizLayoutPool::setProgram(QString program)
+{
+    QMutexLocker locker(&m_Mutex);
+    m_Program = program;
+}
+
+QString QGraphVizLayoutPool::defaultProgram()
+{
+    QFileInfo program(QDir(QCoreApplication::applicationDirPath()).filePath(QGRAPHVIZ_WORKER));
+#if defined(Q_OS_WIN)
+    program.setFile(program.filePath() + ".exe");
+#endif
+
+    if(program.isExecutable()) {
+        return program.filePath();
+    }
+
+    return QString(QGRAPHVIZ_WORKER);
+}
+
+/*! The pool's side of the input protocol: the DOT contents for readInput(), in the worker
+ */
+static void writeInput(QIODevice *device, const QList<QByteArray> &contents)
+{
+    QDataStream stream(device);
+    stream.setVersion(QDataStream::Qt_4_7);
+    stream << quint32(LAYOUT_POOL_MAGIC) << quint32(LAYOUT_POOL_VERSION) << contents;
+}
+
+/*! Whether the program can be started; a program without a path is looked for on the path, as QProcess would
+ */
+static bool isProgramAvailable(const QString &program)
+{
+    QFileInfo file(program);
+    if(file.isAbsolute()) {
+        return file.isExecutable();
+    }
+
+#if defined(Q_OS_WIN)
+    const QChar separator(';');
+    const QString suffix(file.suffix().isEmpty() ? ".exe" : "");
+#else
+    const QChar separator(':');
+    const QString suffix;
+#endif
+
+    foreach(const QString &path, QString::fromLocal8Bit(qgetenv("PATH")).split(separator, QString::SkipEmptyParts)) {
+        if(QFileInfo(QDir(path).filePath(program + suffix)).isExecutable()) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*! A pool running the default program, shared by everything in the process that doesn't have a pool of its own; or
+    NULL, if the worker can't be found next to the application or on the path.  It's created on first use, with the
+    default settings, and isn't freed until the process exits.
+ */
+QGraphVizLayoutPool *QGraphVizLayoutPool::defaultPool()
+{
+    QMutexLocker locker(&m_DefaultPoolMutex);
+
+    if(!m_DefaultPoolChecked) {
+        m_DefaultPoolChecked = true;
+
+        const QString program = defaultProgram();
+        if(isProgramAvailable(program)) {
+            m_DefaultPool = new QGraphVizLayoutPool(program);
+        }
+    }
+
+    return m_DefaultPool;
+}
+
+/*! The number of workers that may run at once; further layouts wait their turn
+ */
+int QGraphVizLayoutPool::maximumWorkers()
+{
+    QMutexLocker locker(&m_Mutex);
+    return m_MaximumWorkers;
+}
+
+void QGraphVizLayoutPool::setMaximumWorkers(int workers)
+{
+    QMutexLocker locker(&m_Mutex);
+    m_MaximumWorkers = qMax(1, workers);
+    m_WorkerFinished.wakeAll();
+}
+
+/*! How long, in milliseconds, a worker may run before it's killed; zero is unlimited
+ */
+int QGraphVizLayoutPool::timeout()
+{
+    QMutexLocker locker(&m_Mutex);
+    return m_Timeout;
+}
+
+void QGraphVizLayoutPool::setTimeout(int msecs)
+{
+    QMutexLocker locker(&m_Mutex);
+    m_Timeout = qMax(0, msecs);
+}
+
+/*! The address space, in megabytes, a worker may allocate; zero is unlimited.  Only enforced on Unix.
+ */
+int QGraphVizLayoutPool::memoryLimit()
+{
+    QMutexLocker locker(&m_Mutex);
+    return m_MemoryLimit;
+}
+
+void QGraphVizLayoutPool::setMemoryLimit(int megabytes)
+{
+    QMutexLocker locker(&m_Mutex);
+    m_MemoryLimit = qMax(0, megabytes);
+}
+
+
+
+/*! Lays the content out with the GraphViz layout engine in a worker, blocking until it's done; waits first, if all
+    the workers are busy.  Returns false, with the reason in error, if the worker failed, crashed or timed out.
+ */
+bool QGraphVizLayoutPool::layout(const QByteArray &content, const QString &layoutEngine, QGraphVizGeometry &geometry, QString &error)
+{
+    QList<QGraphVizGeometry> geometries;
+    if(!layout(QList<QByteArray>() << content, layoutEngine, geometries, error)) {
+        return false;
+    }
+
+    geometry = geometries.first();
+    return true;
+}
+
+/*! Lays out several graphs, one after the other, in the same worker; the geometries come back in the same order as
+    the contents.  Saves starting a process for each of a lot of small graphs.  The timeout covers the whole batch,
+    and if any of the graphs fails, they all do.
+ */
+bool QGraphVizLayoutPool::layout(const QList<QByteArray> &contents, const QString &layoutEngine,
+                                 QList<QGraphVizGeometry> &geometries, QString &error)
+{
+    QStringList arguments;
+    int timeout;
+
+    {
+        QMutexLocker locker(&m_Mutex);
+        while(m_Workers >= m_MaximumWorkers) {
+            m_WorkerFinished.wait(&m_Mutex);
+        }
+        ++m_Workers;
+
+        arguments << "--engine" << layoutEngine;
+        if(m_MemoryLimit > 0) {
+            arguments << "--memory-limit" << QString::number(m_MemoryLimit);
+        }
+        timeout = m_Timeout;
+    }
+
+    bool result = runWorker(arguments, timeout, contents, geometries, error);
+
+    QMutexLocker locker(&m_Mutex);
+    --m_Workers;
+    m_WorkerFinished.wakeOne();
+
+    return result;
+}
+
+bool QGraphVizLayoutPool::runWorker(const QStringList &arguments, int timeout, const QList<QByteArray> &contents,
+                                    QList<QGraphVizGeometry> &geometries, QString &error)
+{
+    const QString program = this->program();
+
+    QProcess worker;
+    worker.start(program, arguments);
+    if(!worker.waitForStarted()) {
+        error = tr("Failed to start the layout worker '%1': %2").arg(program).arg(worker.errorString());
+        return false;
+    }
+
+    // QProcess feeds the content in, and drains the results, while it waits
+    writeInput(&worker, contents);
+    worker.closeWriteChannel();
+
+    if(!worker.waitForFinished(timeout > 0 ? timeout : -1)) {
+        worker.kill();
+        worker.waitForFinished(-1);
+        error = tr("Layout was stopped after %1 seconds.").arg(timeout / 1000.0);
+        return false;
+    }
+
+    const QString errorOutput = QString::fromLocal8Bit(worker.readAllStandardError()).trimmed();
+
+    if(worker.exitStatus() == QProcess::CrashExit) {
+        error = tr("The layout worker crashed.");
+        if(!errorOutput.isEmpty()) {
+            error += " " + errorOutput;
+        }
+        return false;
+    }
+
+    if(worker.exitCode()) {
+        error = errorOutput.isEmpty() ? tr("The layout worker failed with exit code %1.").arg(worker.exitCode())
+                                      : errorOutput;
+        return false;
+    }
+
+    if(!readResult(worker.readAllStandardOutput(), geometries) || geometries.count() != contents.count()) {
+        error = tr("The layout worker's results couldn't be read.");
+        return false;
+    }
+
+    return true;
+}
+
+
+
+/*! The worker's side: reads the DOT contents written by writeInput()
+ */
+bool QGraphVizLayoutPool::readInput(const QByteArray &input, QList<QByteArray> &contents)
+{
+    QDataStream stream(input);
+    stream.setVersion(QDataStream::Qt_4_7);
+
+    quint32 magic = 0, version = 0;
+    stream >> magic >> version;
+    if(magic != LAYOUT_POOL_MAGIC || version != LAYOUT_POOL_VERSION) {
+        return false;
+    }
+
+    stream >> contents;
+    return stream.status() == QDataStream::Ok;
+}
+
+/*! The worker's side: writes the geometries as results for readResult()
+ */
+void QGraphVizLayoutPool::writeResult(QIODevice *device, const QList<QGraphVizGeometry> &geometries)
+{
+    QDataStream stream(device);
+    stream.setVersion(QDataStream::Qt_4_7);
+    stream.setFloatingPointPrecision(QDataStream::DoublePrecision);
+    stream << quint32(LAYOUT_POOL_MAGIC) << quint32(LAYOUT_POOL_VERSION) << geometries;
+}
+
+bool QGraphVizLayoutPool::readResult(const QByteArray &result, QList<QGraphVizGeometry> &geometries)
+{
+    QDataStream stream(result);
+    stream.setVersion(QDataStream::Qt_4_7);
+    stream.setFloatingPointPrecision(QDataStream::DoublePrecision);
+
+    quint32 magic = 0, version = 0;
+    stream >> magic >> version;
+    if(magic != LAYOUT_POOL_MAGIC || version != LAYOUT_POOL_VERSION) {
+        return false;
+    }
+
+    stream >> geometries;
+    return stream.status() == QDataStream::Ok;
+}
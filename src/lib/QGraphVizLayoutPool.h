@@ -0,0 +1,85 @@
+/*!
+   \file
+   \author Dane Gardner <dane.gardner@gmail.com>
+   \version
+
+   \section LICENSE
+   This file is part of the Parallel Tools GUI Framework (PTGF)
+   Copyright (C) 2010-2011 Argo Navis Technologies, LLC
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+   \section DESCRIPTION
+
+ */
+
+
+#ifndef QGRAPHVIZLAYOUTPOOL_H
+#define QGRAPHVIZLAYOUTPOOL_H
+
+#include <QtCore>
+
+#include "QGraphVizLibrary.h"
+
+class QGraphVizGeometry;
+
+class QGRAPHVIZ_EXPORT QGraphVizLayoutPool : public QObject
+{
+    Q_OBJECT
+public:
+    explicit QGraphVizLayoutPool(QString program = QString(), QObject *parent = 0);
+
+    QString program();
+    void setProgram(QString program);
+    static QString defaultProgram();
+    static QGraphVizLayoutPool *defaultPool();
+
+    int maximumWorkers();
+    void setMaximumWorkers(int workers);
+
+    int timeout();
+    void setTimeout(int msecs);
+
+    int memoryLimit();
+    void setMemoryLimit(int megabytes);
+
+    bool layout(const QByteArray &content, const QString &layoutEngine, QGraphVizGeometry &geometry, QString &error);
+    bool layout(const QList<QByteArray> &contents, const QString &layoutEngine, QList<QGraphVizGeometry> &geometries,
+                QString &error);
+
+    static bool readInput(const QByteArray &input, QList<QByteArray> &contents);
+    static void writeResult(QIODevice *device, const QList<QGraphVizGeometry> &geometries);
+    static bool readResult(const QByteArray &result, QList<QGraphVizGeometry> &geometries);
+
+protected:
+    bool runWorker(const QStringList &arguments, int timeout, const QList<QByteArray> &contents,
+                   QList<QGraphVizGeometry> &geometries, QString &error);
+
+private:
+    static QMutex m_DefaultPoolMutex;
+    static QGraphVizLayoutPool *m_DefaultPool;
+    static bool m_DefaultPoolChecked;
+
+    QMutex m_Mutex;
+    QWaitCondition m_WorkerFinished;
+    QString m_Program;
+    int m_MaximumWorkers;
+    int m_Workers;
+    int m_Timeout;
+    int m_MemoryLimit;
+
+};
+
+#endif // QGRAPHVIZLAYOUTPOOL_H
@@ -0,0 +1,671 @@
+/*!
+   \file
+   \author Dane Gardner <dane.gardner@gmail.com>
+   \version
+
+   \section LICENSE
+   This file is part of the Parallel Tools GUI Framework (PTGF)
+   Copyright (C) 2010-2011 Argo Navis Technologies, LLC
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+   \section DESCRIPTION
+
+ */
+
+#include "QGraphVizNativeLayout.h"
+
+#include <graphviz/graph.h>
+
+// Length, in points, GraphViz leaves between the end of a spline and the node for the arrowhead
+static const qreal ArrowLength = 10.0;
+
+// Margins GraphViz puts around a node label, in points (its default margin is 0.11 by 0.055 inches on each side)
+static const qreal LabelMarginX = 16.0;
+static const qreal LabelMarginY = 8.0;
+
+
+
+static QString attribute(void *object, const char *name)
+{
+    const char *value = agget(object, const_cast<char*>(name));
+    return value ? QString::fromUtf8(value) : QString();
+}
+
+static qreal attribute(void *object, const char *name, qreal defaultValue)
+{
+    bool ok = false;
+    qreal value = attribute(object, name).toDouble(&ok);
+    return ok ? value : defaultValue;
+}
+
+/*! Parses "x,y" (optionally pinned, "x,y!") in points
+ */
+static bool parsePoint(const QString &value, QPointF &point)
+{
+    QStringList coordinates = QString(value).remove('!').split(',');
+    if(coordinates.count() < 2) {
+        return false;
+    }
+
+    bool xOk = false, yOk = false;
+    point = QPointF(coordinates.at(0).toDouble(&xOk), coordinates.at(1).toDouble(&yOk));
+    return xOk && yOk;
+}
+
+/*! A rough size for a label, in points; the items shrink their labels to fit the node anyway.  Characters average a
+    little over half an em, and record field separators are counted as characters.
+ */
+static QSizeF estimateText(QString text, qreal fontSize)
+{
+    if(text.isEmpty()) {
+        return QSizeF();
+    }
+
+    text.replace("\\l", "\n").replace("\\r", "\n").replace("\\n", "\n");
+    QStringList lines = text.split('\n');
+
+    int longest = 0;
+    foreach(const QString &line, lines) {
+        longest = qMax(longest, line.length());
+    }
+
+    return QSizeF(longest * fontSize * 0.6, lines.count() * fontSize * 1.2);
+}
+
+
+
+QGraphVizNativeLayout::QGraphVizNativeLayout(const QString &engine) :
+    m_Engine(engine),
+    m_Orthogonal(false),
+    m_LeftToRight(false),
+    m_NodeSeparation(18.0),
+    m_RankSeparation(36.0)
+{
+}
+
+QStringList QGraphVizNativeLayout::engines()
+{
+    return QStringList() << "positions" << "tree";
+}
+
+bool QGraphVizNativeLayout::isNativeEngine(const QString &engine)
+{
+    return engines().contains(engine);
+}
+
+/*! Copies what the layout needs out of the graph.  This is the only part that calls into GraphViz, so the caller
+    must hold whatever lock guards it; layout() can then run on any thread.
+ */
+void QGraphVizNativeLayout::read(graph_t *graph)
+{
+    m_Nodes.clear();
+    m_Edges.clear();
+    m_Geometry = QGraphVizGeometry();
+    m_ErrorString.clear();
+
+    if(!graph) {
+        return;
+    }
+
+    m_Orthogonal = (attribute(graph, "splines") == "ortho");
+    m_LeftToRight = (attribute(graph, "rankdir") == "LR");
+    m_NodeSeparation = qMax(qreal(0.02), attribute(graph, "nodesep", 0.25)) * 72.0;
+    m_RankSeparation = qMax(qreal(0.02), attribute(graph, "ranksep", 0.5)) * 72.0;
+
+    QHash<node_t*, int> indices;
+    indices.reserve(agnnodes(graph));
+    m_Nodes.reserve(agnnodes(graph));
+
+    for(node_t *node = agfstnode(graph); node; node = agnxtnode(graph, node)) {
+        Node layoutNode;
+        layoutNode.name = node->name;
+        layoutNode.hasPosition = parsePoint(attribute(node, "pos"), layoutNode.position);
+
+        QString label = attribute(node, "label");
+        if(label.isEmpty()) {
+            label = "\\N";
+        }
+        label.replace("\\N", QString::fromUtf8(node->name));
+
+        // Big enough for the label, and at least as big as width and height ask for; as GraphViz sizes them
+        QSizeF text = estimateText(label, attribute(node, "fontsize", 14.0));
+        const QString shape = attribute(node, "shape");
+        layoutNode.elliptical = !(shape == "record" || shape == "Mrecord" || shape.startsWith("box") ||
+                                  shape.startsWith("rect") || shape == "square" || shape == "plaintext" ||
+                                  shape == "plain" || shape == "none" || shape == "note" || shape == "tab" ||
+                                  shape == "folder" || shape == "component");
+        if(layoutNode.elliptical) {
+            text *= 1.41421356;  // An ellipse around the label's box
+        }
+
+        layoutNode.size = QSizeF(qMax(attribute(node, "width", 0.75) * 72.0, text.width() + LabelMarginX),
+                                 qMax(attribute(node, "height", 0.5) * 72.0, text.height() + LabelMarginY));
+
+        indices.insert(node, m_Nodes.count());
+        m_Nodes.append(layoutNode);
+    }
+
+    for(node_t *node = agfstnode(graph); node; node = agnxtnode(graph, node)) {
+        QHash<node_t*, int> ordinals;
+        for(edge_t *edge = agfstout(graph, node); edge; edge = agnxtout(graph, edge)) {
+            Edge layoutEdge;
+            layoutEdge.tail = indices.value(edge->tail);
+            layoutEdge.head = indices.value(edge->head);
+            layoutEdge.ordinal = ordinals[edge->head]++;
+            layoutEdge.labelSize = estimateText(attribute(edge, "label"), attribute(edge, "fontsize", 14.0));
+            m_Edges.append(layoutEdge);
+        }
+    }
+}
+
+bool QGraphVizNativeLayout::layout()
+{
+    m_Geometry = QGraphVizGeometry();
+    m_ErrorString.clear();
+
+    if(m_Nodes.isEmpty()) {
+        m_ErrorString = QObject::tr("The graph is empty.");
+        return false;
+    }
+
+    bool positioned = false;
+    if(m_Engine == "positions") {
+        positioned = layoutPositions();
+    } else if(m_Engine == "tree") {
+        positioned = layoutTree();
+    } else {
+        m_ErrorString = QObject::tr("Unknown layout engine: %1").arg(m_Engine);
+    }
+
+    if(!positioned) {
+        return false;
+    }
+
+    routeEdges();
+    return true;
+}
+
+QGraphVizGeometry QGraphVizNativeLayout::geometry() const
+{
+    return m_Geometry;
+}
+
+QString QGraphVizNativeLayout::errorString() const
+{
+    return m_ErrorString;
+}
+
+
+
+/*! Nothing to do but check that every node was given a position
+ */
+bool QGraphVizNativeLayout::layoutPositions()
+{
+    foreach(const Node &node, m_Nodes) {
+        if(!node.hasPosition) {
+            m_ErrorString = QObject::tr("Node \"%1\" has no position.").arg(QString::fromUtf8(node.name));
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*! The tree being laid out by layoutTree(), with children in compressed rows and a thread for every contour node
+    whose subtree ran out before its neighbour's did.
+ */
+struct TreeWalk {
+    QVector<int> parent;
+    QVector<int> childOffsets;
+    QVector<int> children;
+    QVector<int> number;  // Position among its siblings
+    QVector<int> thread;
+    QVector<qreal> breadth;
+    qreal separation;
+
+    int firstChild(int v) const {
+        return (childOffsets.at(v) < childOffsets.at(v + 1)) ? children.at(childOffsets.at(v)) : -1;
+    }
+    int lastChild(int v) const {
+        return (childOffsets.at(v) < childOffsets.at(v + 1)) ? children.at(childOffsets.at(v + 1) - 1) : -1;
+    }
+    int leftSibling(int v) const {
+        return (number.at(v) > 0) ? children.at(childOffsets.at(parent.at(v)) + number.at(v) - 1) : -1;
+    }
+    int leftmostSibling(int v) const { return children.at(childOffsets.at(parent.at(v))); }
+    int nextLeft(int v) const { return (firstChild(v) >= 0) ? firstChild(v) : thread.at(v); }
+    int nextRight(int v) const { return (lastChild(v) >= 0) ? lastChild(v) : thread.at(v); }
+    qreal distance(int a, int b) const { return ((breadth.at(a) + breadth.at(b)) / 2) + separation; }
+};
+
+/*! Walker's tidy tree layout, in the linear time version of Buchheim, Juenger and Leipert.  The first walk runs bottom
+    up, placing each subtree as close to its left siblings as their contours allow; the second adds up the offsets top
+    down.  Both walks are iterative, so a deep call tree can't overflow the stack.  A virtual root holds the forest.
+ */
+bool QGraphVizNativeLayout::layoutTree()
+{
+    const int count = m_Nodes.count();
+    const int root = count;  // Virtual
+    const int total = count + 1;
+
+    // Spanning tree, breadth first from every node nothing points at, then from whatever's left over (cycles)
+    QVector<int> inDegree(count, 0);
+    QVector<int> outOffsets(count + 1, 0);
+    foreach(const Edge &edge, m_Edges) {
+        if(edge.tail != edge.head) {
+            ++inDegree[edge.head];
+            ++outOffsets[edge.tail + 1];
+        }
+    }
+    for(int i = 0; i < count; ++i) {
+        outOffsets[i + 1] += outOffsets[i];
+    }
+    QVector<int> outEdges(outOffsets.last());
+    {
+        QVector<int> fill(outOffsets);
+        foreach(const Edge &edge, m_Edges) {
+            if(edge.tail != edge.head) {
+                outEdges[fill[edge.tail]++] = edge.head;
+            }
+        }
+    }
+
+    TreeWalk tree;
+    tree.separation = m_NodeSeparation;
+    tree.parent.fill(-1, total);
+    QVector<int> depth(total, 0);
+    QVector<int> order;
+    order.reserve(total);
+    order.append(root);
+    depth[root] = -1;
+
+    QVector<bool> visited(count, false);
+    for(int pass = 0; pass < 2; ++pass) {
+        for(int start = 0; start < count; ++start) {
+            if(visited.at(start) || (pass == 0 && inDegree.at(start) > 0)) {
+                continue;
+            }
+
+            visited[start] = true;
+            tree.parent[start] = root;
+            depth[start] = 0;
+            int next = order.count();
+            order.append(start);
+
+            while(next < order.count()) {
+                const int node = order.at(next++);
+                for(int i = outOffsets.at(node); i < outOffsets.at(node + 1); ++i) {
+                    const int child = outEdges.at(i);
+                    if(!visited.at(child)) {
+                        visited[child] = true;
+                        tree.parent[child] = node;
+                        depth[child] = depth.at(node) + 1;
+                        order.append(child);
+                    }
+                }
+            }
+        }
+    }
+
+    // Children in compressed rows, in the order they were reached
+    tree.childOffsets.fill(0, total + 1);
+    for(int i = 1; i < order.count(); ++i) {
+        ++tree.childOffsets[tree.parent.at(order.at(i)) + 1];
+    }
+    for(int i = 0; i < total; ++i) {
+        tree.childOffsets[i + 1] += tree.childOffsets[i];
+    }
+    tree.children.resize(tree.childOffsets.last());
+    tree.number.fill(0, total);
+    {
+        QVector<int> fill(tree.childOffsets);
+        for(int i = 1; i < order.count(); ++i) {
+            const int node = order.at(i);
+            tree.number[node] = fill.at(tree.parent.at(node)) - tree.childOffsets.at(tree.parent.at(node));
+            tree.children[fill[tree.parent.at(node)]++] = node;
+        }
+    }
+
+    // Level order over the tree itself: parents before children, and each rank left to right
+    QVector<int> rankStart;
+    order.resize(1);
+    for(int next = 0; next < order.count(); ++next) {
+        const int node = order.at(next);
+        if(node == root || depth.at(node) != depth.at(order.at(next - 1))) {
+            rankStart.append(next);
+        }
+        for(int c = tree.childOffsets.at(node); c < tree.childOffsets.at(node + 1); ++c) {
+            order.append(tree.children.at(c));
+        }
+    }
+    rankStart.append(order.count());
+
+    tree.breadth.fill(0.0, total);
+    for(int i = 0; i < count; ++i) {
+        tree.breadth[i] = m_LeftToRight ? m_Nodes.at(i).size.height() : m_Nodes.at(i).size.width();
+    }
+
+    QVector<qreal> prelim(total, 0.0), mod(total, 0.0), shift(total, 0.0), change(total, 0.0);
+    tree.thread.fill(-1, total);
+    QVector<int> ancestor(total), defaultAncestor(total, -1);
+    for(int i = 0; i < total; ++i) {
+        ancestor[i] = i;
+    }
+
+    // First walk, from the deepest rank up.  Everything a subtree's placement depends on is either deeper, or to its
+    // left in the same rank, so this does the same work as the usual recursive post order walk.
+    for(int rank = rankStart.count() - 2; rank >= 0; --rank) {
+        for(int i = rankStart.at(rank); i < rankStart.at(rank + 1); ++i) {
+            const int v = order.at(i);
+            const int first = tree.firstChild(v);
+            const int left = (v == root) ? -1 : tree.leftSibling(v);
+
+            if(first < 0) {
+                prelim[v] = (left >= 0) ? prelim.at(left) + tree.distance(left, v) : 0.0;
+            } else {
+                // Execute the shifts collected while apportioning the children
+                qreal totalShift = 0.0, totalChange = 0.0;
+                for(int c = tree.childOffsets.at(v + 1) - 1; c >= tree.childOffsets.at(v); --c) {
+                    const int w = tree.children.at(c);
+                    prelim[w] += totalShift;
+                    mod[w] += totalShift;
+                    totalChange += change.at(w);
+                    totalShift += shift.at(w) + totalChange;
+                }
+
+                const qreal midpoint = (prelim.at(first) + prelim.at(tree.lastChild(v))) / 2;
+                if(left >= 0) {
+                    prelim[v] = prelim.at(left) + tree.distance(left, v);
+                    mod[v] = prelim.at(v) - midpoint;
+                } else {
+                    prelim[v] = midpoint;
+                }
+            }
+
+            if(v == root) {
+                continue;
+            }
+
+            // Apportion: push this subtree right until it clears the contours of its left siblings' subtrees
+            const int p = tree.parent.at(v);
+            if(defaultAncestor.at(p) < 0) {
+                defaultAncestor[p] = tree.leftmostSibling(v);
+            }
+
+            if(left >= 0) {
+                int vip = v, vop = v, vim = left, vom = tree.leftmostSibling(v);
+                qreal sip = mod.at(vip), sop = mod.at(vop), sim = mod.at(vim), som = mod.at(vom);
+
+                while(tree.nextRight(vim) >= 0 && tree.nextLeft(vip) >= 0) {
+                    vim = tree.nextRight(vim);
+                    vip = tree.nextLeft(vip);
+                    vom = tree.nextLeft(vom);
+                    vop = tree.nextRight(vop);
+                    ancestor[vop] = v;
+
+                    const qreal distance = (prelim.at(vim) + sim) - (prelim.at(vip) + sip) + tree.distance(vim, vip);
+                    if(distance > 0.0) {
+                        const int wm = (tree.parent.at(ancestor.at(vim)) == p) ? ancestor.at(vim) : defaultAncestor.at(p);
+                        const qreal subtrees = tree.number.at(v) - tree.number.at(wm);
+                        change[v] -= distance / subtrees;
+                        shift[v] += distance;
+                        change[wm] += distance / subtrees;
+                        prelim[v] += distance;
+                        mod[v] += distance;
+                        sip += distance;
+                        sop += distance;
+                    }
+
+                    sim += mod.at(vim);
+                    sip += mod.at(vip);
+                    som += mod.at(vom);
+                    sop += mod.at(vop);
+                }
+
+                if(tree.nextRight(vim) >= 0 && tree.nextRight(vop) < 0) {
+                    tree.thread[vop] = tree.nextRight(vim);
+                    mod[vop] += sim - sop;
+                }
+
+                if(tree.nextLeft(vip) >= 0 && tree.nextLeft(vom) < 0) {
+                    tree.thread[vom] = tree.nextLeft(vip);
+                    mod[vom] += sip - som;
+                    defaultAncestor[p] = v;
+                }
+            }
+        }
+    }
+
+    // Each rank is as deep as its deepest node
+    int maximumDepth = 0;
+    for(int i = 0; i < count; ++i) {
+        maximumDepth = qMax(maximumDepth, depth.at(i));
+    }
+    QVector<qreal> rankSize(maximumDepth + 1, 0.0);
+    for(int i = 0; i < count; ++i) {
+        const QSizeF &size = m_Nodes.at(i).size;
+        rankSize[depth.at(i)] = qMax(rankSize.at(depth.at(i)), m_LeftToRight ? size.width() : size.height());
+    }
+    QVector<qreal> rankCenter(maximumDepth + 1, 0.0);
+    qreal offset = 0.0;
+    for(int d = 0; d <= maximumDepth; ++d) {
+        rankCenter[d] = offset + (rankSize.at(d) / 2);
+        offset += rankSize.at(d) + m_RankSeparation;
+    }
+
+    // Second walk; parents come before children in breadth first order, so the sums of the modifiers are ready
+    QVector<qreal> modSum(total, 0.0);
+    for(int i = 0; i < order.count(); ++i) {
+        const int v = order.at(i);
+        const qreal position = prelim.at(v) + ((v == root) ? 0.0 : modSum.at(tree.parent.at(v)));
+        modSum[v] = ((v == root) ? 0.0 : modSum.at(tree.parent.at(v))) + mod.at(v);
+
+        if(v == root) {
+            continue;
+        }
+
+        // GraphViz's y axis points up, so the ranks go down from zero
+        Node &node = m_Nodes[v];
+        node.position = m_LeftToRight ? QPointF(rankCenter.at(depth.at(v)), -position)
+                                      : QPointF(position, -rankCenter.at(depth.at(v)));
+        node.hasPosition = true;
+    }
+
+    return true;
+}
+
+/*! Builds the geometry from the node positions, routing every edge and placing its label
+ */
+void QGraphVizNativeLayout::routeEdges()
+{
+    QRectF boundingBox;
+    foreach(const Node &node, m_Nodes) {
+        QGraphVizGeometry::Node geometryNode;
+        geometryNode.name = node.name;
+        geometryNode.position = node.position;
+        geometryNode.size = node.size;
+        m_Geometry.addNode(geometryNode);
+
+        QRectF rect(QPointF(), node.size);
+        rect.moveCenter(node.position);
+        boundingBox = boundingBox.united(rect);
+    }
+
+    foreach(const Edge &edge, m_Edges) {
+        const Node &tail = m_Nodes.at(edge.tail);
+        const Node &head = m_Nodes.at(edge.head);
+
+        QPointF labelAnchor;
+        QGraphVizGeometry::Spline spline;
+        if(edge.tail == edge.head) {
+            spline = routeLoop(tail, labelAnchor);
+        } else if(m_Orthogonal) {
+            spline = routeOrthogonal(tail, head, labelAnchor);
+        } else {
+            spline = routeStraight(tail, head, labelAnchor);
+        }
+
+        QGraphVizGeometry::Edge geometryEdge;
+        geometryEdge.tail = tail.name;
+        geometryEdge.head = head.name;
+        geometryEdge.ordinal = edge.ordinal;
+        geometryEdge.splines.append(spline);
+        geometryEdge.hasLabel = !edge.labelSize.isEmpty();
+
+        foreach(const QPointF &point, spline.points) {
+            boundingBox = boundingBox.united(QRectF(point, QSizeF(0.001, 0.001)));
+        }
+
+        // Labels sit just to the side of the middle of the edge
+        if(geometryEdge.hasLabel) {
+            geometryEdge.labelPosition = labelAnchor + QPointF((edge.labelSize.width() / 2) + 2.0, 0.0);
+
+            QRectF rect(QPointF(), edge.labelSize);
+            rect.moveCenter(geometryEdge.labelPosition);
+            boundingBox = boundingBox.united(rect);
+        }
+
+        m_Geometry.addEdge(geometryEdge);
+    }
+
+    m_Geometry.setBoundingBox(boundingBox.adjusted(-4.0, -4.0, 4.0, 4.0));
+}
+
+QGraphVizGeometry::Spline QGraphVizNativeLayout::routeStraight(const Node &tail, const Node &head, QPointF &labelAnchor)
+{
+    QVector<QPointF> points;
+    points << clip(tail, head.position) << clip(head, tail.position);
+
+    // Overlapping nodes; just join the centers
+    if(QLineF(tail.position, head.position).length() <= QLineF(tail.position, points.last()).length()) {
+        points[0] = tail.position;
+        points[1] = head.position;
+    }
+
+    labelAnchor = (points.first() + points.last()) / 2;
+    return polyline(points);
+}
+
+/*! Leaves the tail vertically, crosses over halfway between the nodes, and enters the head vertically; or the same
+    turned on its side for nodes that are level with each other.
+ */
+QGraphVizGeometry::Spline QGraphVizNativeLayout::routeOrthogonal(const Node &tail, const Node &head, QPointF &labelAnchor)
+{
+    const QPointF delta = head.position - tail.position;
+    QVector<QPointF> points;
+
+    if(qAbs(delta.y()) >= (tail.size.height() + head.size.height()) / 2) {
+        const qreal direction = (delta.y() > 0) ? 1.0 : -1.0;
+        const QPointF start(tail.position.x(), tail.position.y() + (direction * tail.size.height() / 2));
+        const QPointF end(head.position.x(), head.position.y() - (direction * head.size.height() / 2));
+        const qreal middle = (start.y() + end.y()) / 2;
+
+        points << start;
+        if(!qFuzzyCompare(start.x() + 1.0, end.x() + 1.0)) {
+            points << QPointF(start.x(), middle) << QPointF(end.x(), middle);
+        }
+        points << end;
+    } else {
+        const qreal direction = (delta.x() > 0) ? 1.0 : -1.0;
+        const QPointF start(tail.position.x() + (direction * tail.size.width() / 2), tail.position.y());
+        const QPointF end(head.position.x() - (direction * head.size.width() / 2), head.position.y());
+        const qreal middle = (start.x() + end.x()) / 2;
+
+        points << start;
+        if(!qFuzzyCompare(start.y() + 1.0, end.y() + 1.0)) {
+            points << QPointF(middle, start.y()) << QPointF(middle, end.y());
+        }
+        points << end;
+    }
+
+    labelAnchor = (points.at((points.count() - 1) / 2) + points.at(points.count() / 2)) / 2;
+    return polyline(points);
+}
+
+/*! A loop off the right hand side of the node
+ */
+QGraphVizGeometry::Spline QGraphVizNativeLayout::routeLoop(const Node &node, QPointF &labelAnchor)
+{
+    const qreal right = node.position.x() + (node.size.width() / 2);
+    const qreal reach = qMax(node.size.height(), qreal(24.0));
+
+    QGraphVizGeometry::Spline spline;
+    spline.hasStart = false;
+    spline.hasEnd = true;
+    spline.end = QPointF(right, node.position.y() - (node.size.height() / 4));
+    spline.points << QPointF(right, node.position.y() + (node.size.height() / 4))
+                  << QPointF(right + reach, node.position.y() + reach)
+                  << QPointF(right + reach, node.position.y() - reach)
+                  << spline.end + QPointF(ArrowLength * 0.7, -ArrowLength * 0.7);
+
+    labelAnchor = QPointF(right + (reach * 0.75), node.position.y());
+    return spline;
+}
+
+
+
+/*! The point where the line from the center of the node towards the given point leaves the node
+ */
+QPointF QGraphVizNativeLayout::clip(const Node &node, const QPointF &towards)
+{
+    const QPointF delta = towards - node.position;
+    const qreal halfWidth = node.size.width() / 2;
+    const qreal halfHeight = node.size.height() / 2;
+
+    if(delta.isNull() || halfWidth <= 0.0 || halfHeight <= 0.0) {
+        return node.position;
+    }
+
+    qreal t;
+    if(node.elliptical) {
+        t = 1.0 / qSqrt(((delta.x() / halfWidth) * (delta.x() / halfWidth)) +
+                        ((delta.y() / halfHeight) * (delta.y() / halfHeight)));
+    } else {
+        const qreal tx = qFuzzyIsNull(delta.x()) ? 1e9 : halfWidth / qAbs(delta.x());
+        const qreal ty = qFuzzyIsNull(delta.y()) ? 1e9 : halfHeight / qAbs(delta.y());
+        t = qMin(tx, ty);
+    }
+
+    return node.position + (delta * qMin(t, qreal(1.0)));
+}
+
+/*! A spline that follows the polyline exactly; each segment becomes a straight cubic.  The last segment is cut short
+    to leave room for the arrowhead, which ends at the last point.
+ */
+QGraphVizGeometry::Spline QGraphVizNativeLayout::polyline(const QVector<QPointF> &points)
+{
+    QGraphVizGeometry::Spline spline;
+    spline.hasStart = false;
+    spline.hasEnd = true;
+    spline.end = points.last();
+
+    QVector<QPointF> route(points);
+    QLineF last(route.at(route.count() - 2), route.last());
+    if(last.length() > 0.0) {
+        last.setLength(last.length() - qMin(ArrowLength, last.length() / 2));
+        route.last() = last.p2();
+    }
+
+    spline.points.reserve((3 * route.count()) - 2);
+    spline.points.append(route.first());
+    for(int i = 1; i < route.count(); ++i) {
+        const QPointF a = route.at(i - 1);
+        const QPointF b = route.at(i);
+        spline.points << (a + ((b - a) / 3)) << (a + (2 * (b - a) / 3)) << b;
+    }
+
+    return spline;
+}
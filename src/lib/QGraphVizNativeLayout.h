@@ -0,0 +1,103 @@
+/*!
+   \file
+   \author Dane Gardner <dane.gardner@gmail.com>
+   \version
+
+   \section LICENSE
+   This file is part of the Parallel Tools GUI Framework (PTGF)
+   Copyright (C) 2010-2011 Argo Navis Technologies, LLC
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+   \section DESCRIPTION
+
+ */
+
+#ifndef QGRAPHVIZNATIVELAYOUT_H
+#define QGRAPHVIZNATIVELAYOUT_H
+
+#include <QtCore>
+
+#include <graphviz/types.h>
+
+#include "QGraphVizLibrary.h"
+#include "QGraphVizGeometry.h"
+
+/*! Layout engines implemented in the library rather than in GraphViz.  They're selected by name through
+    QGraphVizScene::setLayoutEngine() like any GraphViz engine, and produce a QGraphVizGeometry that's handed to
+    GraphViz's pass-through engine, so the items see the same structures either way.
+
+    "positions" trusts the pos attribute of every node (in points, as neato -n2 does) and only routes the edges.
+
+    "tree" is a layered tree layout in linear time (Walker's algorithm, as improved by Buchheim, Juenger and Leipert),
+    for call trees too big for dot.  The tree is a breadth first spanning tree from the nodes nothing points at, so any
+    other edges are just routed across it.  It honours nodesep, ranksep and rankdir=LR.
+
+    Edges are routed straight by default, or orthogonally if the graph has splines=ortho.
+ */
+class QGRAPHVIZ_EXPORT QGraphVizNativeLayout
+{
+public:
+    explicit QGraphVizNativeLayout(const QString &engine);
+
+    static QStringList engines();
+    static bool isNativeEngine(const QString &engine);
+
+    void read(graph_t *graph);
+    bool layout();
+
+    QGraphVizGeometry geometry() const;
+    QString errorString() const;
+
+protected:
+    struct Node {
+        QByteArray name;
+        QPointF position;
+        bool hasPosition;
+        QSizeF size;
+        bool elliptical;
+    };
+
+    struct Edge {
+        int tail;
+        int head;
+        int ordinal;
+        QSizeF labelSize;
+    };
+
+    bool layoutPositions();
+    bool layoutTree();
+
+    void routeEdges();
+    QGraphVizGeometry::Spline routeStraight(const Node &tail, const Node &head, QPointF &labelAnchor);
+    QGraphVizGeometry::Spline routeOrthogonal(const Node &tail, const Node &head, QPointF &labelAnchor);
+    QGraphVizGeometry::Spline routeLoop(const Node &node, QPointF &labelAnchor);
+
+    static QPointF clip(const Node &node, const QPointF &towards);
+    static QGraphVizGeometry::Spline polyline(const QVector<QPointF> &points);
+
+    QString m_Engine;
+    bool m_Orthogonal;
+    bool m_LeftToRight;
+    qreal m_NodeSeparation;
+    qreal m_RankSeparation;
+    QVector<Node> m_Nodes;
+    QVector<Edge> m_Edges;
+
+    QGraphVizGeometry m_Geometry;
+    QString m_ErrorString;
+};
+
+#endif // QGRAPHVIZNATIVELAYOUT_H
@@ -30,6 +30,8 @@
 #include "QGraphVizEdge.h"
 
 #include "QGraphVizNodeEffect.h"
+#include "QGraphVizLabelCache.h"
+#include "QGraphVizAttributes.h"
 
 #define STROKE_WIDTH 1.5
 
@@ -37,14 +39,17 @@ QGraphVizNode::QGraphVizNode(node_t *node, QGraphVizScene *graphViz, QGraphicsIt
     QGraphicsItem(parent),
     m_GraphVizNode(node),
     m_GraphViz(graphViz),
+    m_Index(-1),
     m_Collapsed(false),
+    m_Generation(0),
+    m_Style(-1),
+    m_Shape(-1),
+    m_LabelScale(1.0),
     m_Transparent(false),
     m_Blurred(false),
     m_Highlighted(false),
     m_HighlightWidth(15.0),
-    m_HighlightColor(Qt::cyan),
-    m_HeadEdgesInitialized(false),
-    m_TailEdgesInitialized(false)
+    m_HighlightColor(Qt::cyan)
 {
     setZValue(1.0);
     updateGeometry();
@@ -77,15 +82,7 @@ void QGraphVizNode::setCollapsed(bool collapse)
         return;
     }
 
-    m_Collapsed = collapse;
-
-    foreach(QGraphVizEdge *edge, tailEdges()) {
-        edge->head()->setTransparent(m_Collapsed);
-        edge->update();
-    }
-
-    prepareGeometryChange();
-    update();
+    m_GraphViz->propagateCollapse(this, collapse);
 }
 
 void QGraphVizNode::toggleCollapse()
@@ -94,31 +91,18 @@ void QGraphVizNode::toggleCollapse()
 }
 
 
-QList<QGraphVizEdge*> QGraphVizNode::headEdges()
+/*! Edges pointing into this node; see QGraphVizEdgeRange for the lifetime of the returned range.
+ */
+QGraphVizEdgeRange QGraphVizNode::headEdges()
 {
-    if(!m_HeadEdgesInitialized) {
-        foreach(QGraphVizEdge *edge, m_GraphViz->getEdges()) {
-            if(edge->head() == this) {
-                m_HeadEdges.append(edge);
-            }
-        }
-
-        m_HeadEdgesInitialized = true;
-    }
-    return m_HeadEdges;
+    return m_GraphViz->headEdges(this);
 }
 
-QList<QGraphVizEdge*> QGraphVizNode::tailEdges()
+/*! Edges leaving this node; see QGraphVizEdgeRange for the lifetime of the returned range.
+ */
+QGraphVizEdgeRange QGraphVizNode::tailEdges()
 {
-    if(!m_TailEdgesInitialized) {
-        foreach(QGraphVizEdge *edge, m_GraphViz->getEdges()) {
-            if(edge->tail() == this) {
-                m_TailEdges.append(edge);
-            }
-        }
-        m_TailEdgesInitialized = true;
-    }
-    return m_TailEdges;
+    return m_GraphViz->tailEdges(this);
 }
 
 
@@ -135,19 +119,15 @@ bool QGraphVizNode::isTransparent()
 
 void QGraphVizNode::setTransparent(bool transparent)
 {
-    m_Transparent = transparent;
+    m_GraphViz->propagateTransparency(this, transparent);
+}
 
+/*! Only changes this node; propagation and repainting are left to the scene.
+ */
+void QGraphVizNode::applyTransparent(bool transparent)
+{
+    m_Transparent = transparent;
     setFlag(QGraphicsItem::ItemIsSelectable, !m_Blurred | !m_Transparent);
-
-    foreach(QGraphVizEdge *edge, tailEdges()) {
-        if(!isCollapsed()) {
-            edge->head()->setTransparent(transparent);
-            edge->update(edge->boundingRect().adjusted(-5,-5,20,5));
-        }
-    }
-
-    prepareGeometryChange();
-    update();
 }
 
 
@@ -185,9 +165,7 @@ void QGraphVizNode::setHighlighted(bool highlighted)
 
     m_Highlighted = highlighted;
 
-    foreach(QGraphVizEdge *edge, headEdges()) {
-        edge->setHighlighted(m_Highlighted);
-    }
+    m_GraphViz->propagateHighlight(this, m_Highlighted);
 
     prepareGeometryChange();
     update();
@@ -227,6 +205,8 @@ QRectF QGraphVizNode::boundingRect() const
 
 void QGraphVizNode::updateGeometry()
 {
+    m_Generation = m_GraphViz->generation();
+
     QPointF newPos = m_GraphViz->transformPoint(m_GraphVizNode->u.coord);
     if(newPos != pos()) {
         setPos(newPos);
@@ -236,12 +216,13 @@ void QGraphVizNode::updateGeometry()
 
     // Get bounding box for path
     updatePath();
-    QRectF adjusted = m_Path.boundingRect().adjusted(-STROKE_WIDTH, -STROKE_WIDTH, STROKE_WIDTH, STROKE_WIDTH);
+    const QRectF pathRect = path().boundingRect();
+    QRectF adjusted = pathRect.adjusted(-STROKE_WIDTH, -STROKE_WIDTH, STROKE_WIDTH, STROKE_WIDTH);
 
     QRectF highlightAdjusted;
     if(isHighlighted()) {
         qreal highlightWidth = this->highlightWidth();
-        highlightAdjusted = m_Path.boundingRect().adjusted(-highlightWidth, -highlightWidth, highlightWidth, highlightWidth);
+        highlightAdjusted = pathRect.adjusted(-highlightWidth, -highlightWidth, highlightWidth, highlightWidth);
     }
 
     m_BoundingRect = m_BoundingRect.united(adjusted).united(highlightAdjusted);
@@ -260,30 +241,12 @@ void QGraphVizNode::paint(QPainter *painter, const QStyleOptionGraphicsItem *opt
         return;
     }
 
-    QByteArray currHash = m_GraphViz->getHash(m_GraphVizNode);
-    if(m_LastHash != currHash) {
+    if(m_Generation != m_GraphViz->generation()) {
         updateGeometry();
-        m_LastHash = currHash;
     }
 
     const qreal lod = option->levelOfDetailFromTransform(painter->worldTransform());
 
-    // Handle bluring; trying to optimize
-    if((lod >= 0.45) && isBlurred() && !graphicsEffect()) {
-        QGraphicsBlurEffect *effect = new QGraphicsBlurEffect(scene());
-        effect->setBlurHints(QGraphicsBlurEffect::AnimationHint);
-        setGraphicsEffect(effect);
-    }
-
-    QGraphicsBlurEffect *effect = qobject_cast<QGraphicsBlurEffect*>(graphicsEffect());
-    if(effect) {
-        if((lod >= 0.45) && isBlurred()) {
-            effect->setBlurRadius(2.0);
-        } else {
-            effect->setBlurRadius(0.0);
-        }
-    }
-
     // Handle transparency
     if((lod >= 0.10) && isTransparent()) {
         painter->setOpacity(0.15);
@@ -293,42 +256,64 @@ void QGraphVizNode::paint(QPainter *painter, const QStyleOptionGraphicsItem *opt
 
     drawBackground(painter, option);
 
-    // Paint the path
-    if(lod >= 0.01 && !m_Path.isEmpty()) {
-        QPen pen = QPen(m_PathPen);
-        QBrush brush = QBrush(m_PathBrush);
+    const QPainterPath &path = this->path();
+    QPen pen = QPen(style().pen);
+    QBrush brush = QBrush(style().brush);
 
-        if(isHighlighted()) {
-            QPen highlightPen(highlightColor());
-            highlightPen.setWidthF(highlightWidth());
+    if(isCollapsed()) {
+        pen.setStyle(Qt::DotLine);
+    }
 
-            painter->setPen(highlightPen);
-            painter->setBrush(Qt::transparent);
-            painter->drawPath(m_Path);
-        }
+    if(isSelected()) {
+        pen.setColor(Qt::red);
+        brush.setColor(brush.color().lighter());
+    }
 
-        if(isCollapsed()) {
-            pen.setStyle(Qt::DotLine);
-        }
+    if(lod >= 0.01 && !path.isEmpty() && isHighlighted()) {
+        QPen highlightPen(highlightColor());
+        highlightPen.setWidthF(highlightWidth());
 
-        if(isSelected()) {
-            pen.setColor(Qt::red);
-            brush.setColor(brush.color().lighter());
-        }
+        painter->setPen(highlightPen);
+        painter->setBrush(Qt::transparent);
+        painter->drawPath(path);
+    }
 
+    // Blurred nodes are drawn from a pixmap cache shared by the whole scene; nodes that look alike share the pixmap
+    if((lod >= 0.45) && isBlurred() && !path.isEmpty()) {
+        m_GraphViz->nodeEffect()->draw(painter, this, pen, brush, lod);
+    } else {
+        drawContents(painter, pen, brush, lod);
+    }
+
+    drawForeground(painter, option);
+}
+
+void QGraphVizNode::drawContents(QPainter *painter, const QPen &pen, const QBrush &brush, qreal lod)
+{
+    const QPainterPath &path = this->path();
+
+    // Paint the path
+    if(lod >= 0.01 && !path.isEmpty()) {
         painter->setPen(pen);
         painter->setBrush(brush);
-        painter->drawPath(m_Path);
-   }
+        painter->drawPath(path);
+    }
 
     // Draw the labels
     if(lod >= 0.45 && !labelText().isEmpty()) {
         painter->setPen(labelColor());
-        painter->setFont(labelFont());
-        painter->drawText(m_Path.boundingRect(), labelText(), labelOptions());
+        m_GraphViz->labelCache()->draw(painter, path.boundingRect(), labelText(), labelFont(), labelOptions());
     }
+}
 
-    drawForeground(painter, option);
+QVariant QGraphVizNode::itemChange(GraphicsItemChange change, const QVariant &value)
+{
+    // Edges aren't drawn when either end is hidden
+    if(change == QGraphicsItem::ItemVisibleHasChanged && m_GraphViz && m_Index >= 0) {
+        m_GraphViz->updateEdges(this);
+    }
+
+    return QGraphicsItem::itemChange(change, value);
 }
 
 void QGraphVizNode::drawBackground(QPainter *painter, const QStyleOptionGraphicsItem *option)
@@ -344,43 +329,52 @@ void QGraphVizNode::drawForeground(QPainter *painter, const QStyleOptionGraphics
 }
 
 
-void QGraphVizNode::updatePath()
+/*! The node's pen, brush and label style, from the scene's style table; valid until the next style is added
+ */
+const QGraphVizStyleTable::Style &QGraphVizNode::style() const
 {
-    if(!m_GraphVizNode->u.shape) {
-        m_Path = QPainterPath();
-        return;
-    }
+    return m_GraphViz->styleTable()->style(m_Style);
+}
 
-#if 0
-    // Get the attributes together into a dictionary structure
-    QHash<QString,QString> attr = m_GraphViz->getAttributes(m_GraphVizNode);
+/*! The node's shape, from the scene's style table; valid until the next path is added
+ */
+const QPainterPath &QGraphVizNode::path() const
+{
+    return m_GraphViz->styleTable()->path(m_Shape);
+}
 
-    // If there's a specified fill color, use it
-    if(!attr["fillcolor"]) {
-        brush = QBrush(QColor(attr["fillcolor"]));
-    }
-#else
-    /* Seriously, WTF?!  The friggin' color values are in the attr array, but don't come out of the agattr function
-       set.  We get to pull them manually.  GraphViz is a thing of wonder. */
 
-    QStringList attr;
-    for(uint i = 0; i < sizeof(m_GraphVizNode->attr); ++i) {
-        attr.append(m_GraphVizNode->attr[i]);
+void QGraphVizNode::updatePath()
+{
+    if(!m_GraphVizNode->u.shape) {
+        m_Shape = -1;
+        return;
     }
 
-    if(attr.count() >= 6) {
-        m_PathBrush = QBrush(QColor(attr[6]));
+    QGraphVizStyleTable *styles = m_GraphViz->styleTable();
+    QGraphVizStyleTable::Style style = styles->style(m_Style);
+
+    // As GraphViz does, fills with the color if there's no fill color, and with light grey if there's neither
+    QGraphVizAttributes *attributes = m_GraphViz->attributes();
+    QColor fillColor = attributes->color(m_GraphVizNode, attributes->symbol(QGraphVizAttributes::Kind_Node,
+                                                                            QGraphVizAttributes::Name_FillColor));
+    if(!fillColor.isValid()) {
+        fillColor = attributes->color(m_GraphVizNode, attributes->symbol(QGraphVizAttributes::Kind_Node,
+                                                                         QGraphVizAttributes::Name_Color),
+                                      QColor(211, 211, 211));
     }
-#endif
+    style.brush = QBrush(fillColor);
 
 
     // Set the stroke pen and width
-    m_PathPen = QPen(Qt::black);
-    m_PathPen.setWidthF(STROKE_WIDTH);
-    m_PathPen.setJoinStyle(Qt::RoundJoin);
+    style.pen = QPen(Qt::black);
+    style.pen.setWidthF(STROKE_WIDTH);
+    style.pen.setJoinStyle(Qt::RoundJoin);
+
+    m_Style = styles->addStyle(style);
 
 
-    m_Path = QPainterPath();
+    QPainterPath path;
 #if 0
     //TODO: Need to figure out translation of points from GraphViz to our coordinates
     //shape_desc *shapeDescription = m_GraphVizNode->u.shape;
@@ -401,9 +395,12 @@ void QGraphVizNode::updatePath()
     QPointF size(m_GraphVizNode->u.width * 72, m_GraphVizNode->u.height * 72);
     QRectF rectDraw = QRectF(-size/2, size/2);  // Center point of overall block
 
-    m_Path.addRect(rectDraw);
+    path.addRect(rectDraw);
 #endif
 
+    // Nodes of the same size share the one path
+    m_Shape = styles->addPath(path);
+
     prepareGeometryChange();
     update();
 }
@@ -417,32 +414,36 @@ void QGraphVizNode::updateLabel()
 
     m_LabelText = label->text;
 
-    m_LabelFont.setStyleHint(QFont::Serif);
-    m_LabelFont.setStyleStrategy((QFont::StyleStrategy)(QFont::PreferAntialias | QFont::PreferQuality));
+    QGraphVizStyleTable *styles = m_GraphViz->styleTable();
+    QGraphVizStyleTable::Style style = styles->style(m_Style);
+
+    style.labelFont.setStyleHint(QFont::Serif);
+    style.labelFont.setStyleStrategy((QFont::StyleStrategy)(QFont::PreferAntialias | QFont::PreferQuality));
 #if 0
     font.setFamily(label->fontname);    // Usually "Times New Roman"
 #else
     //! \note This was set manually in the STAT GUI, so I'm doing the same here
-    m_LabelFont.setFamily("sans-serif");
+    style.labelFont.setFamily("sans-serif");
 #endif
-    m_LabelFont.setPointSizeF(label->fontsize * .75);
+    style.labelFont.setPointSizeF(label->fontsize * .75);
 
-    //HACK: Pre-render to get optimal font size to fit in bounding box without overflow/wrap
-    QPainterPath labelPath;
-    labelPath.addText(0, 0, m_LabelFont, labelText());
+    // Measure the label on one line to get the optimal font size to fit in bounding box without overflow/wrap
+    const qreal labelWidth = m_GraphViz->labelCache()->size(labelText(), style.labelFont).width();
 
     QPointF size(m_GraphVizNode->u.width * 72, m_GraphVizNode->u.height * 72);
     QRectF rectDraw = QRectF(-size/2, size/2);  // Center point of overall block
 
-    if((rectDraw.width()-20) < labelPath.boundingRect().width()) {
-        m_LabelFont.setPointSizeF(m_LabelFont.pointSizeF() * ((rectDraw.width()-20) / labelPath.boundingRect().width()));
+    // The fit depends on this node's text and size, so it stays with the node; the style is shared with lookalikes
+    m_LabelScale = 1.0;
+    if((rectDraw.width()-20) < labelWidth) {
+        m_LabelScale = (rectDraw.width()-20) / labelWidth;
     }
 
-    m_LabelColor = QColor(label->fontcolor);
+    style.labelColor = m_GraphViz->attributes()->color(label->fontcolor, Qt::black);
 
     // If we're using the default text pen color, see if a human can actually read it against
     // the background color
-    if(m_LabelColor == Qt::black) {
+    if(style.labelColor == Qt::black) {
         // For getting human-percieved color brightness, checkout my blog post on the subject
         // http://blog.danegardner.com/2010/10/getting-perceived-brightness-from-rgb.html
 
@@ -450,21 +451,23 @@ void QGraphVizNode::updateLabel()
         // than dark reds!
 
         int red, green, blue;
-        m_PathBrush.color().getRgb(&red, &green, &blue);
+        style.brush.color().getRgb(&red, &green, &blue);
         int perceivedBackgroundBrightness = qRound(qSqrt(
                                                        (qPow(red, 2) * 0.241) +
                                                        (qPow(red, 2) * 0.691) +
                                                        (qPow(red, 2) * 0.068) ));
 
         if(perceivedBackgroundBrightness < 64) {  // A good threshold after some initial testing
-            m_LabelColor = Qt::white;
+            style.labelColor = Qt::white;
         }
     }
 
 
     // Center the text and wrap if we screwed up at the pre-render
-    m_LabelOptions.setAlignment(Qt::AlignCenter);
-    m_LabelOptions.setWrapMode(QTextOption::WrapAtWordBoundaryOrAnywhere);
+    style.labelOptions.setAlignment(Qt::AlignCenter);
+    style.labelOptions.setWrapMode(QTextOption::WrapAtWordBoundaryOrAnywhere);
+
+    m_Style = styles->addStyle(style);
 
 
     prepareGeometryChange();
@@ -475,17 +478,21 @@ void QGraphVizNode::updateLabel()
 
 QTextOption QGraphVizNode::labelOptions()
 {
-    return m_LabelOptions;
+    return style().labelOptions;
 }
 
 QFont QGraphVizNode::labelFont()
 {
-    return m_LabelFont;
+    QFont font = style().labelFont;
+    if(m_LabelScale != 1.0) {
+        font.setPointSizeF(font.pointSizeF() * m_LabelScale);
+    }
+    return font;
 }
 
 QColor QGraphVizNode::labelColor()
 {
-    return m_LabelColor;
+    return style().labelColor;
 }
 
 QString QGraphVizNode::labelText()
@@ -34,6 +34,8 @@
 #include <graphviz/types.h>
 
 #include "QGraphVizLibrary.h"
+#include "QGraphVizEdgeRange.h"
+#include "QGraphVizStyleTable.h"
 
 class QGraphVizScene;
 class QGraphVizView;
@@ -64,18 +66,24 @@ public:
     QColor highlightColor();
     void setHighlightColor(QColor color);
 
-    QList<QGraphVizEdge*> headEdges();
-    QList<QGraphVizEdge*> tailEdges();
+    QGraphVizEdgeRange headEdges();
+    QGraphVizEdgeRange tailEdges();
 
     virtual void showToolTip(const QPoint &pos, QWidget *parent = 0, const QRect &rect = QRect());
 
 protected:
     virtual QRectF boundingRect() const;
     virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget);
+    virtual QVariant itemChange(GraphicsItemChange change, const QVariant &value);
 
     virtual void drawBackground(QPainter *painter, const QStyleOptionGraphicsItem *option);
     virtual void drawForeground(QPainter *painter, const QStyleOptionGraphicsItem *option);
 
+    void drawContents(QPainter *painter, const QPen &pen, const QBrush &brush, qreal lod);
+
+    const QGraphVizStyleTable::Style &style() const;
+    const QPainterPath &path() const;
+
     void updateGeometry();
     void updatePath();
     void updateLabel();
@@ -86,22 +94,23 @@ protected:
     virtual QString labelText();
 
 private:
+    void applyTransparent(bool transparent);
+
     node_t *m_GraphVizNode;
     QGraphVizScene *m_GraphViz;
+    int m_Index;
     bool m_Collapsed;
 
-    QByteArray m_LastHash;
+    quint64 m_Generation;
 
     QRectF m_BoundingRect;
 
-    QBrush m_PathBrush;
-    QPen m_PathPen;
-    QPainterPath m_Path;
+    // Indices into the scene's style table; the pen, brush, label style and shape are shared with lookalike nodes
+    int m_Style;
+    int m_Shape;
 
-    QTextOption m_LabelOptions;
-    QFont m_LabelFont;
-    QColor m_LabelColor;
     QString m_LabelText;
+    qreal m_LabelScale;     // Shrinks the style's label font to fit this node's label in it
 
     bool m_Transparent;
     bool m_Blurred;
@@ -110,10 +119,8 @@ private:
     qreal m_HighlightWidth;
     QColor m_HighlightColor;
 
-    bool m_HeadEdgesInitialized;
-    bool m_TailEdgesInitialized;
-    QList<QGraphVizEdge*> m_HeadEdges;
-    QList<QGraphVizEdge*> m_TailEdges;
+    friend class QGraphVizScene;
+    friend class QGraphVizNodeEffect;
 };
 
 #endif // QGRAPHVIZNODE_H
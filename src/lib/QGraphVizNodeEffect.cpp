@@ -27,80 +27,131 @@
 
 #include "QGraphVizNodeEffect.h"
 
+#include "QPixmapFilter.h"
+#include "QGraphVizNode.h"
+
+// Pixmaps are rendered at a power of two scale within these bounds, whatever the actual zoom
+#define ZOOM_BUCKET_MIN -1
+#define ZOOM_BUCKET_MAX 3
+
 
 QGraphVizNodeEffect::QGraphVizNodeEffect(QObject *parent) :
-    QGraphicsEffect(parent),
-    m_Opacity(1.0),
+    QObject(parent),
     m_BlurFilter(NULL),
-    m_BlurCached(false)
+    m_BlurCache(32 * 1024)
 {
     m_BlurFilter = new QPixmapBlurFilter(this);
     m_BlurFilter->setBlurHints(QGraphicsBlurEffect::AnimationHint);
+    m_BlurFilter->setRadius(2.0);
 }
 
-qreal QGraphVizNodeEffect::opacity()
+qreal QGraphVizNodeEffect::blurRadius()
 {
-    return m_Opacity;
+    return m_BlurFilter->radius();
 }
 
-void QGraphVizNodeEffect::setOpacity(qreal opacity)
+void QGraphVizNodeEffect::setBlurRadius(qreal blurRadius)
 {
-    m_Opacity = qBound(0.0, opacity, 1.0);
+    if(qFuzzyCompare(blurRadius, m_BlurFilter->radius())) {
+        return;
+    }
+
+    m_BlurFilter->setRadius(blurRadius);
+    clearCache();
 }
 
-qreal QGraphVizNodeEffect::blurRadius()
+/*! The cache size is given in kilobytes of pixmap data
+ */
+int QGraphVizNodeEffect::cacheLimit()
 {
-    return m_BlurFilter->radius();
+    return m_BlurCache.maxCost();
 }
 
-void QGraphVizNodeEffect::setBlurRadius(qreal blurRadius)
+void QGraphVizNodeEffect::setCacheLimit(int kilobytes)
 {
-    m_BlurFilter->setRadius(blurRadius);
+    m_BlurCache.setMaxCost(kilobytes);
 }
 
-void QGraphVizNodeEffect::draw(QPainter *painter)
+void QGraphVizNodeEffect::clearCache()
 {
-    qreal opacity = this->opacity();
-    qreal blurRadius = this->blurRadius();
+    m_BlurCache.clear();
+}
 
-    // Don't do anything if it's completely transparent
-    if(qFuzzyCompare(opacity, 0.0)) {
-        return;
+/*! Draws the blurred node.  The blurred appearance is rendered once per style, size and zoom bucket, and is
+    shared by every node that looks the same; which, in a call graph, is every call to the same function.
+ */
+void QGraphVizNodeEffect::draw(QPainter *painter, QGraphVizNode *node, const QPen &pen, const QBrush &brush, qreal lod)
+{
+    const int zoomBucket = qBound(ZOOM_BUCKET_MIN, qCeil(qLn(lod) / qLn(2.0)), ZOOM_BUCKET_MAX);
+    const qreal scale = qPow(2.0, zoomBucket);
+
+    // Leave enough room around the node for the stroke and for the blur to fade out
+    const qreal margin = pen.widthF() + ((2.0 * blurRadius()) / scale);
+    const QRectF rect = node->path().boundingRect().adjusted(-margin, -margin, margin, margin);
+
+    const QString key = cacheKey(node, pen, brush, zoomBucket);
+    QPixmap *pixmap = m_BlurCache.object(key);
+    if(!pixmap) {
+        pixmap = render(node, pen, brush, rect, scale);
+        if(!pixmap) {
+            return;
+        }
+
+        int cost = qMax(1, (pixmap->width() * pixmap->height() * pixmap->depth() / 8) / 1024);
+        if(cost > m_BlurCache.maxCost()) {
+            // Too big to keep around; just draw it this once
+            painter->drawPixmap(rect, *pixmap, QRectF(pixmap->rect()));
+            delete pixmap;
+            return;
+        }
+
+        m_BlurCache.insert(key, pixmap, cost);
     }
 
-    // Just draw it if there's no effect applied
-    if(blurRadius < 1.0 && qFuzzyCompare(opacity, 1.0)) {
-        drawSource(painter);
-        return;
-    }
+    painter->drawPixmap(rect, *pixmap, QRectF(pixmap->rect()));
+}
 
-    PixmapPadMode mode = PadToEffectiveBoundingRect;
-    if(painter->paintEngine()->type() == QPaintEngine::OpenGL2)
-        mode = NoPad;
+QString QGraphVizNodeEffect::cacheKey(QGraphVizNode *node, const QPen &pen, const QBrush &brush, int zoomBucket)
+{
+    const QSizeF size = node->path().boundingRect().size();
+
+    return QString("%1|%2|%3|%4|%5|%6x%7|%8|%9")
+            .arg(zoomBucket)
+            .arg(pen.color().rgba())
+            .arg(pen.widthF())
+            .arg((int)pen.style())
+            .arg(brush.color().rgba())
+            .arg(size.width())
+            .arg(size.height())
+            .arg(node->labelColor().rgba())
+            .arg(node->labelFont().key())
+            + QChar('|') + node->labelText();
+}
 
-    QPoint offset;
-    QPixmap pixmap = sourcePixmap(Qt::LogicalCoordinates, &offset, mode);
-    if(pixmap.isNull()) {
-        return;
+QPixmap *QGraphVizNodeEffect::render(QGraphVizNode *node, const QPen &pen, const QBrush &brush, const QRectF &rect, qreal scale)
+{
+    const QSize size = (rect.size() * scale).toSize();
+    if(size.isEmpty()) {
+        return NULL;
     }
 
-    painter->save();
+    QPixmap source(size);
+    source.fill(Qt::transparent);
 
-    // Draw Opacity
-    painter->setOpacity(opacity);
+    QPainter sourcePainter(&source);
+    sourcePainter.setRenderHint(QPainter::Antialiasing);
+    sourcePainter.setRenderHint(QPainter::TextAntialiasing);
+    sourcePainter.scale(scale, scale);
+    sourcePainter.translate(-rect.topLeft());
+    node->drawContents(&sourcePainter, pen, brush, scale);
+    sourcePainter.end();
 
+    QPixmap *blurred = new QPixmap(size);
+    blurred->fill(Qt::transparent);
 
-    // Draw Blur
-    if(blurRadius >= 1.0) {
-        m_BlurFilter->draw(painter, offset, pixmap);
-    } else {
-        painter->drawPixmap(offset, pixmap);
-    }
+    QPainter blurPainter(blurred);
+    m_BlurFilter->draw(&blurPainter, QPointF(0, 0), source);
+    blurPainter.end();
 
-    painter->restore();
-}
-
-QRectF QGraphVizNodeEffect::boundingRectFor(const QRectF &sourceRect) const
-{
-    return m_BlurFilter->boundingRectFor(sourceRect);
+    return blurred;
 }
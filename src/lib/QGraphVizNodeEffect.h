@@ -31,30 +31,38 @@
 #include <QtCore>
 #include <QtGui>
 
-#include "QPixmapFilter.h"
+#include "QGraphVizLibrary.h"
 
-class QGraphVizNodeEffect : public QGraphicsEffect
+QT_BEGIN_NAMESPACE
+class QPixmapBlurFilter;
+QT_END_NAMESPACE
+
+class QGraphVizNode;
+
+class QGRAPHVIZ_EXPORT QGraphVizNodeEffect : public QObject
 {
     Q_OBJECT
 public:
     explicit QGraphVizNodeEffect(QObject *parent = 0);
 
-    qreal opacity();
-    void setOpacity(qreal opacity);
-
     qreal blurRadius();
     void setBlurRadius(qreal blurRadius);
 
+    int cacheLimit();
+    void setCacheLimit(int kilobytes);
+
+    void draw(QPainter *painter, QGraphVizNode *node, const QPen &pen, const QBrush &brush, qreal lod);
+
+public slots:
+    void clearCache();
+
 protected:
-    virtual void draw(QPainter *painter);
-    virtual QRectF boundingRectFor(const QRectF &sourceRect) const;
+    QString cacheKey(QGraphVizNode *node, const QPen &pen, const QBrush &brush, int zoomBucket);
+    QPixmap *render(QGraphVizNode *node, const QPen &pen, const QBrush &brush, const QRectF &rect, qreal scale);
 
 private:
-    qreal m_Opacity;
-    qreal m_BlurRadius;
     QPixmapBlurFilter *m_BlurFilter;
-    QPixmap m_BlurCache;
-    bool m_BlurCached;
+    QCache<QString, QPixmap> m_BlurCache;
 
 };
 
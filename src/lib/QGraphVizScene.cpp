@@ -33,194 +33,2428 @@
 
 #include "QGraphVizNode.h"
 #include "QGraphVizEdge.h"
+#include "QGraphVizNodeEffect.h"
+#include "QGraphVizLabelCache.h"
+#include "QGraphVizEdgeLayer.h"
+#include "QGraphVizGeometry.h"
+#include "QGraphVizLayoutCache.h"
+#include "QGraphVizNativeLayout.h"
+#include "QGraphVizComponents.h"
+#include "QGraphVizLayoutPool.h"
+#include "QGraphVizDotGraph.h"
+#include "QGraphVizDecompressor.h"
+#include "QGraphVizAttributes.h"
+#include "QGraphVizStyleTable.h"
+
+// Size of the square scene areas that batched edges are grouped into
+#define EDGE_TILE_SIZE 1024.0
+
+
+
+/*! GraphViz keeps global state in both the parser and the layout engines, so every call into the library is
+    serialized on this mutex; regardless of which thread it's made from, or which context it's made with.  It guards
+    the idle contexts too.
+ */
+QMutex QGraphVizScene::m_ContextMutex;
+
+/*! GraphViz layouts running in this process, or waiting on the context mutex to.  While there's one, layouts in other
+    scenes are sent to the default layout pool, so that scenes lay out side by side rather than taking turns; see
+    layoutGraph().
+ */
+QAtomicInt QGraphVizScene::m_GraphVizLayouts;
+
+/*! Every graph gets a GraphViz context of its own from parsing until it's freed, since gvFreeLayout() cleans up
+    after whichever engine the context last ran; graphs sharing one context, laid out by different engines, would be
+    cleaned up by the wrong one.  This is only about cleanup; separate contexts don't let GraphViz run in several
+    threads at once.  Freed graphs hand their contexts back here, so they don't have to be loaded again.
+ */
+QList<GVC_t*> QGraphVizScene::m_IdleContexts;
+int QGraphVizScene::m_IdleContextLimit = QThread::idealThreadCount();
+
+
+
+QGraphVizScene::QGraphVizScene(QObject *parent) :
+    QGraphicsScene(parent)
+{
+    init();
+}
+
+QGraphVizScene::QGraphVizScene(QString content, QObject *parent) :
+    QGraphicsScene(parent)
+{
+    init();
+    setContent(content);
+}
+
+void QGraphVizScene::init()
+{
+    m_Graph = NULL;
+    m_GraphContext = NULL;
+    m_LayoutEngine = "dot";
+    m_LayoutDone = false;
+    m_Generation = 1;
+    m_StageTimes = QVector<qint64>(Stage_Render + 1, -1);
+    m_NodeEffect = NULL;
+    m_LabelCache = NULL;
+    m_Asynchronous = false;
+    m_LayoutSerial = 0;
+    m_ActiveSerial = 0;
+    m_Progressive = false;
+    m_CoarseLayoutEngine = "tree";
+    m_Refining = false;
+    m_EdgeBatching = false;
+    m_LayoutCache = NULL;
+    m_GraphModified = false;
+    m_ComponentPacking = false;
+    m_LayoutPool = NULL;
+    m_UpdateDepth = 0;
+    m_AppliedUpdates = 0;
+    m_ContentFile = NULL;
+    m_HasContent = false;
+    m_DiscardContent = false;
+    m_ContentDiscarded = false;
+    m_NativeParsing = false;
+    m_Attributes = NULL;
+    m_StyleTable = NULL;
+}
+
+QGraphVizScene::~QGraphVizScene()
+{
+    // Make any queued layouts bail out early, and wait for the running ones to finish before freeing them
+    m_LayoutSerial.fetchAndAddOrdered(1);
+    foreach(QFutureWatcher<LayoutJob> *watcher, m_LayoutWatchers) {
+        watcher->disconnect(this);
+        watcher->waitForFinished();
+        LayoutJob job = watcher->result();
+        freeGraph(job.graph, job.context, job.layoutDone);
+    }
+    m_LayoutWatchers.clear();
+
+    // Batched edges were never added to the scene, so it won't delete them for us
+    clearEdgeLayers();
+    foreach(QGraphVizEdge *edge, m_Edges) {
+        if(!edge->scene()) {
+            delete edge;
+        }
+    }
+
+    freeGraph(m_Graph, m_GraphContext, m_LayoutDone);
+    m_Graph = NULL;
+    m_GraphContext = NULL;
+    m_LayoutDone = false;
+
+    delete m_ContentFile;
+    m_ContentFile = NULL;
+}
+
+
+/*! Reads GraphViz's input a line at a time, from a device or from memory that needn't be null terminated; the FILE
+    pointer agread_usergets() passes around is really one of these.
+ */
+struct ContentReader {
+    QIODevice *device;
+    const char *data;
+    qint64 size;
+    qint64 position;
+};
+
+static char *readContentLine(char *buffer, int size, FILE *stream)
+{
+    ContentReader *reader = reinterpret_cast<ContentReader*>(stream);
+
+    if(reader->device) {
+        return (reader->device->readLine(buffer, size) > 0) ? buffer : NULL;
+    }
+
+    if(size <= 1 || reader->position >= reader->size) {
+        return NULL;
+    }
+
+    const char *start = reader->data + reader->position;
+    const qint64 available = qMin<qint64>(size - 1, reader->size - reader->position);
+    const char *newline = static_cast<const char*>(memchr(start, '\n', available));
+    const qint64 length = newline ? (newline - start + 1) : available;
+
+    qMemCopy(buffer, start, length);
+    buffer[length] = '\0';
+    reader->position += length;
+
+    return buffer;
+}
+
+/*! Parses the content as it is, without a terminated copy.  The caller must hold the context mutex.
+ */
+graph_t *QGraphVizScene::readGraph(const QByteArray &content)
+{
+    ContentReader reader;
+    reader.device = NULL;
+    reader.data = content.constData();
+    reader.size = content.size();
+    reader.position = 0;
+    return agread_usergets(reinterpret_cast<FILE*>(&reader), readContentLine);
+}
+
+/*! Parses the content straight off the device.  The caller must hold the context mutex.
+ */
+graph_t *QGraphVizScene::readGraph(QIODevice *device)
+{
+    ContentReader reader;
+    reader.device = device;
+    reader.data = NULL;
+    reader.size = 0;
+    reader.position = 0;
+    return agread_usergets(reinterpret_cast<FILE*>(&reader), readContentLine);
+}
+
+/*! The content is taken to be in the local 8-bit encoding, which is what GraphViz gets; the other overloads skip the
+    conversion.
+ */
+void QGraphVizScene::setContent(QString content)
+{
+    setContent(content.toLocal8Bit());
+}
+
+/*! Takes DOT, gzip (or zstd) compressed DOT, or the binary form written by QGraphVizDotGraph::toBinary().  Compressed
+    content goes through setContent(QIODevice*), and is decompressed as it's read.
+ */
+void QGraphVizScene::setContent(const QByteArray &content)
+{
+    if(content.isEmpty()) {
+        return;
+    }
+
+    if(QGraphVizDecompressor::isCompressed(content)) {
+        QBuffer buffer;
+        buffer.setData(content);
+        buffer.open(QIODevice::ReadOnly);
+        setContent(&buffer);
+        return;
+    }
+
+    checkContent();
+
+    m_Content = content;
+    parseContent(NULL);
+}
+
+/*! Reads the content from a device that's open for reading.  When the content is to be discarded, and the scene isn't
+    asynchronous, GraphViz reads it straight off the device, and it's never held in memory as a whole at all.
+    Compressed content is decompressed a chunk at a time as it's read, so only the decompressed content is ever held,
+    if that.
+ */
+void QGraphVizScene::setContent(QIODevice *device)
+{
+    if(!device) {
+        return;
+    }
+
+    checkContent();
+
+    QScopedPointer<QGraphVizDecompressor> decompressor;
+    if(QGraphVizDecompressor::isCompressed(device->peek(4))) {
+        decompressor.reset(new QGraphVizDecompressor(device));
+        if(!decompressor->open(QIODevice::ReadOnly)) {
+            emit layoutFailed(tr("Failed to read content: %1").arg(decompressor->errorString()));
+            return;
+        }
+        device = decompressor.data();
+    }
+
+    if(m_DiscardContent && !isAsynchronous()) {
+        parseContent(device);
+        return;
+    }
+
+    m_Content = device->readAll();
+    if(m_Content.isEmpty() || (decompressor && !decompressor->atEnd())) {
+        emit layoutFailed(tr("Failed to read content: %1").arg(device->errorString()));
+        m_Content = QByteArray();
+        return;
+    }
+
+    parseContent(NULL);
+}
+
+/*! Reads the content from the file, which is memory mapped rather than read into memory where it can be; the mapping
+    stands in for the content until it's discarded.
+ */
+void QGraphVizScene::setContentFile(QString fileName)
+{
+    checkContent();
+
+    QFile *file = new QFile(fileName);
+    if(!file->open(QIODevice::ReadOnly)) {
+        emit layoutFailed(tr("Failed to open %1: %2").arg(fileName).arg(file->errorString()));
+        delete file;
+        return;
+    }
+
+    // QByteArray sizes are ints
+    uchar *data = NULL;
+    if(file->size() > 0 && file->size() <= Q_INT64_C(0x7fffffff)) {
+        data = file->map(0, file->size());
+    }
+
+    // Pipes, special files and the like can't be mapped
+    if(!data) {
+        setContent(file);
+        delete file;
+        return;
+    }
+
+    // Compressed files are decompressed out of the mapping, which goes once they have been
+    if(QGraphVizDecompressor::isCompressed(QByteArray::fromRawData(reinterpret_cast<const char*>(data), 4))) {
+        {
+            QBuffer buffer;
+            buffer.setData(QByteArray::fromRawData(reinterpret_cast<const char*>(data), (int)file->size()));
+            buffer.open(QIODevice::ReadOnly);
+            setContent(&buffer);
+        }
+        delete file;
+        return;
+    }
+
+    m_ContentFile = file;
+    m_Content = QByteArray::fromRawData(reinterpret_cast<const char*>(data), (int)file->size());
+    parseContent(NULL);
+}
+
+void QGraphVizScene::checkContent()
+{
+    if(m_HasContent || m_Graph || !m_Updates.isEmpty()) {
+        throw tr("Content has already been set.  It can only be set once.");
+    }
+}
+
+/*! Parses the content, from the device if there is one, and renders it; or starts the layout, if asynchronous
+ */
+void QGraphVizScene::parseContent(QIODevice *device)
+{
+    m_HasContent = true;
+
+    if(isAsynchronous()) {
+        startLayout();
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // The native parser needs the content as a whole; it takes no lock, and only building the graph from it does.
+    // Only the native parser reads the binary form; DOT it turns down is handed to GraphViz, in case it's only the
+    // native parser that can't read it.
+    bool native = m_NativeParsing || QGraphVizDotGraph::isBinary(device ? device->peek(4) : m_Content);
+    QGraphVizDotGraph model;
+    QByteArray deviceContent;
+    if(native) {
+        if(device) {
+            deviceContent = device->readAll();
+        }
+        const QByteArray &content = device ? deviceContent : m_Content;
+        if(!model.parse(content)) {
+            if(QGraphVizDotGraph::isBinary(content)) {
+                emit layoutFailed(tr("Failed to parse content, at line %1: %2").arg(model.errorLine()).arg(model.errorString()));
+                return;
+            }
+#ifdef QGRAPHVIZSCENE_DEBUG
+            qDebug() << __FILE__ << __LINE__ << " Native parsing failed, at line " << model.errorLine() << ": "
+                     << model.errorString();
+#endif
+            native = false;
+        }
+    }
+
+    {
+        QMutexLocker locker(&m_ContextMutex);
+#ifdef QGRAPHVIZSCENE_DEBUG
+        qDebug() << __FILE__ << __LINE__ << " GraphViz::agread_usergets() starting";
+#endif
+        if(native) {
+            m_Graph = model.toGraph();
+        } else if(device) {
+            m_Graph = deviceContent.isEmpty() ? readGraph(device) : readGraph(deviceContent);
+        } else {
+            m_Graph = readGraph(m_Content);
+        }
+        if(m_Graph) {
+            m_GraphContext = acquireContext();
+        }
+        m_StageTimes[Stage_Parse] = timer.elapsed();
+#ifdef QGRAPHVIZSCENE_DEBUG
+        qDebug() << __FILE__ << __LINE__ << " GraphViz::agread_usergets() finished";
+#endif
+    }
+
+    if(!m_Graph) {
+        emit layoutFailed(tr("Failed to parse content."));
+        return;
+    }
+
+    doRender();
+    discardContent();
+}
+
+/*! When the content is to be discarded, and once the graph has been laid out, lets go of the content (and unmaps the
+    file), which may be many times the size of the graph.  A layout that's still running may be reading it, so that
+    has to finish first.  Layouts from then on start from the graph instead: in process, the cache and the layout pool
+    are skipped, and asynchronously, the graph is written back out as DOT (which fails for graphs with subgraphs).
+ */
+bool QGraphVizScene::isDiscardingContent()
+{
+    return m_DiscardContent;
+}
+
+void QGraphVizScene::setDiscardContent(bool discard)
+{
+    m_DiscardContent = discard;
+}
+
+/*! When parsing natively, the content is parsed by QGraphVizDotGraph rather than by GraphViz, which only gets the
+    graph built from the result.  The parse itself runs outside the context mutex, so asynchronous layouts of several
+    scenes parse side by side.  DOT the native parser can't read is parsed by GraphViz after all.  This needs to be
+    set before the content is.
+ */
+bool QGraphVizScene::isNativeParsing()
+{
+    return m_NativeParsing;
+}
+
+void QGraphVizScene::setNativeParsing(bool nativeParsing)
+{
+    m_NativeParsing = nativeParsing;
+}
+
+/*! Parses the content both natively and with GraphViz, and compares the two graphs; the first difference, if there is
+    one, is described in difference.  The time each parse took, in milliseconds, and the native model itself are
+    returned where asked for.
+ */
+bool QGraphVizScene::validateNativeParsing(const QByteArray &content, QString &difference, qint64 *nativeTime,
+                                           qint64 *graphvizTime, QGraphVizDotGraph *model)
+{
+    QGraphVizDotGraph graph;
+    if(!model) {
+        model = &graph;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    const bool parsed = model->parse(content);
+    if(nativeTime) {
+        *nativeTime = timer.elapsed();
+    }
+
+    QMutexLocker locker(&m_ContextMutex);
+
+    timer.restart();
+    graph_t *graphvizGraph = readGraph(content);
+    if(graphvizTime) {
+        *graphvizTime = timer.elapsed();
+    }
+
+    bool matches = false;
+    if(!parsed) {
+        // Content that GraphViz can't parse either is a match
+        difference = tr("line %1: %2").arg(model->errorLine()).arg(model->errorString());
+        matches = !graphvizGraph;
+    } else {
+        matches = model->compare(graphvizGraph, difference);
+    }
+
+    if(graphvizGraph) {
+        agclose(graphvizGraph);
+    }
+
+    return matches;
+}
+
+void QGraphVizScene::discardContent()
+{
+    if(!m_DiscardContent || !m_HasContent || m_ContentDiscarded || !m_Graph || !m_LayoutDone
+            || !m_LayoutWatchers.isEmpty()) {
+        return;
+    }
+
+    m_Content = QByteArray();
+    delete m_ContentFile;
+    m_ContentFile = NULL;
+    m_ContentDiscarded = true;
+}
+
+
+bool QGraphVizScene::doLayout()
+{
+    if(m_LayoutDone) {
+        return true;
+    }
+
+    if(!m_Graph) {
+        return false;
+    }
+
+    emit layoutStarted();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // The cache and the workers only know the content as it was given; not after attributes have been changed
+    LayoutOptions options;
+    options.engine = m_LayoutEngine;
+    const bool original = !m_GraphModified && !m_Content.isEmpty();
+    options.cache = original ? m_LayoutCache : NULL;
+    options.componentPacking = m_ComponentPacking;
+    options.pool = (original && !QGraphVizDotGraph::isBinary(m_Content)) ? m_LayoutPool : NULL;
+
+    if(original) {
+        options.content = m_Content;
+    }
+    if(options.cache) {
+        options.key = layoutKey(options.content, options.engine, options.componentPacking);
+    }
+
+    QString error;
+    m_ComponentTimes.clear();
+    if(!layoutGraph(m_Graph, m_GraphContext, options, m_ComponentTimes, error)) {
+        emit layoutFailed(error);
+        return false;
+    }
+
+    m_StageTimes[Stage_Layout] = timer.elapsed();
+
+    updateTransform();
+
+    m_LayoutDone = true;
+    nextGeneration();
+
+    emit layoutFinished();
+    return true;
+}
+
+void QGraphVizScene::updateTransform()
+{
+    m_Translate = QPointF(-m_Graph->u.bb.LL.x, -m_Graph->u.bb.UR.y);
+    m_Scale = QPointF(1.0, -1.0);
+}
+
+void QGraphVizScene::doRender()
+{
+    if(!doLayout()) {
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    bool itemsCreated = false;
+
+    node_t *node = agfstnode(graph());
+    while(node) {
+        if(!containsNode(node->id)) {
+#ifdef QGRAPHVIZSCENE_DEBUG
+        qDebug() << __FILE__ << __LINE__ << " Creating node: " << node->id;
+#endif
+            QGraphVizNode *graphVizNode = createNode(node);
+            graphVizNode->m_Index = m_NodeIndex.count();
+            m_NodeIndex.append(graphVizNode);
+            m_Nodes.insert(node->id, graphVizNode);
+            addItem(graphVizNode);
+            itemsCreated = true;
+        }
+
+        Agedge_t *edge = agfstedge(graph(), node);
+        while(edge) {
+
+            if(!containsEdge(edge->id)) {
+#ifdef QGRAPHVIZSCENE_DEBUG
+        qDebug() << __FILE__ << __LINE__ << " Creating edge " << edge->id;
+#endif
+                QGraphVizEdge *graphVizEdge = createEdge(edge);
+                graphVizEdge->m_Index = m_EdgeIndex.count();
+                m_EdgeIndex.append(graphVizEdge);
+                m_Edges.insert(edge->id, graphVizEdge);
+                if(!m_EdgeBatching) {
+                    addItem(graphVizEdge);
+                }
+                itemsCreated = true;
+            }
+
+            edge = agnxtedge(graph(), edge, node);
+        }
+
+        node = agnxtnode(graph(), node);
+    }
+
+    if(itemsCreated) {
+        updateAdjacency();
+    }
+
+    if(m_EdgeBatching) {
+        updateEdgeLayers();
+    }
+
+    // Calculate the visible area
+    QRectF rect = sceneRect();
+    rect.setTopLeft(QPointF(0,0));
+    setSceneRect(rect);
+
+    m_StageTimes[Stage_Render] = timer.elapsed();
+
+    QList<QRectF> rects;
+    rects << rect;
+    emit QGraphicsScene::changed(rects);
+}
+
+void QGraphVizScene::onChanged()
+{
+    freeLayout();
+    nextGeneration();
+    doRender();
+}
+
+void QGraphVizScene::freeLayout()
+{
+    if(!m_LayoutDone) {
+        return;
+    }
+
+    QMutexLocker locker(&m_ContextMutex);
+#ifdef QGRAPHVIZSCENE_DEBUG
+    qDebug() << __FILE__ << __LINE__ << " GraphViz::gvFreeLayout() starting";
+#endif
+    gvFreeLayout(m_GraphContext, m_Graph);
+#ifdef QGRAPHVIZSCENE_DEBUG
+    qDebug() << __FILE__ << __LINE__ << " GraphViz::gvFreeLayout() finished";
+#endif
+    m_LayoutDone = false;
+}
+
+/*! dot; neato; circo; fdp; osage; sfdp; twopi
+ */
+QString QGraphVizScene::layoutEngine()
+{
+    return m_LayoutEngine;
+}
+
+/*! dot; neato; circo; fdp; osage; sfdp; twopi
+
+    In asynchronous mode, this supersedes any layout that is still in flight.
+ */
+void QGraphVizScene::setLayoutEngine(QString layoutEngine)
+{
+    if(layoutEngine == m_LayoutEngine) {
+        return;
+    }
+
+    m_LayoutEngine = layoutEngine;
+
+    if(isAsynchronous()) {
+        if(m_HasContent || !m_Updates.isEmpty()) {
+            startLayout();
+        }
+    } else {
+        onChanged();
+    }
+
+    emit changed();
+}
+
+
+
+/*! When asynchronous, the content is parsed and laid out on a worker thread; the items are only created once the
+    results are ready.  Progress is reported through the layoutStarted(), layoutProgress(), layoutFinished() and
+    layoutFailed() signals.  This needs to be set before the content is.
+ */
+bool QGraphVizScene::isAsynchronous()
+{
+    return m_Asynchronous;
+}
+
+void QGraphVizScene::setAsynchronous(bool asynchronous)
+{
+    m_Asynchronous = asynchronous;
+}
+
+bool QGraphVizScene::isLayoutRunning()
+{
+    return m_ActiveSerial != 0;
+}
+
+/*! When progressive, an asynchronous layout is done twice.  A quick one with the coarse layout engine comes first, so
+    the items can be shown straight away, and coarseLayoutFinished() is emitted.  Then the layout engine has its turn,
+    and once it's done, the same items move to their final places, and layoutFinished() is emitted.
+ */
+bool QGraphVizScene::isProgressive()
+{
+    return m_Progressive;
+}
+
+void QGraphVizScene::setProgressive(bool progressive)
+{
+    m_Progressive = progressive;
+}
+
+/*! The engine for the first, quick, layout when progressive; the native "tree" engine by default
+ */
+QString QGraphVizScene::coarseLayoutEngine()
+{
+    return m_CoarseLayoutEngine;
+}
+
+void QGraphVizScene::setCoarseLayoutEngine(QString layoutEngine)
+{
+    m_CoarseLayoutEngine = layoutEngine;
+}
+
+/*! GraphViz can't be interrupted in the middle of gvLayout(), so a cancelled layout is allowed to run to
+    completion in the background, and its results are thrown away.
+ */
+void QGraphVizScene::cancelLayout()
+{
+    if(!isLayoutRunning()) {
+        return;
+    }
+
+    m_LayoutSerial.fetchAndAddOrdered(1);
+    m_ActiveSerial = 0;
+    m_Refining = false;
+
+    emit layoutFailed(tr("Layout cancelled."));
+}
+
+/*! A job for the current content, updates and settings, under a new serial.  A graph built from updates alone starts
+    out as an empty digraph, and one whose content was discarded starts out as the graph written back out, with the
+    updates applied so far already in it.
+ */
+QGraphVizScene::LayoutJob QGraphVizScene::layoutJob(const QString &engine)
+{
+    LayoutJob job;
+    job.scene = this;
+    job.serial = m_LayoutSerial.fetchAndAddOrdered(1) + 1;
+    job.updates = m_Updates;
+    job.contentUpdates = 0;
+    if(m_ContentDiscarded) {
+        QMutexLocker locker(&m_ContextMutex);
+        job.content = QGraphVizComponents::content(m_Graph);
+        job.contentUpdates = m_AppliedUpdates;
+    } else {
+        job.content = m_HasContent ? m_Content : QByteArray("digraph G {}");
+    }
+    job.engine = engine;
+    job.graph = NULL;
+    job.context = NULL;
+    job.layoutDone = false;
+    job.parseTime = -1;
+    job.layoutTime = -1;
+    job.cache = m_LayoutCache;
+    job.componentPacking = m_ComponentPacking;
+    job.pool = m_LayoutPool;
+    job.refine = false;
+    job.nativeParsing = m_NativeParsing;
+    return job;
+}
+
+void QGraphVizScene::startLayout()
+{
+    const bool progressive = m_Progressive && !m_CoarseLayoutEngine.isEmpty() && m_CoarseLayoutEngine != m_LayoutEngine;
+
+    LayoutJob job = layoutJob(progressive ? m_CoarseLayoutEngine : m_LayoutEngine);
+    job.refine = progressive;
+
+    m_ActiveSerial = job.serial;
+    m_Refining = false;
+
+    QFutureWatcher<LayoutJob> *watcher = new QFutureWatcher<LayoutJob>(this);
+    connect(watcher, SIGNAL(finished()), this, SLOT(onLayoutFinished()));
+    m_LayoutWatchers.append(watcher);
+    watcher->setFuture(QtConcurrent::run(&QGraphVizScene::runLayout, job));
+
+    emit layoutStarted();
+    emit layoutProgress(0);
+}
+
+/*! The second half of a progressive layout; lays out the content again, properly this time, while the items show
+    the coarse layout.  Committed updates are laid out the same way, with the items showing the layout from before.
+ */
+void QGraphVizScene::startRefinement(bool progressive)
+{
+    LayoutJob job = layoutJob(m_LayoutEngine);
+
+    m_ActiveSerial = job.serial;
+    m_Refining = progressive;
+
+    if(!progressive) {
+        emit layoutStarted();
+        emit layoutProgress(0);
+    }
+
+    QFutureWatcher<LayoutJob> *watcher = new QFutureWatcher<LayoutJob>(this);
+    connect(watcher, SIGNAL(finished()), this, SLOT(onRefinementFinished()));
+    m_LayoutWatchers.append(watcher);
+    watcher->setFuture(QtConcurrent::run(&QGraphVizScene::runRefinement, job));
+}
+
+/*! Runs on a worker thread; it must not touch anything in the scene other than the layout serial.
+ */
+QGraphVizScene::LayoutJob QGraphVizScene::runLayout(LayoutJob job)
+{
+    QElapsedTimer timer;
+
+    if(job.content.isEmpty()) {
+        job.error = tr("The content has been discarded, and the graph can't be written back out.");
+        return job;
+    }
+
+    // Parsed natively ahead of the lock, so that parses don't wait on each other.  The workers only read DOT.  DOT
+    // the native parser turns down is handed to GraphViz, as in parseContent().
+    bool native = job.nativeParsing || QGraphVizDotGraph::isBinary(job.content);
+    if(QGraphVizDotGraph::isBinary(job.content)) {
+        job.pool = NULL;
+    }
+
+    QGraphVizDotGraph model;
+    qint64 parseTime = 0;
+    if(native) {
+        timer.start();
+        if(!model.parse(job.content)) {
+            if(QGraphVizDotGraph::isBinary(job.content)) {
+                job.error = tr("Failed to parse content, at line %1: %2").arg(model.errorLine()).arg(model.errorString());
+                return job;
+            }
+            native = false;
+        }
+        parseTime = timer.elapsed();
+    }
+
+    {
+        QMutexLocker locker(&m_ContextMutex);
+
+        // Superseded while waiting for another layout to finish
+        if(job.serial != (int)job.scene->m_LayoutSerial) {
+            return job;
+        }
+
+#ifdef QGRAPHVIZSCENE_DEBUG
+        qDebug() << __FILE__ << __LINE__ << " GraphViz::agread_usergets() starting";
+#endif
+        timer.start();
+
+        job.graph = native ? model.toGraph() : readGraph(job.content);
+        if(job.graph) {
+            job.context = acquireContext();
+        }
+
+        // The content the cache and the layout pool see has to have the updates in it too
+        if(job.graph && job.updates.count() > job.contentUpdates) {
+            QSet<void*> touched;
+            applyUpdates(job.graph, job.updates.mid(job.contentUpdates), NULL, touched);
+            job.content = QGraphVizComponents::content(job.graph);
+            if(job.content.isEmpty()) {
+                job.cache = NULL;
+                job.pool = NULL;
+            }
+        }
+        job.parseTime = parseTime + timer.elapsed();
+#ifdef QGRAPHVIZSCENE_DEBUG
+        qDebug() << __FILE__ << __LINE__ << " GraphViz::agread_usergets() finished";
+#endif
+    }
+
+    if(!job.graph) {
+        job.error = tr("Failed to parse content.");
+        return job;
+    }
+
+    QMetaObject::invokeMethod(job.scene, "onLayoutProgress", Qt::QueuedConnection,
+                              Q_ARG(int, job.serial), Q_ARG(int, 25));
+
+    if(job.serial != (int)job.scene->m_LayoutSerial) {
+        return job;
+    }
+
+    timer.restart();
+
+    LayoutOptions options;
+    options.engine = job.engine;
+    options.content = job.content;
+    options.cache = job.cache;
+    options.componentPacking = job.componentPacking;
+    options.pool = job.pool;
+    if(options.cache) {
+        options.key = layoutKey(options.content, options.engine, options.componentPacking);
+    }
+
+    if(!layoutGraph(job.graph, job.context, options, job.componentTimes, job.error)) {
+        return job;
+    }
+
+    job.layoutTime = timer.elapsed();
+    job.layoutDone = true;
+
+    QMetaObject::invokeMethod(job.scene, "onLayoutProgress", Qt::QueuedConnection,
+                              Q_ARG(int, job.serial), Q_ARG(int, 75));
+
+    return job;
+}
+
+/*! Runs on a worker thread, on a graph of its own; the scene's graph is in use by the items.  Only the geometry comes
+    back, to be applied to the scene's graph.
+ */
+QGraphVizScene::LayoutJob QGraphVizScene::runRefinement(LayoutJob job)
+{
+    job = runLayout(job);
+
+    if(job.layoutDone) {
+        QMutexLocker locker(&m_ContextMutex);
+        job.geometry = QGraphVizGeometry::fromGraph(job.graph);
+    }
+
+    freeGraph(job.graph, job.context, job.layoutDone);
+    job.graph = NULL;
+    job.context = NULL;
+    job.layoutDone = false;
+
+    return job;
+}
+
+/*! Packed and unpacked layouts of the same content differ, so they're cached apart
+ */
+QByteArray QGraphVizScene::layoutKey(const QByteArray &content, const QString &engine, bool componentPacking)
+{
+    return QGraphVizLayoutCache::key(content, componentPacking ? engine + "+pack" : engine);
+}
+
+/*! Lays out the graph with the engine; or, if the cache has seen the same content laid out by the same engine
+    before, puts the cached geometry back through GraphViz's pass-through engine instead.  Fresh layouts are added
+    to the cache.  Layout engines native to the library go through the pass-through engine too, and aren't cached.
+    With component packing, a GraphViz engine lays out each connected component separately; see layoutComponents().
+    With a layout pool, GraphViz engines run in a worker process rather than in this one.
+    Takes the context mutex itself, and only for the GraphViz calls.
+ */
+bool QGraphVizScene::layoutGraph(graph_t *graph, GVC_t *context, const LayoutOptions &options,
+                                 QList<qint64> &componentTimes, QString &error)
+{
+    if(QGraphVizNativeLayout::isNativeEngine(options.engine)) {
+        QGraphVizNativeLayout layout(options.engine);
+        {
+            QMutexLocker locker(&m_ContextMutex);
+            layout.read(graph);
+        }
+
+        if(!layout.layout()) {
+            error = layout.errorString();
+            return false;
+        }
+
+        if(!applyGeometry(graph, context, layout.geometry())) {
+            error = tr("Layout failed");
+            return false;
+        }
+
+        return true;
+    }
+
+    QGraphVizGeometry geometry;
+
+    if(options.cache && options.cache->find(options.key, geometry)) {
+#ifdef QGRAPHVIZSCENE_DEBUG
+        qDebug() << __FILE__ << __LINE__ << " Layout cache hit";
+#endif
+        if(applyGeometry(graph, context, geometry)) {
+            return true;
+        }
+
+        // Doesn't fit the graph after all; lay it out from scratch
+        options.cache->remove(options.key);
+    }
+
+    QList<QByteArray> components;
+    QList<int> sizes;
+    qreal margin = 0.0;
+    if(options.componentPacking) {
+        QMutexLocker locker(&m_ContextMutex);
+        components = QGraphVizComponents::split(graph, sizes);
+        margin = QGraphVizComponents::margin(graph);
+    }
+
+    if(!components.isEmpty()) {
+        // In this process, the components would only take turns on the context mutex
+        QGraphVizLayoutPool *pool = options.pool ? options.pool : QGraphVizLayoutPool::defaultPool();
+
+        // A worker for every component would spend more time starting processes than laying out small components
+        const int batches = pool ? pool->maximumWorkers() : components.count();
+        QList<ComponentJob> jobs = batchComponents(components, sizes, batches);
+        for(int i = 0; i < jobs.count(); ++i) {
+            jobs[i].engine = options.engine;
+            jobs[i].pool = pool;
+        }
+
+        if(pool) {
+            jobs = QtConcurrent::blockingMapped(jobs, &QGraphVizScene::layoutComponents);
+        } else {
+            for(int i = 0; i < jobs.count(); ++i) {
+                jobs[i] = layoutComponents(jobs.at(i));
+            }
+        }
+
+        QVector<QGraphVizGeometry> laidOut(components.count());
+        QVector<qint64> times(components.count(), -1);
+        foreach(const ComponentJob &job, jobs) {
+            if(!job.error.isEmpty()) {
+                error = job.error;
+                return false;
+            }
+            for(int i = 0; i < job.components.count(); ++i) {
+                laidOut[job.components.at(i)] = job.geometries.at(i);
+                times[job.components.at(i)] = job.time;
+            }
+        }
+
+        componentTimes = times.toList();
+        QList<QGraphVizGeometry> geometries = laidOut.toList();
+        geometry = QGraphVizComponents::pack(geometries, margin);
+    } else if(options.pool && !options.content.isEmpty()) {
+        if(!options.pool->layout(options.content, options.engine, geometry, error)) {
+            return false;
+        }
+    } else {
+        // Only one GraphViz layout runs in this process at a time; if another scene's already is, this one goes to a
+        // worker rather than waiting for it, given DOT to hand over and a worker to be found
+        QGraphVizLayoutPool *pool = NULL;
+        if(m_GraphVizLayouts.fetchAndAddOrdered(1) > 0 && !options.content.isEmpty()
+                && !QGraphVizDotGraph::isBinary(options.content)) {
+            pool = QGraphVizLayoutPool::defaultPool();
+        }
+
+        if(pool) {
+            m_GraphVizLayouts.deref();
+#ifdef QGRAPHVIZSCENE_DEBUG
+            qDebug() << __FILE__ << __LINE__ << " GraphViz busy; laying out in a worker";
+#endif
+            if(!pool->layout(options.content, options.engine, geometry, error)) {
+                return false;
+            }
+        } else {
+            QMutexLocker locker(&m_ContextMutex);
+#ifdef QGRAPHVIZSCENE_DEBUG
+            qDebug() << __FILE__ << __LINE__ << " GraphViz::gvLayout() starting";
+#endif
+            const bool failed = gvLayout(context, graph, options.engine.toLocal8Bit().data());
+            m_GraphVizLayouts.deref();
+#ifdef QGRAPHVIZSCENE_DEBUG
+            qDebug() << __FILE__ << __LINE__ << " GraphViz::gvLayout() finished";
+#endif
+            if(failed) {
+                error = tr("Layout failed");
+                return false;
+            }
+
+            if(options.cache) {
+                geometry = QGraphVizGeometry::fromGraph(graph);
+                locker.unlock();
+                options.cache->insert(options.key, geometry);
+            }
+
+            return true;
+        }
+    }
+
+    // Laid out elsewhere; put it through the pass-through engine
+    if(!applyGeometry(graph, context, geometry)) {
+        error = tr("Layout failed");
+        return false;
+    }
+
+    if(options.cache) {
+        options.cache->insert(options.key, geometry);
+    }
+
+    return true;
+}
+
+/*! Hands the geometry to GraphViz's pass-through engine, so the graph ends up with the same structures gvLayout()
+    leaves behind.  The attributes the geometry went through are put back as they were afterwards, so a later layout
+    of the same graph, with another engine, starts from the content and not from this layout.
+
+    \note The pass-through engine can't be skipped, even though the positions are known: it's what builds the node
+          shapes, the label sizes and the splines, in GraphViz's own memory, for the items, gvRender() and
+          gvFreeLayout(), and GraphViz has no public interface for doing that otherwise.  What can be moved out is done
+          ahead of the lock: the geometry is formatted, and indexed by name, before it's taken.
+ */
+bool QGraphVizScene::applyGeometry(graph_t *graph, GVC_t *context, const QGraphVizGeometry &geometry)
+{
+    const QGraphVizGeometry::Formatted formatted = geometry.format();
+
+    QMutexLocker locker(&m_ContextMutex);
+
+    QVector<QGraphVizGeometry::Attribute> previous;
+    if(!QGraphVizGeometry::applyTo(graph, formatted, previous)) {
+        return false;
+    }
+
+#ifdef QGRAPHVIZSCENE_DEBUG
+    qDebug() << __FILE__ << __LINE__ << " GraphViz::gvLayout() starting with " << QGraphVizGeometry::layoutEngine();
+#endif
+    const bool failed = gvLayout(context, graph, const_cast<char*>(QGraphVizGeometry::layoutEngine()));
+#ifdef QGRAPHVIZSCENE_DEBUG
+    qDebug() << __FILE__ << __LINE__ << " GraphViz::gvLayout() finished";
+#endif
+
+    QGraphVizGeometry::restore(previous);
+    return !failed;
+}
+
+/*! Shares the components out between at most the given number of batches, biggest first, each to the batch with
+    the fewest nodes so far; so the batches come out about the same size.  The components in each batch stay in the
+    order they came in.
+ */
+QList<QGraphVizScene::ComponentJob> QGraphVizScene::batchComponents(const QList<QByteArray> &components,
+                                                                     const QList<int> &sizes, int batches)
+{
+    QList<ComponentJob> jobs;
+    ComponentJob job;
+    job.pool = NULL;
+    job.time = -1;
+
+    if(batches >= components.count()) {
+        for(int i = 0; i < components.count(); ++i) {
+            job.components = QList<int>() << i;
+            job.contents = QList<QByteArray>() << components.at(i);
+            jobs.append(job);
+        }
+        return jobs;
+    }
+
+    QVector<QPair<int, int> > order;
+    for(int i = 0; i < components.count(); ++i) {
+        order.append(qMakePair(-sizes.value(i), i));
+    }
+    qStableSort(order.begin(), order.end());
+
+    QVector<QList<int> > members(qMax(1, batches));
+    QVector<int> nodes(members.count(), 0);
+    for(int i = 0; i < order.count(); ++i) {
+        int smallest = 0;
+        for(int batch = 1; batch < nodes.count(); ++batch) {
+            if(nodes.at(batch) < nodes.at(smallest)) {
+                smallest = batch;
+            }
+        }
+        members[smallest].append(order.at(i).second);
+        nodes[smallest] -= order.at(i).first;
+    }
+
+    for(int batch = 0; batch < members.count(); ++batch) {
+        job.components = members.at(batch);
+        qSort(job.components);
+        job.contents.clear();
+        foreach(int component, job.components) {
+            job.contents.append(components.at(component));
+        }
+        jobs.append(job);
+    }
+
+    return jobs;
+}
+
+/*! Lays out a batch of connected components.  With a layout pool, the batch is sent to a worker process, and the
+    batches run side by side, one per pool thread; without one, the components are parsed and laid out here, one
+    after the other.
+ */
+QGraphVizScene::ComponentJob QGraphVizScene::layoutComponents(const ComponentJob &job)
+{
+    ComponentJob result(job);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    if(result.pool) {
+        result.pool->layout(result.contents, result.engine, result.geometries, result.error);
+        result.time = timer.elapsed();
+        return result;
+    }
+
+    LayoutOptions options;
+    options.engine = result.engine;
+    options.cache = NULL;
+    options.componentPacking = false;
+    options.pool = NULL;
+
+    foreach(const QByteArray &content, result.contents) {
+        graph_t *graph = NULL;
+        GVC_t *context = NULL;
+        {
+            QMutexLocker locker(&m_ContextMutex);
+            graph = readGraph(content);
+            if(graph) {
+                context = acquireContext();
+            }
+        }
+
+        if(!graph) {
+            result.error = tr("Failed to parse content.");
+            return result;
+        }
+
+        QList<qint64> componentTimes;
+        const bool layoutDone = layoutGraph(graph, context, options, componentTimes, result.error);
+        if(layoutDone) {
+            QMutexLocker locker(&m_ContextMutex);
+            result.geometries.append(QGraphVizGeometry::fromGraph(graph));
+        }
+
+        freeGraph(graph, context, layoutDone);
+
+        if(!layoutDone) {
+            return result;
+        }
+    }
+
+    result.time = timer.elapsed();
+    return result;
+}
+
+
+
+void QGraphVizScene::onLayoutProgress(int serial, int percent)
+{
+    if(serial == m_ActiveSerial) {
+        // A progressive layout's coarse half takes up the first half of the progress
+        emit layoutProgress(m_Refining ? 50 + (percent / 2) : percent);
+    }
+}
+
+void QGraphVizScene::onLayoutFinished()
+{
+    QFutureWatcher<LayoutJob> *watcher = static_cast<QFutureWatcher<LayoutJob>*>(sender());
+    m_LayoutWatchers.removeAll(watcher);
+    watcher->deleteLater();
+
+    LayoutJob job = watcher->result();
+
+    // Cancelled, or superseded by a newer layout; throw the results away
+    if(job.serial != m_ActiveSerial) {
+        freeGraph(job.graph, job.context, job.layoutDone);
+        discardContent();
+        return;
+    }
+
+    m_ActiveSerial = 0;
+
+    m_StageTimes[Stage_Parse] = job.parseTime;
+    m_StageTimes[Stage_Layout] = job.layoutTime;
+    m_ComponentTimes = job.componentTimes;
+
+    if(!job.error.isEmpty()) {
+        freeGraph(job.graph, job.context, job.layoutDone);
+        emit layoutFailed(job.error);
+        return;
+    }
+
+    // Replace the old graph (if any) with the new one, and recreate the items for it
+    clearItems();
+    freeGraph(m_Graph, m_GraphContext, m_LayoutDone);
+
+    m_Graph = job.graph;
+    m_GraphContext = job.context;
+    m_AppliedUpdates = job.updates.count();
+    foldUpdates(job.updates.count(), job.content);
+    m_GraphModified = m_AppliedUpdates > 0;
+    m_LayoutDone = true;
+    updateTransform();
+    nextGeneration();
+
+    doRender();
+
+    if(job.refine) {
+        emit layoutProgress(50);
+        emit coarseLayoutFinished();
+        startRefinement();
+        return;
+    }
+
+    discardContent();
+
+    emit layoutProgress(100);
+    emit layoutFinished();
+}
+
+/*! Swaps the refined geometry into the graph the items already point at, and moves the items in place.  The updates
+    the job was laid out with are applied to the graph first; only the items that moved or were updated are updated,
+    the ones for removed nodes and edges are deleted, and doRender() creates the ones for new nodes and edges.
+ */
+void QGraphVizScene::onRefinementFinished()
+{
+    QFutureWatcher<LayoutJob> *watcher = static_cast<QFutureWatcher<LayoutJob>*>(sender());
+    m_LayoutWatchers.removeAll(watcher);
+    watcher->deleteLater();
+
+    LayoutJob job = watcher->result();
+
+    // Cancelled, or superseded; the coarse layout stays
+    if(job.serial != m_ActiveSerial || !m_Graph) {
+        discardContent();
+        return;
+    }
+
+    m_ActiveSerial = 0;
+    m_Refining = false;
+
+    m_StageTimes[Stage_Layout] = job.layoutTime;
+    m_ComponentTimes = job.componentTimes;
+
+    if(!job.error.isEmpty()) {
+        emit layoutFailed(job.error);
+        return;
+    }
+
+    LayoutSnapshot before = snapshot();
+    freeLayout();
+
+    QSet<void*> touched;
+    if(job.updates.count() > m_AppliedUpdates) {
+        clearEdgeLayers();
+        {
+            QMutexLocker locker(&m_ContextMutex);
+            applyUpdates(m_Graph, job.updates.mid(m_AppliedUpdates), this, touched);
+        }
+        compactItems();
+        m_AppliedUpdates = job.updates.count();
+        foldUpdates(job.updates.count(), job.content);
+        m_GraphModified = true;
+    }
+
+    // The items can't be left pointing at a graph without a layout
+    if(!applyGeometry(m_Graph, m_GraphContext, job.geometry)) {
+        clearItems();
+        emit layoutFailed(tr("Layout failed"));
+        return;
+    }
+
+    m_LayoutDone = true;
+    updateTransform();
+    nextGeneration();
+
+    updateMovedItems(before, touched);
+    doRender();
+
+    // The earlier layout's extent no longer applies
+    updateSceneRect();
+    discardContent();
+
+    emit layoutProgress(100);
+    emit layoutFinished();
+}
+
+/*! An idle context if there is one, or a new one.  The caller must hold the context mutex.
+ */
+GVC_t *QGraphVizScene::acquireContext()
+{
+    if(!m_IdleContexts.isEmpty()) {
+        return m_IdleContexts.takeLast();
+    }
+
+#ifdef QGRAPHVIZSCENE_DEBUG
+    qDebug() << __FILE__ << __LINE__ << " GraphViz::gvContext() creating a context";
+#endif
+    return gvContext();
+}
+
+/*! Frees the graph's layout and the graph, and hands its context back to the idle contexts (or frees it, if there are
+    enough of those already).
+ */
+void QGraphVizScene::freeGraph(graph_t *graph, GVC_t *context, bool layoutDone)
+{
+    if(!graph) {
+        return;
+    }
+
+    QMutexLocker locker(&m_ContextMutex);
+
+    if(layoutDone) {
+#ifdef QGRAPHVIZSCENE_DEBUG
+        qDebug() << __FILE__ << __LINE__ << " GraphViz::gvFreeLayout() starting";
+#endif
+        gvFreeLayout(context, graph);
+#ifdef QGRAPHVIZSCENE_DEBUG
+        qDebug() << __FILE__ << __LINE__ << " GraphViz::gvFreeLayout() finished";
+#endif
+    }
+
+#ifdef QGRAPHVIZSCENE_DEBUG
+        qDebug() << __FILE__ << __LINE__ << " GraphViz::agclose() starting";
+#endif
+    agclose(graph);
+#ifdef QGRAPHVIZSCENE_DEBUG
+        qDebug() << __FILE__ << __LINE__ << " GraphViz::agclose() finished";
+#endif
+
+    if(!context) {
+        return;
+    }
+
+    if(m_IdleContexts.count() < m_IdleContextLimit) {
+        m_IdleContexts.append(context);
+    } else {
+        gvFreeContext(context);
+    }
+}
+
+/*! Groups the edges by head and tail node in two passes: count the degrees, then drop every edge in its slot.
+ */
+void QGraphVizScene::updateAdjacency()
+{
+    const int nodeCount = m_NodeIndex.count();
+
+    m_HeadOffsets.fill(0, nodeCount + 1);
+    m_TailOffsets.fill(0, nodeCount + 1);
+
+    foreach(QGraphVizEdge *edge, m_EdgeIndex) {
+        // Resolve these now, rather than through a lookup later on
+        edge->m_Head = getNode(edge->m_GraphVizEdge->head->id);
+        edge->m_Tail = getNode(edge->m_GraphVizEdge->tail->id);
+
+        if(edge->m_Head) {
+            ++m_HeadOffsets[edge->m_Head->m_Index + 1];
+        }
+        if(edge->m_Tail) {
+            ++m_TailOffsets[edge->m_Tail->m_Index + 1];
+        }
+    }
+
+    for(int i = 0; i < nodeCount; ++i) {
+        m_HeadOffsets[i + 1] += m_HeadOffsets[i];
+        m_TailOffsets[i + 1] += m_TailOffsets[i];
+    }
+
+    m_HeadEdges.resize(m_HeadOffsets[nodeCount]);
+    m_TailEdges.resize(m_TailOffsets[nodeCount]);
+
+    QVector<int> headCursor = m_HeadOffsets;
+    QVector<int> tailCursor = m_TailOffsets;
+    foreach(QGraphVizEdge *edge, m_EdgeIndex) {
+        if(edge->m_Head) {
+            m_HeadEdges[headCursor[edge->m_Head->m_Index]++] = edge;
+        }
+        if(edge->m_Tail) {
+            m_TailEdges[tailCursor[edge->m_Tail->m_Index]++] = edge;
+        }
+    }
+}
+
+QGraphVizEdgeRange QGraphVizScene::headEdges(QGraphVizNode *node)
+{
+    const int index = node->m_Index;
+    if(index < 0 || index + 1 >= m_HeadOffsets.count()) {
+        return QGraphVizEdgeRange();
+    }
+
+    QGraphVizEdge * const *edges = m_HeadEdges.constData();
+    return QGraphVizEdgeRange(edges + m_HeadOffsets.at(index), edges + m_HeadOffsets.at(index + 1));
+}
+
+QGraphVizEdgeRange QGraphVizScene::tailEdges(QGraphVizNode *node)
+{
+    const int index = node->m_Index;
+    if(index < 0 || index + 1 >= m_TailOffsets.count()) {
+        return QGraphVizEdgeRange();
+    }
+
+    QGraphVizEdge * const *edges = m_TailEdges.constData();
+    return QGraphVizEdgeRange(edges + m_TailOffsets.at(index), edges + m_TailOffsets.at(index + 1));
+}
+
+
+
+/*! Collects every node below the given one, without descending past collapsed nodes (the collapsed nodes
+    themselves are collected, though).  The walk is iterative and visits each node once, so shared callees and
+    cycles don't blow up the work or the stack.
+ */
+void QGraphVizScene::collectDescendants(QGraphVizNode *node, QVector<QGraphVizNode*> &nodes)
+{
+    QBitArray visited(m_NodeIndex.count());
+    visited.setBit(node->m_Index);
+
+    QVector<QGraphVizNode*> stack;
+    stack.append(node);
+
+    while(!stack.isEmpty()) {
+        QGraphVizNode *current = stack.last();
+        stack.pop_back();
+
+        if(current != node && current->isCollapsed()) {
+            continue;
+        }
+
+        foreach(QGraphVizEdge *edge, tailEdges(current)) {
+            QGraphVizNode *head = edge->m_Head;
+            if(!head || visited.testBit(head->m_Index)) {
+                continue;
+            }
+
+            visited.setBit(head->m_Index);
+            nodes.append(head);
+            stack.append(head);
+        }
+    }
+}
+
+/*! Walks up from the edges on the stack toward the root, collecting the edges whose highlight state needs to
+    change.  It stops at edges that are already in the requested state, and at transparent nodes.
+ */
+void QGraphVizScene::collectHighlightPath(QVector<QGraphVizEdge*> &stack, bool highlighted, QVector<QGraphVizEdge*> &edges)
+{
+    QBitArray visited(m_EdgeIndex.count());
+
+    while(!stack.isEmpty()) {
+        QGraphVizEdge *current = stack.last();
+        stack.pop_back();
+
+        if(visited.testBit(current->m_Index)) {
+            continue;
+        }
+        visited.setBit(current->m_Index);
+
+        QGraphVizNode *tail = current->m_Tail;
+        if(!tail || tail->isTransparent() || current->isHighlighted() == highlighted) {
+            continue;
+        }
+
+        edges.append(current);
+
+        foreach(QGraphVizEdge *edge, headEdges(tail)) {
+            if(!visited.testBit(edge->m_Index)) {
+                stack.append(edge);
+            }
+        }
+    }
+}
+
+void QGraphVizScene::propagateCollapse(QGraphVizNode *node, bool collapse)
+{
+    node->m_Collapsed = collapse;
+
+    QVector<QGraphVizNode*> nodes;
+    collectDescendants(node, nodes);
+
+    foreach(QGraphVizNode *descendant, nodes) {
+        descendant->applyTransparent(collapse);
+    }
+
+    nodes.append(node);
+    updateItems(nodes);
+}
+
+void QGraphVizScene::propagateTransparency(QGraphVizNode *node, bool transparent)
+{
+    QVector<QGraphVizNode*> nodes;
+    nodes.append(node);
+
+    if(!node->isCollapsed()) {
+        collectDescendants(node, nodes);
+    }
+
+    foreach(QGraphVizNode *affected, nodes) {
+        affected->applyTransparent(transparent);
+    }
+
+    updateItems(nodes);
+}
+
+void QGraphVizScene::propagateHighlight(QGraphVizNode *node, bool highlighted)
+{
+    QVector<QGraphVizEdge*> stack;
+    foreach(QGraphVizEdge *edge, headEdges(node)) {
+        stack.append(edge);
+    }
+
+    QVector<QGraphVizEdge*> edges;
+    collectHighlightPath(stack, highlighted, edges);
+
+    foreach(QGraphVizEdge *edge, edges) {
+        edge->m_Highlighted = highlighted;
+    }
+
+    updateItems(edges);
+}
+
+void QGraphVizScene::propagateHighlight(QGraphVizEdge *edge, bool highlighted)
+{
+    QVector<QGraphVizEdge*> stack;
+    stack.append(edge);
+
+    QVector<QGraphVizEdge*> edges;
+    collectHighlightPath(stack, highlighted, edges);
+
+    foreach(QGraphVizEdge *affected, edges) {
+        affected->m_Highlighted = highlighted;
+    }
+
+    updateItems(edges);
+}
+
+/*! Schedules a single repaint covering the nodes and their outgoing edges (which are drawn according to the state
+    of their tail), rather than one per item.
+ */
+void QGraphVizScene::updateItems(const QVector<QGraphVizNode*> &nodes)
+{
+    QRectF rect;
+    foreach(QGraphVizNode *node, nodes) {
+        rect |= node->sceneBoundingRect();
+        foreach(QGraphVizEdge *edge, tailEdges(node)) {
+            if(edge->m_Layer) {
+                edge->m_Layer->invalidate();
+            }
+            rect |= edge->sceneBoundingRect();
+        }
+    }
+
+    if(!rect.isNull()) {
+        update(rect);
+    }
+}
+
+void QGraphVizScene::updateItems(const QVector<QGraphVizEdge*> &edges)
+{
+    QRectF rect;
+    foreach(QGraphVizEdge *edge, edges) {
+        if(edge->m_Layer) {
+            edge->m_Layer->invalidate();
+        }
+        rect |= edge->sceneBoundingRect();
+    }
+
+    if(!rect.isNull()) {
+        update(rect);
+    }
+}
+
+void QGraphVizScene::updateEdges(QGraphVizNode *node)
+{
+    QVector<QGraphVizEdge*> edges;
+    foreach(QGraphVizEdge *edge, headEdges(node)) {
+        edges.append(edge);
+    }
+    foreach(QGraphVizEdge *edge, tailEdges(node)) {
+        edges.append(edge);
+    }
+
+    updateItems(edges);
+}
+
+
+
+/*! Updates made between beginUpdate() and commitUpdate() are laid out together, once, when the outermost batch is
+    committed; outside of a batch, each one is laid out on its own.  Nodes and edges are named as in the DOT content,
+    and those that an update refers to but that don't exist are ignored, except that adding an edge adds its nodes.
+
+    Only the items that moved, or whose attributes changed, are updated; the ones for removed nodes and edges are
+    deleted, and those for new ones are created.  When asynchronous, the relayout happens on a worker thread; with
+    content set, the content and every update so far are laid out afresh, so the cache and the layout pool can still
+    be used.  Without content, the updates build up a directed graph from nothing.
+ */
+void QGraphVizScene::beginUpdate()
+{
+    ++m_UpdateDepth;
+}
+
+/*! Returns false if the relayout failed (layoutFailed() is emitted too), or if there was no batch to commit.  When
+    asynchronous, it returns as soon as the relayout has been started.
+ */
+bool QGraphVizScene::commitUpdate()
+{
+    if(m_UpdateDepth <= 0) {
+        return false;
+    }
+
+    if(--m_UpdateDepth > 0) {
+        return true;
+    }
+
+    return flushUpdates();
+}
+
+bool QGraphVizScene::isUpdating()
+{
+    return m_UpdateDepth > 0;
+}
+
+/*! Adds the node if it doesn't exist yet, and sets the attributes on it either way.  A node that's created gets the
+    node attributes first, as a DOT node statement's new node gets the node defaults; an existing one keeps its own.
+ */
+void QGraphVizScene::addNode(QString name, QHash<QString, QString> attributes, QHash<QString, QString> nodeAttributes)
+{
+    Update update;
+    update.type = Update::AddNode;
+    update.tail = name.toLocal8Bit();
+    foreach(const QString &key, attributes.keys()) {
+        update.attributes.append(qMakePair(key.toLocal8Bit(), attributes.value(key).toLocal8Bit()));
+    }
+    foreach(const QString &key, nodeAttributes.keys()) {
+        update.nodeAttributes.append(qMakePair(key.toLocal8Bit(), nodeAttributes.value(key).toLocal8Bit()));
+    }
+    queueUpdate(update);
+}
+
+/*! Removes the node and all of its edges
+ */
+void QGraphVizScene::removeNode(QString name)
+{
+    Update update;
+    update.type = Update::RemoveNode;
+    update.tail = name.toLocal8Bit();
+    queueUpdate(update);
+}
+
+/*! Adds an edge, and any of its nodes that don't exist yet; those nodes get the node attributes, as a DOT edge
+    statement's nodes get the node defaults.  In a strict graph, this updates the attributes of the edge if there
+    already is one.
+ */
+void QGraphVizScene::addEdge(QString tail, QString head, QHash<QString, QString> attributes,
+                             QHash<QString, QString> nodeAttributes)
+{
+    Update update;
+    update.type = Update::AddEdge;
+    update.tail = tail.toLocal8Bit();
+    update.head = head.toLocal8Bit();
+    foreach(const QString &key, attributes.keys()) {
+        update.attributes.append(qMakePair(key.toLocal8Bit(), attributes.value(key).toLocal8Bit()));
+    }
+    foreach(const QString &key, nodeAttributes.keys()) {
+        update.nodeAttributes.append(qMakePair(key.toLocal8Bit(), nodeAttributes.value(key).toLocal8Bit()));
+    }
+    queueUpdate(update);
+}
+
+/*! Removes the first edge from the tail to the head
+ */
+void QGraphVizScene::removeEdge(QString tail, QString head)
+{
+    Update update;
+    update.type = Update::RemoveEdge;
+    update.tail = tail.toLocal8Bit();
+    update.head = head.toLocal8Bit();
+    queueUpdate(update);
+}
+
+void QGraphVizScene::setGraphAttribute(QString name, QString value)
+{
+    Update update;
+    update.type = Update::SetGraphAttributes;
+    update.attributes.append(qMakePair(name.toLocal8Bit(), value.toLocal8Bit()));
+    queueUpdate(update);
+}
+
+void QGraphVizScene::setNodeAttribute(QString node, QString name, QString value)
+{
+    Update update;
+    update.type = Update::SetNodeAttributes;
+    update.tail = node.toLocal8Bit();
+    update.attributes.append(qMakePair(name.toLocal8Bit(), value.toLocal8Bit()));
+    queueUpdate(update);
+}
+
+/*! Sets the attribute on the first edge from the tail to the head
+ */
+void QGraphVizScene::setEdgeAttribute(QString tail, QString head, QString name, QString value)
+{
+    Update update;
+    update.type = Update::SetEdgeAttributes;
+    update.tail = tail.toLocal8Bit();
+    update.head = head.toLocal8Bit();
+    update.attributes.append(qMakePair(name.toLocal8Bit(), value.toLocal8Bit()));
+    queueUpdate(update);
+}
+
+void QGraphVizScene::queueUpdate(const Update &update)
+{
+    m_PendingUpdates.append(update);
+
+    if(!m_UpdateDepth) {
+        flushUpdates();
+    }
+}
+
+/*! Lays out the pending updates; see beginUpdate()
+ */
+bool QGraphVizScene::flushUpdates()
+{
+    if(m_PendingUpdates.isEmpty()) {
+        return true;
+    }
+
+    m_Updates += m_PendingUpdates;
+    const QList<Update> updates = m_PendingUpdates;
+    m_PendingUpdates.clear();
+
+    // A layout of the content that is still running gets superseded by one that includes the updates
+    if(isAsynchronous()) {
+        if(m_Graph) {
+            startRefinement(false);
+        } else {
+            startLayout();
+        }
+        return true;
+    }
+
+    LayoutSnapshot before = snapshot();
+    freeLayout();
+
+    QSet<void*> touched;
+    clearEdgeLayers();
+    {
+        QMutexLocker locker(&m_ContextMutex);
+        if(!m_Graph) {
+            m_GraphContext = acquireContext();
+            m_Graph = agopen((char*)"G", AGDIGRAPH);
+        }
+        applyUpdates(m_Graph, updates, this, touched);
+    }
+    compactItems();
+
+    m_AppliedUpdates = m_Updates.count();
+    m_GraphModified = true;
+
+    // The items can't be left pointing at a graph without a layout
+    if(!doLayout()) {
+        clearItems();
+        return false;
+    }
+
+    foldUpdates(m_AppliedUpdates, QByteArray());
+
+    updateMovedItems(before, touched);
+    doRender();
+    updateSceneRect();
+
+    return true;
+}
+
+/*! Drops the first count updates from the log, once the scene's graph has them; the log would otherwise grow with
+    every update for as long as the scene lives.  An asynchronous scene lays out from the content, so the content
+    becomes the one the updates were laid out from, written back out with them applied; if it couldn't be written,
+    the updates stay.  A synchronous scene, or one whose content was discarded, lays out from the scene's graph,
+    which already has them.
+ */
+void QGraphVizScene::foldUpdates(int count, const QByteArray &content)
+{
+    if(count <= 0) {
+        return;
+    }
+
+    if(isAsynchronous() && !m_ContentDiscarded) {
+        if(content.isEmpty()) {
+            return;
+        }
+
+        // The content may have been standing in for a mapped file
+        m_Content = content;
+        delete m_ContentFile;
+        m_ContentFile = NULL;
+        m_HasContent = true;
+    }
+
+    m_Updates = m_Updates.mid(count);
+    m_AppliedUpdates -= count;
+}
+
+static void setAttributes(void *object, const QList<QPair<QByteArray, QByteArray> > &attributes)
+{
+    if(!object) {
+        return;
+    }
+
+    for(int i = 0; i < attributes.count(); ++i) {
+        QByteArray name = attributes.at(i).first;
+        QByteArray value = attributes.at(i).second;
+        agsafeset(object, name.data(), value.data(), (char*)"");
+    }
+}
+
+/*! Applies the updates to the graph.  With a scene, the items of the nodes and edges that are removed are deleted
+    (leaving holes in the indexes for compactItems() to close); the ones that are added, or have their attributes
+    set, go in touched, along with the graph itself if one of its attributes is set.  The caller must hold the
+    context mutex.
+ */
+void QGraphVizScene::applyUpdates(graph_t *graph, const QList<Update> &updates, QGraphVizScene *scene,
+                                  QSet<void*> &touched)
+{
+    foreach(const Update &update, updates) {
+        void *object = NULL;
+        node_t *tail = agfindnode(graph, const_cast<char*>(update.tail.constData()));
+        node_t *head = update.head.isEmpty() ? NULL : agfindnode(graph, const_cast<char*>(update.head.constData()));
+
+        switch(update.type) {
+        case Update::AddNode:
+            if(!tail) {
+                tail = agnode(graph, const_cast<char*>(update.tail.constData()));
+                setAttributes(tail, update.nodeAttributes);
+            }
+            object = tail;
+            break;
+
+        case Update::RemoveNode:
+            if(tail) {
+                if(scene) {
+                    scene->deleteItems(tail);
+                }
+                agdelete(graph, tail);
+            }
+            break;
+
+        case Update::AddEdge:
+            if(!tail) {
+                tail = agnode(graph, const_cast<char*>(update.tail.constData()));
+                setAttributes(tail, update.nodeAttributes);
+            }
+            if(!head) {
+                head = agnode(graph, const_cast<char*>(update.head.constData()));
+                setAttributes(head, update.nodeAttributes);
+            }
+            object = agedge(graph, tail, head);
+            break;
+
+        case Update::RemoveEdge:
+            if(tail && head) {
+                edge_t *edge = agfindedge(graph, tail, head);
+                if(edge) {
+                    if(scene) {
+                        scene->deleteItems(edge);
+                    }
+                    agdelete(graph, edge);
+                }
+            }
+            break;
+
+        case Update::SetGraphAttributes:
+            object = graph;
+            break;
+
+        case Update::SetNodeAttributes:
+            object = tail;
+            break;
+
+        case Update::SetEdgeAttributes:
+            if(tail && head) {
+                object = agfindedge(graph, tail, head);
+            }
+            break;
+        }
+
+        if(!object) {
+#ifdef QGRAPHVIZSCENE_DEBUG
+            if(update.type != Update::RemoveNode && update.type != Update::RemoveEdge) {
+                qDebug() << __FILE__ << __LINE__ << " Ignoring an update for a missing node or edge: " << update.tail << update.head;
+            }
+#endif
+            continue;
+        }
+
+        setAttributes(object, update.attributes);
+
+        touched.insert(object);
+    }
+}
+
+/*! Deletes the items of the node and of its edges, before GraphViz deletes them
+ */
+void QGraphVizScene::deleteItems(node_t *node)
+{
+    for(edge_t *edge = agfstedge(m_Graph, node); edge; edge = agnxtedge(m_Graph, edge, node)) {
+        deleteItems(edge);
+    }
 
+    QGraphVizNode *graphVizNode = m_Nodes.take(node->id);
+    if(!graphVizNode) {
+        return;
+    }
 
+    m_NodeIndex[graphVizNode->m_Index] = NULL;
+    removeItem(graphVizNode);
+    delete graphVizNode;
+}
 
-GVC_t *QGraphVizScene::m_Context = gvContext();
+void QGraphVizScene::deleteItems(edge_t *edge)
+{
+    QGraphVizEdge *graphVizEdge = m_Edges.take(edge->id);
+    if(!graphVizEdge) {
+        return;
+    }
 
+    m_EdgeIndex[graphVizEdge->m_Index] = NULL;
+    if(graphVizEdge->scene() == this) {
+        removeItem(graphVizEdge);
+    }
+    delete graphVizEdge;
+}
 
+/*! Closes the holes deleteItems() left in the indexes, and regroups the edges
+ */
+void QGraphVizScene::compactItems()
+{
+    int nodeCount = 0;
+    for(int i = 0; i < m_NodeIndex.count(); ++i) {
+        if(QGraphVizNode *node = m_NodeIndex.at(i)) {
+            node->m_Index = nodeCount;
+            m_NodeIndex[nodeCount++] = node;
+        }
+    }
 
-QGraphVizScene::QGraphVizScene(QObject *parent) :
-    QGraphicsScene(parent),
-    m_Graph(NULL),
-    m_LayoutEngine("dot"),
-    m_LayoutDone(false)
+    int edgeCount = 0;
+    for(int i = 0; i < m_EdgeIndex.count(); ++i) {
+        if(QGraphVizEdge *edge = m_EdgeIndex.at(i)) {
+            edge->m_Index = edgeCount;
+            m_EdgeIndex[edgeCount++] = edge;
+        }
+    }
+
+    if(nodeCount == m_NodeIndex.count() && edgeCount == m_EdgeIndex.count()) {
+        return;
+    }
+
+    m_NodeIndex.resize(nodeCount);
+    m_EdgeIndex.resize(edgeCount);
+    updateAdjacency();
+}
+
+/*! Where every item is in the current layout, in scene coordinates, to tell afterwards which ones moved
+ */
+QGraphVizScene::LayoutSnapshot QGraphVizScene::snapshot()
 {
+    LayoutSnapshot snapshot;
+    if(!m_LayoutDone) {
+        return snapshot;
+    }
+
+    foreach(QGraphVizNode *node, m_NodeIndex) {
+        snapshot.nodes.insert(node->m_GraphVizNode, nodeOutline(node->m_GraphVizNode));
+    }
+    foreach(QGraphVizEdge *edge, m_EdgeIndex) {
+        snapshot.edges.insert(edge->m_GraphVizEdge, edgeOutline(edge->m_GraphVizEdge));
+    }
+
+    return snapshot;
 }
 
-QGraphVizScene::QGraphVizScene(QString content, QObject *parent) :
-    QGraphicsScene(parent),
-    m_Graph(NULL),
-    m_LayoutEngine("dot"),
-    m_LayoutDone(false)
+QRectF QGraphVizScene::nodeOutline(node_t *node)
 {
-    setContent(content);
+    return QRectF(transformPoint(node->u.coord), QSizeF(node->u.width * 72.0, node->u.height * 72.0));
 }
 
-QGraphVizScene::~QGraphVizScene()
+/*! The spline points of the edge, followed by its label position
+ */
+QPolygonF QGraphVizScene::edgeOutline(edge_t *edge)
 {
-    if(m_LayoutDone) {
-#ifdef QGRAPHVIZSCENE_DEBUG
-        qDebug() << __FILE__ << __LINE__ << " GraphViz::gvFreeLayout() starting";
-#endif
-        gvFreeLayout(m_Context, m_Graph);
-#ifdef QGRAPHVIZSCENE_DEBUG
-        qDebug() << __FILE__ << __LINE__ << " GraphViz::gvFreeLayout() finished";
-#endif
-        m_LayoutDone = false;
+    QPolygonF outline;
+
+    if(edge->u.spl) {
+        for(int i = 0; i < edge->u.spl->size; ++i) {
+            const bezier &bez = edge->u.spl->list[i];
+            for(int j = 0; j < bez.size; ++j) {
+                outline.append(transformPoint(bez.list[j]));
+            }
+            outline.append(transformPoint(bez.sp));
+            outline.append(transformPoint(bez.ep));
+        }
     }
 
-    if(m_Graph) {
-#ifdef QGRAPHVIZSCENE_DEBUG
-        qDebug() << __FILE__ << __LINE__ << " GraphViz::agclose() starting";
-#endif
-        agclose(m_Graph);
-#ifdef QGRAPHVIZSCENE_DEBUG
-        qDebug() << __FILE__ << __LINE__ << " GraphViz::agclose() finished";
-#endif
-        m_Graph = NULL;
+    if(edge->u.label && edge->u.label->set) {
+        outline.append(transformPoint(edge->u.label->pos));
     }
-}
 
+    return outline;
+}
 
-void QGraphVizScene::setContent(QString content)
+/*! Updates the items that moved since the snapshot, or that were touched by updates, and marks the rest as up to date
+    for the current generation
+ */
+void QGraphVizScene::updateMovedItems(const LayoutSnapshot &before, const QSet<void*> &touched)
 {
-    if(content.isEmpty()) {
-        return;
+    const bool all = touched.contains(m_Graph);
+
+    foreach(QGraphVizNode *node, m_NodeIndex) {
+        node_t *graphVizNode = node->m_GraphVizNode;
+        if(all || touched.contains(graphVizNode) || !before.nodes.contains(graphVizNode)
+                || before.nodes.value(graphVizNode) != nodeOutline(graphVizNode)) {
+            node->updateGeometry();
+        } else {
+            node->m_Generation = m_Generation;
+        }
     }
 
-    if(!m_Content.isEmpty()) {
-        throw tr("Content has already been set.  It can only be set once.");
+    foreach(QGraphVizEdge *edge, m_EdgeIndex) {
+        edge_t *graphVizEdge = edge->m_GraphVizEdge;
+        if(all || touched.contains(graphVizEdge) || !before.edges.contains(graphVizEdge)
+                || before.edges.value(graphVizEdge) != edgeOutline(graphVizEdge)) {
+            edge->updateGeometry();
+        } else {
+            edge->m_Generation = m_Generation;
+        }
     }
+}
 
-    m_Content = content;
+void QGraphVizScene::updateSceneRect()
+{
+    QRectF rect = itemsBoundingRect();
+    rect.setTopLeft(QPointF(0,0));
+    setSceneRect(rect);
+}
 
-#ifdef QGRAPHVIZSCENE_DEBUG
-        qDebug() << __FILE__ << __LINE__ << " GraphViz::agmemread() starting";
-#endif
-    m_Graph = agmemread(m_Content.toLocal8Bit().data());
-#ifdef QGRAPHVIZSCENE_DEBUG
-        qDebug() << __FILE__ << __LINE__ << " GraphViz::agmemread() finished";
-#endif
 
-    doRender();
+
+/*! When batching, edges aren't added to the scene individually.  They're grouped by position into square tiles, and
+    each tile is drawn by a single QGraphVizEdgeLayer item that strokes all of its edges in a few merged paths.  The
+    edge items still exist, so highlighting, createEdge() overrides and edgeAt() keep working.  This needs to be set
+    before the content is.
+ */
+bool QGraphVizScene::isEdgeBatching()
+{
+    return m_EdgeBatching;
 }
 
+void QGraphVizScene::setEdgeBatching(bool edgeBatching)
+{
+    if(!m_Edges.isEmpty()) {
+        throw tr("Edge batching can only be changed before the content is set.");
+    }
+
+    m_EdgeBatching = edgeBatching;
+}
 
-void QGraphVizScene::doLayout()
+/*! Finds the topmost visible edge passing through the given scene position; whether batched or not.
+ */
+QGraphVizEdge *QGraphVizScene::edgeAt(const QPointF &pos)
 {
-    if(m_LayoutDone) {
-        return;
+    QPainterPathStroker stroker;
+
+    foreach(QGraphicsItem *item, items(pos)) {
+        if(item->type() == (QGraphicsItem::UserType + 3)) {
+            QGraphVizEdgeLayer *layer = static_cast<QGraphVizEdgeLayer*>(item);
+            QGraphVizEdge *edge = layer->edgeAt(pos);
+            if(edge) {
+                return edge;
+            }
+        } else if(item->type() == (QGraphicsItem::UserType + 2)) {
+            QGraphVizEdge *edge = dynamic_cast<QGraphVizEdge*>(item);
+            if(!edge || !edge->head() || !edge->tail() || !edge->head()->isVisible() || !edge->tail()->isVisible()) {
+                continue;
+            }
+
+            stroker.setWidth(qMax(edge->style().pen.widthF(), qreal(1.0)) + 4.0);
+            QPointF local = edge->mapFromScene(pos);
+            if(stroker.createStroke(edge->m_Path).contains(local) || stroker.createStroke(edge->m_PathArrow).contains(local)) {
+                return edge;
+            }
+        }
     }
 
-#ifdef QGRAPHVIZSCENE_DEBUG
-        qDebug() << __FILE__ << __LINE__ << " GraphViz::gvLayout() starting";
-#endif
-    if(gvLayout(m_Context, m_Graph, m_LayoutEngine.toLocal8Bit().data())) {
-        throw tr("Layout failed");
+    return NULL;
+}
+
+void QGraphVizScene::updateEdgeLayers()
+{
+    clearEdgeLayers();
+
+    QHash<QPair<int, int>, QGraphVizEdgeLayer*> tiles;
+    foreach(QGraphVizEdge *edge, m_EdgeIndex) {
+        if(edge->m_Generation != m_Generation) {
+            edge->updateGeometry();
+        }
+
+        const QPointF center = edge->sceneBoundingRect().center();
+        const QPair<int, int> tile(qFloor(center.x() / EDGE_TILE_SIZE), qFloor(center.y() / EDGE_TILE_SIZE));
+
+        QGraphVizEdgeLayer *layer = tiles.value(tile, NULL);
+        if(!layer) {
+            layer = new QGraphVizEdgeLayer(this);
+            tiles.insert(tile, layer);
+            m_EdgeLayers.append(layer);
+        }
+
+        layer->addEdge(edge);
     }
-#ifdef QGRAPHVIZSCENE_DEBUG
-        qDebug() << __FILE__ << __LINE__ << " GraphViz::gvLayout() finished";
-#endif
 
-    m_Translate = QPointF(-m_Graph->u.bb.LL.x, -m_Graph->u.bb.UR.y);
-    m_Scale = QPointF(1.0, -1.0);
+    foreach(QGraphVizEdgeLayer *layer, m_EdgeLayers) {
+        addItem(layer);
+    }
+}
 
-    m_LayoutDone = true;
+void QGraphVizScene::clearEdgeLayers()
+{
+    foreach(QGraphVizEdgeLayer *layer, m_EdgeLayers) {
+        removeItem(layer);
+        delete layer;
+    }
+    m_EdgeLayers.clear();
+
+    foreach(QGraphVizEdge *edge, m_EdgeIndex) {
+        edge->m_Layer = NULL;
+    }
 }
 
-void QGraphVizScene::doRender()
+void QGraphVizScene::clearItems()
 {
-    doLayout();
+    clearEdgeLayers();
 
-    node_t *node = agfstnode(graph());
-    while(node) {
-        if(!containsNode(node->id)) {
-#ifdef QGRAPHVIZSCENE_DEBUG
-        qDebug() << __FILE__ << __LINE__ << " Creating node: " << node->id;
-#endif
-            QGraphVizNode *graphVizNode = createNode(node);
-            m_Nodes.insert(node->id, graphVizNode);
-            addItem(graphVizNode);
+    foreach(QGraphVizEdge *edge, m_Edges) {
+        if(edge->scene() == this) {
+            removeItem(edge);
         }
+        delete edge;
+    }
+    m_Edges.clear();
 
-        Agedge_t *edge = agfstedge(graph(), node);
-        while(edge) {
+    foreach(QGraphVizNode *node, m_Nodes) {
+        removeItem(node);
+        delete node;
+    }
+    m_Nodes.clear();
+
+    m_NodeIndex.clear();
+    m_EdgeIndex.clear();
+    m_HeadOffsets.clear();
+    m_HeadEdges.clear();
+    m_TailOffsets.clear();
+    m_TailEdges.clear();
+
+    // Nothing refers to the styles any more
+    if(m_StyleTable) {
+        m_StyleTable->clear();
+    }
 
-            if(!containsEdge(edge->id)) {
-#ifdef QGRAPHVIZSCENE_DEBUG
-        qDebug() << __FILE__ << __LINE__ << " Creating edge " << edge->id;
-#endif
-                QGraphVizEdge *graphVizEdge = createEdge(edge);
-                m_Edges.insert(edge->id, graphVizEdge);
-                addItem(graphVizEdge);
-            }
+    setSceneRect(QRectF());
+}
 
-            edge = agnxtedge(graph(), edge, node);
-        }
 
-        node = agnxtnode(graph(), node);
+
+/*! The generation is bumped whenever the layout or the attributes of the graph change.  Items remember the
+    generation they last updated their geometry for, so a simple comparison tells them whether to update again.
+ */
+quint64 QGraphVizScene::generation()
+{
+    return m_Generation;
+}
+
+void QGraphVizScene::nextGeneration()
+{
+    ++m_Generation;
+
+    // Anything that was cached for the old geometry is useless now
+    if(m_NodeEffect) {
+        m_NodeEffect->clearCache();
     }
 
-    // Calculate the visible area
-    QRectF rect = sceneRect();
-    rect.setTopLeft(QPointF(0,0));
-    setSceneRect(rect);
+    // Attributes may have been declared, or the graph replaced
+    if(m_Attributes) {
+        m_Attributes->invalidate();
+    }
+}
 
-    QList<QRectF> rects;
-    rects << rect;
-    emit QGraphicsScene::changed(rects);
+/*! Wall clock time, in milliseconds, the last run of a stage took; -1 if it hasn't run.  Parsing is agread_usergets(),
+    layout is gvLayout() and render is creating and updating the items in doRender().
+ */
+qint64 QGraphVizScene::stageTime(Stage stage)
+{
+    return m_StageTimes.value(stage, -1);
 }
 
-void QGraphVizScene::onChanged()
+QGraphVizLayoutCache *QGraphVizScene::layoutCache()
 {
-    if(m_LayoutDone) {
-#ifdef QGRAPHVIZSCENE_DEBUG
-        qDebug() << __FILE__ << __LINE__ << " GraphViz::gvFreeLayout() starting";
-#endif
-        gvFreeLayout(m_Context, m_Graph);
-#ifdef QGRAPHVIZSCENE_DEBUG
-        qDebug() << __FILE__ << __LINE__ << " GraphViz::gvFreeLayout() finished";
-#endif
-        m_LayoutDone = false;
+    return m_LayoutCache;
+}
+
+/*! Lays out through the cache from now on; NULL turns caching off.  The scene doesn't take ownership, so one cache
+    can serve many scenes, but it has to outlive them.
+ */
+void QGraphVizScene::setLayoutCache(QGraphVizLayoutCache *layoutCache)
+{
+    m_LayoutCache = layoutCache;
+}
+
+/*! Runs GraphViz's layout engines in worker processes from the pool, rather than in this process; so a graph that
+    takes too long or too much memory, or crashes GraphViz, only takes the worker down.  The pool isn't owned by the
+    scene, and can be shared.  Native engines, and graphs whose attributes have been changed, are still laid out here.
+
+    Without a pool of its own, a scene still lays out in a worker from the default pool (see
+    QGraphVizLayoutPool::defaultPool()) when GraphViz is already busy laying out another graph in this process; so
+    several scenes lay out side by side.  Parsing, and building the items from the geometry that comes back, still
+    take turns.
+ */
+QGraphVizLayoutPool *QGraphVizScene::layoutPool()
+{
+    return m_LayoutPool;
+}
+
+void QGraphVizScene::setLayoutPool(QGraphVizLayoutPool *layoutPool)
+{
+    m_LayoutPool = layoutPool;
+}
+
+/*! When packing components, a graph that falls apart into several connected components is laid out a component
+    at a time, and the pieces are packed together in rows; the pack attribute sets the space between them, as for
+    GraphViz's own packing.  Only GraphViz engines are split, and not graphs with subgraphs.
+
+    The components are laid out side by side in worker processes: the scene's layout pool, or else the default one
+    (see QGraphVizLayoutPool::defaultPool()).  They're shared out in batches, one for each worker the pool runs at
+    once, with about as many nodes in each; so a graph of thousands of small components doesn't start thousands of
+    workers.  If there's no worker to be found, they're laid out here, one after the other; GraphViz can't lay out
+    two graphs at once in one process.
+ */
+bool QGraphVizScene::isComponentPacking()
+{
+    return m_ComponentPacking;
+}
+
+void QGraphVizScene::setComponentPacking(bool componentPacking)
+{
+    m_ComponentPacking = componentPacking;
+}
+
+/*! Wall clock time, in milliseconds, each component took in the last packed layout, parsing included; empty if the
+    last layout wasn't split up.  Components laid out in the same worker all get the time the worker took.
+ */
+QList<qint64> QGraphVizScene::componentTimes()
+{
+    return m_ComponentTimes;
+}
+
+/*! How many GraphViz contexts are kept for reuse once their graphs are freed; by default, one per core, which is as
+    many asynchronous layouts as the global thread pool has running at once.  Contexts in use aren't limited; there's
+    one for every graph alive, in every scene.
+ */
+int QGraphVizScene::idleContextLimit()
+{
+    QMutexLocker locker(&m_ContextMutex);
+    return m_IdleContextLimit;
+}
+
+void QGraphVizScene::setIdleContextLimit(int limit)
+{
+    QMutexLocker locker(&m_ContextMutex);
+    m_IdleContextLimit = qMax(0, limit);
+    while(m_IdleContexts.count() > m_IdleContextLimit) {
+        gvFreeContext(m_IdleContexts.takeLast());
     }
+}
 
-    doRender();
+/*! Frees the contexts kept for reuse; say, before the application exits, or after closing a batch of scenes
+ */
+void QGraphVizScene::freeIdleContexts()
+{
+    QMutexLocker locker(&m_ContextMutex);
+    while(!m_IdleContexts.isEmpty()) {
+        gvFreeContext(m_IdleContexts.takeLast());
+    }
 }
 
-/*! dot; neato; circo; fdp; osage; sfdp; twopi
+/*! The effect shared by every blurred node in the scene; use it to adjust the blur radius or the cache size.
  */
-QString QGraphVizScene::layoutEngine()
+QGraphVizNodeEffect *QGraphVizScene::nodeEffect()
 {
-    return m_LayoutEngine;
+    if(!m_NodeEffect) {
+        m_NodeEffect = new QGraphVizNodeEffect(this);
+    }
+
+    return m_NodeEffect;
 }
 
-/*! dot; neato; circo; fdp; osage; sfdp; twopi
+/*! Laid out labels, shared by every node and edge in the scene; they don't depend on the layout, so they survive a
+    new generation.
  */
-void QGraphVizScene::setLayoutEngine(QString layoutEngine)
+QGraphVizLabelCache *QGraphVizScene::labelCache()
 {
-    if(layoutEngine == m_LayoutEngine) {
-        return;
+    if(!m_LabelCache) {
+        m_LabelCache = new QGraphVizLabelCache(this);
     }
 
-    m_LayoutEngine = layoutEngine;
+    return m_LabelCache;
+}
 
-    onChanged();
-    emit changed();
+/*! The attributes of the graph, as symbols and interned values; what items read their colors and the like through,
+    rather than getAttributes().
+ */
+QGraphVizAttributes *QGraphVizScene::attributes()
+{
+    if(!m_Attributes) {
+        m_Attributes = new QGraphVizAttributes(this);
+    }
+
+    m_Attributes->setGraph(m_Graph);
+    return m_Attributes;
+}
+
+/*! The pens, brushes, label styles and node shapes shared by the scene's items
+ */
+QGraphVizStyleTable *QGraphVizScene::styleTable()
+{
+    if(!m_StyleTable) {
+        m_StyleTable = new QGraphVizStyleTable(this);
+    }
+
+    return m_StyleTable;
+}
+
+/*! Approximate bytes held by the scene's node and edge items.  With shared false, it's what they'd hold if each of
+    them had its own copy of its style and shape, as they used to; comparing the two shows what sharing saves.  Qt's
+    private data behind the pens, brushes and fonts isn't counted either way (see QGraphVizStyleTable::memoryUsage()).
+ */
+qint64 QGraphVizScene::itemMemoryUsage(bool shared)
+{
+    QGraphVizStyleTable *styles = styleTable();
+
+    qint64 bytes = 0;
+
+    // Removed items leave gaps in the indices until they're compacted
+    foreach(QGraphVizNode *node, m_NodeIndex) {
+        if(!node) {
+            continue;
+        }
+
+        bytes += sizeof(QGraphVizNode) + (node->m_LabelText.capacity() * sizeof(QChar));
+        if(!shared) {
+            bytes += QGraphVizStyleTable::memoryUsage(styles->style(node->m_Style))
+                    + QGraphVizStyleTable::memoryUsage(styles->path(node->m_Shape));
+        }
+    }
+
+    foreach(QGraphVizEdge *edge, m_EdgeIndex) {
+        if(!edge) {
+            continue;
+        }
+
+        bytes += sizeof(QGraphVizEdge) + (edge->m_LabelText.capacity() * sizeof(QChar))
+                + QGraphVizStyleTable::memoryUsage(edge->m_Path)
+                + QGraphVizStyleTable::memoryUsage(edge->m_PathArrow)
+                + QGraphVizStyleTable::memoryUsage(edge->m_PathArrowSimple);
+        foreach(const QPainterPath &path, edge->m_PathLevels) {
+            bytes += QGraphVizStyleTable::memoryUsage(path);
+        }
+        if(!shared) {
+            bytes += QGraphVizStyleTable::memoryUsage(styles->style(edge->m_Style));
+        }
+    }
+
+    if(shared) {
+        bytes += styles->memoryUsage();
+    }
+
+    return bytes;
 }
 
 /*! dot; xdot; png; svg; plain; etc.
  */
 QByteArray QGraphVizScene::exportContent(QString renderEngine)
 {
-    doLayout();
+    if(!doLayout()) {
+        return QByteArray();
+    }
+
+    QMutexLocker locker(&m_ContextMutex);
 
     char *content;
     unsigned int length;
 #ifdef QGRAPHVIZSCENE_DEBUG
         qDebug() << __FILE__ << __LINE__ << " GraphViz::gvRenderData() starting";
 #endif
-    if(gvRenderData(m_Context, m_Graph, renderEngine.toLocal8Bit().data(), &content, &length)) {
+    if(gvRenderData(m_GraphContext, m_Graph, renderEngine.toLocal8Bit().data(), &content, &length)) {
         throw tr("Failed to render.");
     }
 #ifdef QGRAPHVIZSCENE_DEBUG
@@ -311,6 +2545,9 @@ bool QGraphVizScene::containsEdge(int GVID)
 
 
 
+/*! Every attribute as a string, defaults and all; a new hash of new strings on each call, so nothing that runs often
+    should use these.  See attributes().
+ */
 QHash<QString, QString> QGraphVizScene::getAttributes()
 {
     QHash<QString,QString> attr;
@@ -388,16 +2625,38 @@ QHash<QString, QString> QGraphVizScene::getAttributes(Agedge_t *edge)
 
 
 
+void QGraphVizScene::setAttribute(QString name, QString value)
+{
+    agsafeset(m_Graph, name.toLocal8Bit().data(), value.toLocal8Bit().data(), (char*)"");
+    m_GraphModified = true;
+    nextGeneration();
+    update();
+}
+
+void QGraphVizScene::setAttribute(Agnode_t *node, QString name, QString value)
+{
+    agsafeset(node, name.toLocal8Bit().data(), value.toLocal8Bit().data(), (char*)"");
+    m_GraphModified = true;
+    nextGeneration();
+    update();
+}
+
+void QGraphVizScene::setAttribute(Agedge_t *edge, QString name, QString value)
+{
+    agsafeset(edge, name.toLocal8Bit().data(), value.toLocal8Bit().data(), (char*)"");
+    m_GraphModified = true;
+    nextGeneration();
+    update();
+}
+
+
+
 QByteArray QGraphVizScene::getHash()
 {
     QCryptographicHash md5(QCryptographicHash::Md5);
     md5.addData((char*)m_Graph, sizeof(Agraph_t));
 
-    // Serialize and add attributes
-    QByteArray attributes;
-    QDataStream ds(&attributes, QIODevice::WriteOnly);
-    ds << getAttributes();
-    md5.addData(attributes);
+    hashAttributes(md5, m_Graph);
 
     node_t *node = agfstnode(m_Graph);
     while(node) {
@@ -418,11 +2677,7 @@ QByteArray QGraphVizScene::getHash(Agedge_t *edge)
     QCryptographicHash md5(QCryptographicHash::Md5);
     md5.addData((char*)edge, sizeof(Agedge_t));
 
-    // Serialize and add attributes
-    QByteArray attributes;
-    QDataStream ds(&attributes, QIODevice::WriteOnly);
-    ds << getAttributes(edge);
-    md5.addData(attributes);
+    hashAttributes(md5, edge);
 
     // Add splines
     if(edge->u.spl) {
@@ -452,11 +2707,7 @@ QByteArray QGraphVizScene::getHash(Agnode_t *node)
     QCryptographicHash md5(QCryptographicHash::Md5);
     md5.addData((char*)node, sizeof(Agnode_t));
 
-    // Serialize and add attributes
-    QByteArray attributes;
-    QDataStream ds(&attributes, QIODevice::WriteOnly);
-    ds << getAttributes(node);
-    md5.addData(attributes);
+    hashAttributes(md5, node);
 
     if(node->u.shape) {
         md5.addData((char*)node->u.shape, sizeof(shape_desc));
@@ -476,6 +2727,19 @@ QByteArray QGraphVizScene::getHash(Agnode_t *node)
     return md5.result();
 }
 
+/*! Adds each attribute's name and value, straight from GraphViz; the values include the defaults
+ */
+void QGraphVizScene::hashAttributes(QCryptographicHash &hash, void *object)
+{
+    for(Agsym_t *symbol = agfstattr(object); symbol; symbol = agnxtattr(object, symbol)) {
+        const char *value = agxget(object, symbol->index);
+        hash.addData(symbol->name, qstrlen(symbol->name) + 1);
+        if(value) {
+            hash.addData(value, qstrlen(value) + 1);
+        }
+    }
+}
+
 QByteArray QGraphVizScene::getHash(textlabel_t *label)
 {
     QCryptographicHash md5(QCryptographicHash::Md5);
@@ -34,9 +34,19 @@
 #include <graphviz/types.h>
 
 #include "QGraphVizLibrary.h"
+#include "QGraphVizEdgeRange.h"
+#include "QGraphVizGeometry.h"
 
 class QGraphVizNode;
 class QGraphVizEdge;
+class QGraphVizNodeEffect;
+class QGraphVizLabelCache;
+class QGraphVizEdgeLayer;
+class QGraphVizLayoutCache;
+class QGraphVizLayoutPool;
+class QGraphVizDotGraph;
+class QGraphVizAttributes;
+class QGraphVizStyleTable;
 
 class QGRAPHVIZ_EXPORT QGraphVizScene : public QGraphicsScene
 {
@@ -47,6 +57,17 @@ public:
     ~QGraphVizScene();
 
     void setContent(QString content);
+    void setContent(const QByteArray &content);
+    void setContent(QIODevice *device);
+    void setContentFile(QString fileName);
+
+    bool isDiscardingContent();
+    void setDiscardContent(bool discard = true);
+
+    bool isNativeParsing();
+    void setNativeParsing(bool nativeParsing = true);
+    static bool validateNativeParsing(const QByteArray &content, QString &difference, qint64 *nativeTime = 0,
+                                      qint64 *graphvizTime = 0, QGraphVizDotGraph *model = 0);
 
     QMap<QString, QString> arguments();
 
@@ -55,15 +76,74 @@ public:
     QString layoutEngine();
     void setLayoutEngine(QString layoutEngine);
 
+    bool isAsynchronous();
+    void setAsynchronous(bool asynchronous = true);
+    bool isLayoutRunning();
+
+    bool isProgressive();
+    void setProgressive(bool progressive = true);
+    QString coarseLayoutEngine();
+    void setCoarseLayoutEngine(QString layoutEngine);
+
+    QGraphVizLayoutCache *layoutCache();
+    void setLayoutCache(QGraphVizLayoutCache *layoutCache);
+
+    QGraphVizLayoutPool *layoutPool();
+    void setLayoutPool(QGraphVizLayoutPool *layoutPool);
+
+    bool isComponentPacking();
+    void setComponentPacking(bool componentPacking = true);
+    QList<qint64> componentTimes();
+
+    void beginUpdate();
+    bool commitUpdate();
+    bool isUpdating();
+
+    void addNode(QString name, QHash<QString, QString> attributes = QHash<QString, QString>(),
+                 QHash<QString, QString> nodeAttributes = QHash<QString, QString>());
+    void removeNode(QString name);
+    void addEdge(QString tail, QString head, QHash<QString, QString> attributes = QHash<QString, QString>(),
+                 QHash<QString, QString> nodeAttributes = QHash<QString, QString>());
+    void removeEdge(QString tail, QString head);
+    void setGraphAttribute(QString name, QString value);
+    void setNodeAttribute(QString node, QString name, QString value);
+    void setEdgeAttribute(QString tail, QString head, QString name, QString value);
+
+    bool isEdgeBatching();
+    void setEdgeBatching(bool edgeBatching = true);
+    QGraphVizEdge *edgeAt(const QPointF &pos);
+
+    quint64 generation();
+
+    enum Stage { Stage_Parse, Stage_Layout, Stage_Render };
+    qint64 stageTime(Stage stage);
+
+    QGraphVizNodeEffect *nodeEffect();
+    QGraphVizLabelCache *labelCache();
+    QGraphVizAttributes *attributes();
+    QGraphVizStyleTable *styleTable();
+    qint64 itemMemoryUsage(bool shared = true);
+
+    static int idleContextLimit();
+    static void setIdleContextLimit(int limit);
+    static void freeIdleContexts();
+
 signals:
     void changed();
 
+    void layoutStarted();
+    void layoutProgress(int percent);
+    void coarseLayoutFinished();
+    void layoutFinished();
+    void layoutFailed(QString message);
+
 public slots:
     virtual void doRender();
+    void cancelLayout();
 
 protected slots:
     void onChanged();
-    void doLayout();
+    bool doLayout();
 
 protected:
     graph_t *graph();
@@ -75,10 +155,17 @@ protected:
     QHash<QString, QString> getAttributes(Agnode_t *node);
     QHash<QString, QString> getAttributes(Agedge_t *edge);
 
+    void setAttribute(QString name, QString value);
+    void setAttribute(Agnode_t *node, QString name, QString value);
+    void setAttribute(Agedge_t *edge, QString name, QString value);
+
+    void nextGeneration();
+
     QByteArray getHash();
     QByteArray getHash(Agedge_t *edge);
     QByteArray getHash(Agnode_t *node);
     QByteArray getHash(textlabel_t *label);
+    void hashAttributes(QCryptographicHash &hash, void *object);
 
     virtual QGraphVizNode *createNode(node_t *node);
     QList<QGraphVizNode*> getNodes();
@@ -90,11 +177,129 @@ protected:
     QGraphVizEdge *getEdge(int GVID);
     bool containsEdge(int GVID);
 
+    QGraphVizEdgeRange headEdges(QGraphVizNode *node);
+    QGraphVizEdgeRange tailEdges(QGraphVizNode *node);
+
+    void propagateCollapse(QGraphVizNode *node, bool collapse);
+    void propagateTransparency(QGraphVizNode *node, bool transparent);
+    void propagateHighlight(QGraphVizNode *node, bool highlighted);
+    void propagateHighlight(QGraphVizEdge *edge, bool highlighted);
+
+    void updateItems(const QVector<QGraphVizNode*> &nodes);
+    void updateItems(const QVector<QGraphVizEdge*> &edges);
+    void updateEdges(QGraphVizNode *node);
+
+private slots:
+    void onLayoutProgress(int serial, int percent);
+    void onLayoutFinished();
+    void onRefinementFinished();
+
 private:
-    static GVC_t *m_Context;
+    struct Update {
+        enum Type { AddNode, RemoveNode, AddEdge, RemoveEdge, SetGraphAttributes, SetNodeAttributes, SetEdgeAttributes };
+        Type type;
+        QByteArray tail;
+        QByteArray head;
+        QList<QPair<QByteArray, QByteArray> > attributes;
+        QList<QPair<QByteArray, QByteArray> > nodeAttributes;
+    };
 
-    QString m_Content;
+    struct LayoutSnapshot {
+        QHash<node_t*, QRectF> nodes;
+        QHash<edge_t*, QPolygonF> edges;
+    };
+
+    struct LayoutJob {
+        QGraphVizScene *scene;
+        int serial;
+        QByteArray content;
+        QString engine;
+        graph_t *graph;
+        GVC_t *context;
+        bool layoutDone;
+        QString error;
+        qint64 parseTime;
+        qint64 layoutTime;
+        QGraphVizLayoutCache *cache;
+        bool componentPacking;
+        QGraphVizLayoutPool *pool;
+        QList<qint64> componentTimes;
+        bool refine;
+        QGraphVizGeometry geometry;
+        QList<Update> updates;
+        int contentUpdates;
+        bool nativeParsing;
+    };
+
+    struct LayoutOptions {
+        QString engine;
+        QByteArray content;
+        QGraphVizLayoutCache *cache;
+        QByteArray key;
+        bool componentPacking;
+        QGraphVizLayoutPool *pool;
+    };
+
+    struct ComponentJob {
+        QList<int> components;
+        QList<QByteArray> contents;
+        QString engine;
+        QGraphVizLayoutPool *pool;
+        QList<QGraphVizGeometry> geometries;
+        QString error;
+        qint64 time;
+    };
+
+    static graph_t *readGraph(const QByteArray &content);
+    static graph_t *readGraph(QIODevice *device);
+    void checkContent();
+    void parseContent(QIODevice *device);
+    void discardContent();
+
+    static LayoutJob runLayout(LayoutJob job);
+    static LayoutJob runRefinement(LayoutJob job);
+    static QByteArray layoutKey(const QByteArray &content, const QString &engine, bool componentPacking);
+    static bool layoutGraph(graph_t *graph, GVC_t *context, const LayoutOptions &options, QList<qint64> &componentTimes,
+                            QString &error);
+    static bool applyGeometry(graph_t *graph, GVC_t *context, const QGraphVizGeometry &geometry);
+    static QList<ComponentJob> batchComponents(const QList<QByteArray> &components, const QList<int> &sizes,
+                                               int batches);
+    static ComponentJob layoutComponents(const ComponentJob &job);
+    static GVC_t *acquireContext();
+    static void freeGraph(graph_t *graph, GVC_t *context, bool layoutDone);
+    static void applyUpdates(graph_t *graph, const QList<Update> &updates, QGraphVizScene *scene, QSet<void*> &touched);
+    LayoutJob layoutJob(const QString &engine);
+    void startLayout();
+    void startRefinement(bool progressive = true);
+    void init();
+    void queueUpdate(const Update &update);
+    bool flushUpdates();
+    void foldUpdates(int count, const QByteArray &content);
+    void freeLayout();
+    void deleteItems(node_t *node);
+    void deleteItems(edge_t *edge);
+    void compactItems();
+    LayoutSnapshot snapshot();
+    QRectF nodeOutline(node_t *node);
+    QPolygonF edgeOutline(edge_t *edge);
+    void updateMovedItems(const LayoutSnapshot &before, const QSet<void*> &touched);
+    void updateSceneRect();
+    void updateTransform();
+    void updateAdjacency();
+    void updateEdgeLayers();
+    void clearEdgeLayers();
+    void collectDescendants(QGraphVizNode *node, QVector<QGraphVizNode*> &nodes);
+    void collectHighlightPath(QVector<QGraphVizEdge*> &stack, bool highlighted, QVector<QGraphVizEdge*> &edges);
+    void clearItems();
+
+    static QMutex m_ContextMutex;
+    static QAtomicInt m_GraphVizLayouts;
+    static QList<GVC_t*> m_IdleContexts;
+    static int m_IdleContextLimit;
+
+    QByteArray m_Content;
     graph_t *m_Graph;
+    GVC_t *m_GraphContext;
 
     QPointF m_Translate;
     QPointF m_Scale;
@@ -102,11 +307,63 @@ private:
     QString m_LayoutEngine;
     bool m_LayoutDone;
 
+    quint64 m_Generation;
+    QVector<qint64> m_StageTimes;
+
+    QGraphVizNodeEffect *m_NodeEffect;
+    QGraphVizLabelCache *m_LabelCache;
+
+    bool m_Asynchronous;
+    QAtomicInt m_LayoutSerial;
+    int m_ActiveSerial;
+    QList<QFutureWatcher<LayoutJob>*> m_LayoutWatchers;
+
+    bool m_Progressive;
+    QString m_CoarseLayoutEngine;
+    bool m_Refining;
+
     QHash<int, QGraphVizNode*> m_Nodes;
     QHash<int, QGraphVizEdge*> m_Edges;
 
+    // Items by index, and the edges grouped by the index of their head and tail nodes (compressed sparse rows)
+    QVector<QGraphVizNode*> m_NodeIndex;
+    QVector<QGraphVizEdge*> m_EdgeIndex;
+    QVector<int> m_HeadOffsets;
+    QVector<QGraphVizEdge*> m_HeadEdges;
+    QVector<int> m_TailOffsets;
+    QVector<QGraphVizEdge*> m_TailEdges;
+
+    bool m_EdgeBatching;
+    QList<QGraphVizEdgeLayer*> m_EdgeLayers;
+
+    QGraphVizLayoutCache *m_LayoutCache;
+    bool m_GraphModified;
+
+    bool m_ComponentPacking;
+    QList<qint64> m_ComponentTimes;
+
+    QGraphVizLayoutPool *m_LayoutPool;
+
+    // Every update since the content was set, and how many of them the graph has had applied so far
+    int m_UpdateDepth;
+    QList<Update> m_PendingUpdates;
+    QList<Update> m_Updates;
+    int m_AppliedUpdates;
+
+    // The file the content is mapped from, if it is
+    QFile *m_ContentFile;
+    bool m_HasContent;
+    bool m_DiscardContent;
+    bool m_ContentDiscarded;
+
+    bool m_NativeParsing;
+
+    QGraphVizAttributes *m_Attributes;
+    QGraphVizStyleTable *m_StyleTable;
+
     friend class QGraphVizNode;
     friend class QGraphVizEdge;
+    friend class QGraphVizEdgeLayer;
 };
 
 #endif // QGRAPHVIZ_H
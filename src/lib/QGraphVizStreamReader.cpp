@@ -0,0 +1,555 @@
+/*!
+   \file
+   \author Dane Gardner <dane.gardner@gmail.com>
+   \version
+
+   \section LICENSE
+   This file is part of the Parallel Tools GUI Framework (PTGF)
+   Copyright (C) 2010-2011 Argo Navis Technologies, LLC
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+   \section DESCRIPTION
+
+ */
+
+
+#include "QGraphVizStreamReader.h"
+
+#include "QGraphVizScene.h"
+
+static inline bool isBlank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+}
+
+static inline bool isPunctuation(char c)
+{
+    return c == '[' || c == ']' || c == '{' || c == '}' || c == '=' || c == ',' || c == ';' || c == ':';
+}
+
+bool QGraphVizStreamReader::Token::isPunctuation() const
+{
+    return !quoted && text.length() == 1 && ::isPunctuation(text.at(0));
+}
+
+
+/*! Feeds a live-growing graph into the scene as it arrives on the device (a pipe, a socket or a process, typically),
+    through the scene's update API.  Statements are gathered into one batch, which is committed at most once per
+    interval; while an asynchronous relayout is still running, the next one waits for it, so that a fast stream can't
+    keep superseding layouts before they finish.
+
+    In the DOT format, each line holds whole statements: node and edge statements (edge chains included), graph,
+    node and edge attribute statements, and ID=ID graph attributes.  The graph header, subgraph braces and comments
+    are skipped; subgraph members are added to the graph itself, and undirected edges become directed ones unless
+    the scene's content was undirected to begin with.  As in GraphViz, the nodes an edge statement creates get the
+    node defaults, and ports on an edge's nodes become its tailport and headport.  In the edge list format, each line
+    is a tail and a head, or a lone node, optionally followed by name=value attributes.
+ */
+QGraphVizStreamReader::QGraphVizStreamReader(QGraphVizScene *scene, QIODevice *device, QObject *parent) :
+    QObject(parent),
+    m_Scene(scene),
+    m_Format(Format_Dot),
+    m_Interval(250),
+    m_LineNumber(0),
+    m_StatementCount(0),
+    m_Updating(false),
+    m_CommitWaiting(false)
+{
+    m_CommitTimer.setSingleShot(true);
+    connect(&m_CommitTimer, SIGNAL(timeout()), this, SLOT(flush()));
+
+    connect(m_Scene, SIGNAL(layoutFinished()), this, SLOT(onLayoutFinished()));
+    connect(m_Scene, SIGNAL(layoutFailed(QString)), this, SLOT(onLayoutFinished()));
+
+    m_LastCommit.start();
+
+    setDevice(device);
+}
+
+/*! Whatever has been read, but not committed yet, is committed; unless the scene has gone first
+ */
+QGraphVizStreamReader::~QGraphVizStreamReader()
+{
+    if(m_Scene) {
+        flush();
+    }
+}
+
+QGraphVizScene *QGraphVizStreamReader::scene()
+{
+    return m_Scene;
+}
+
+QIODevice *QGraphVizStreamReader::device()
+{
+    return m_Device;
+}
+
+/*! Starts reading from the device, which has to be open already.  Anything the old device left unread, or half a
+    line, is dropped; what was read from it is committed.
+ */
+void QGraphVizStreamReader::setDevice(QIODevice *device)
+{
+    if(m_Device) {
+        m_Device->disconnect(this);
+    }
+
+    flush();
+    m_Buffer.clear();
+    m_LineNumber = 0;
+    m_Device = device;
+
+    if(!m_Device) {
+        return;
+    }
+
+    connect(m_Device, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+    connect(m_Device, SIGNAL(readChannelFinished()), this, SLOT(onReadChannelFinished()));
+
+    // There may be something to read already; and files never say there's more
+    QMetaObject::invokeMethod(this, "onReadyRead", Qt::QueuedConnection);
+}
+
+QGraphVizStreamReader::Format QGraphVizStreamReader::format()
+{
+    return m_Format;
+}
+
+void QGraphVizStreamReader::setFormat(Format format)
+{
+    m_Format = format;
+}
+
+/*! The shortest time, in milliseconds, between two relayouts
+ */
+int QGraphVizStreamReader::interval()
+{
+    return m_Interval;
+}
+
+void QGraphVizStreamReader::setInterval(int msecs)
+{
+    m_Interval = qMax(0, msecs);
+}
+
+/*! The number of statements (or edge list lines) handed to the scene so far
+ */
+quint64 QGraphVizStreamReader::statementCount()
+{
+    return m_StatementCount;
+}
+
+/*! Commits whatever has been read so far, now
+ */
+void QGraphVizStreamReader::flush()
+{
+    m_CommitTimer.stop();
+    m_CommitWaiting = false;
+
+    if(!m_Updating || !m_Scene) {
+        return;
+    }
+
+    m_Updating = false;
+    m_LastCommit.restart();
+    m_Scene->commitUpdate();
+}
+
+void QGraphVizStreamReader::onReadyRead()
+{
+    if(!m_Device || !m_Scene) {
+        return;
+    }
+
+    m_Buffer += m_Device->readAll();
+
+    int start = 0;
+    int end = m_Buffer.indexOf('\n');
+    while(end >= 0) {
+        readLine(m_Buffer.mid(start, end - start));
+        start = end + 1;
+        end = m_Buffer.indexOf('\n', start);
+    }
+    m_Buffer.remove(0, start);
+
+    scheduleCommit();
+
+    if(!m_Device->isSequential() && m_Device->atEnd()) {
+        onReadChannelFinished();
+    }
+}
+
+/*! The last line needn't end with a newline
+ */
+void QGraphVizStreamReader::onReadChannelFinished()
+{
+    if(!m_Buffer.isEmpty() && m_Scene) {
+        readLine(m_Buffer);
+        m_Buffer.clear();
+    }
+
+    flush();
+    emit finished();
+}
+
+void QGraphVizStreamReader::onLayoutFinished()
+{
+    if(m_CommitWaiting) {
+        m_CommitWaiting = false;
+        scheduleCommit();
+    }
+}
+
+void QGraphVizStreamReader::scheduleCommit()
+{
+    if(!m_Updating || m_CommitTimer.isActive()) {
+        return;
+    }
+
+    if(m_Scene->isLayoutRunning()) {
+        m_CommitWaiting = true;
+        return;
+    }
+
+    m_CommitTimer.start(qMax<qint64>(0, m_Interval - m_LastCommit.elapsed()));
+}
+
+void QGraphVizStreamReader::beginUpdate()
+{
+    if(!m_Updating) {
+        m_Scene->beginUpdate();
+        m_Updating = true;
+    }
+}
+
+void QGraphVizStreamReader::readLine(const QByteArray &line)
+{
+    ++m_LineNumber;
+
+    if(m_Format == Format_EdgeList) {
+        readEdgeListLine(line);
+        return;
+    }
+
+    bool ok = true;
+    QList<Token> tokens = tokenize(line, ok);
+    if(!ok) {
+        emit streamError(tr("Line %1: unterminated string").arg(m_LineNumber));
+        return;
+    }
+
+    // Statements end at semicolons, and at braces, outside of attribute lists
+    QList<Token> statement;
+    int depth = 0;
+    foreach(const Token &token, tokens) {
+        if(token.is("[")) {
+            ++depth;
+        } else if(token.is("]")) {
+            --depth;
+        } else if(!depth && (token.is(";") || token.is("{") || token.is("}"))) {
+            readDotStatement(statement);
+            statement.clear();
+            continue;
+        }
+        statement.append(token);
+    }
+    readDotStatement(statement);
+}
+
+void QGraphVizStreamReader::readDotStatement(const QList<Token> &tokens)
+{
+    if(tokens.isEmpty()) {
+        return;
+    }
+
+    const Token &first = tokens.first();
+    const bool attributeList = tokens.count() > 1 && tokens.at(1).is("[");
+
+    // Graph and subgraph headers
+    if(first.is("strict") || first.is("digraph") || first.is("subgraph") || (first.is("graph") && !attributeList)) {
+        return;
+    }
+
+    Attributes attributes;
+
+    if(attributeList && (first.is("graph") || first.is("node") || first.is("edge"))) {
+        if(readAttributes(tokens, 1, attributes) != tokens.count()) {
+            emit streamError(tr("Line %1: malformed attribute list").arg(m_LineNumber));
+            return;
+        }
+
+        if(first.is("graph")) {
+            beginUpdate();
+            foreach(const QString &name, attributes.keys()) {
+                m_Scene->setGraphAttribute(name, attributes.value(name));
+            }
+        } else {
+            Attributes &defaults = first.is("node") ? m_NodeDefaults : m_EdgeDefaults;
+            foreach(const QString &name, attributes.keys()) {
+                defaults.insert(name, attributes.value(name));
+            }
+        }
+
+        ++m_StatementCount;
+        return;
+    }
+
+    if(tokens.count() == 3 && tokens.at(1).is("=")) {
+        beginUpdate();
+        m_Scene->setGraphAttribute(QString::fromLocal8Bit(first.text), QString::fromLocal8Bit(tokens.at(2).text));
+        ++m_StatementCount;
+        return;
+    }
+
+    QStringList nodes;
+    QStringList ports;
+    QString node, port;
+
+    int index = readNodeId(tokens, 0, node, port);
+    nodes.append(node);
+    ports.append(port);
+    while(index > 0 && index + 1 < tokens.count() && (tokens.at(index).is("->") || tokens.at(index).is("--"))) {
+        index = readNodeId(tokens, index + 1, node, port);
+        nodes.append(node);
+        ports.append(port);
+    }
+
+    if(index < 0) {
+        emit streamError(tr("Line %1: malformed node ID").arg(m_LineNumber));
+        return;
+    }
+
+    if(index < tokens.count() && tokens.at(index).is("[")) {
+        index = readAttributes(tokens, index, attributes);
+        if(index < 0) {
+            emit streamError(tr("Line %1: malformed attribute list").arg(m_LineNumber));
+            return;
+        }
+    }
+
+    if(index != tokens.count()) {
+        emit streamError(tr("Line %1: unexpected \"%2\"").arg(m_LineNumber)
+                         .arg(QString::fromLocal8Bit(tokens.at(index).text)));
+        return;
+    }
+
+    beginUpdate();
+
+    // A port on a node statement means nothing; on an edge, it's the edge's tailport or headport, as for GraphViz.
+    // The node defaults only go to nodes the statement creates; a node that's already there keeps its attributes.
+    if(nodes.count() == 1) {
+        m_Scene->addNode(nodes.first(), attributes, m_NodeDefaults);
+    } else {
+        Attributes merged = m_EdgeDefaults;
+        foreach(const QString &name, attributes.keys()) {
+            merged.insert(name, attributes.value(name));
+        }
+
+        for(int i = 0; i + 1 < nodes.count(); ++i) {
+            Attributes edgeAttributes = merged;
+            if(!ports.at(i).isEmpty()) {
+                edgeAttributes.insert("tailport", ports.at(i));
+            }
+            if(!ports.at(i + 1).isEmpty()) {
+                edgeAttributes.insert("headport", ports.at(i + 1));
+            }
+            m_Scene->addEdge(nodes.at(i), nodes.at(i + 1), edgeAttributes, m_NodeDefaults);
+        }
+    }
+
+    ++m_StatementCount;
+}
+
+void QGraphVizStreamReader::readEdgeListLine(const QByteArray &line)
+{
+    const QByteArray simplified = line.simplified();
+    if(simplified.isEmpty() || simplified.startsWith('#')) {
+        return;
+    }
+
+    QList<QByteArray> fields = simplified.split(' ');
+
+    // Trailing name=value fields are attributes
+    Attributes attributes;
+    while(fields.count() > 1 && fields.last().contains('=')) {
+        const QByteArray field = fields.takeLast();
+        const int equals = field.indexOf('=');
+        attributes.insert(QString::fromLocal8Bit(field.left(equals)), QString::fromLocal8Bit(field.mid(equals + 1)));
+    }
+
+    if(fields.count() > 2) {
+        emit streamError(tr("Line %1: expected a tail and a head").arg(m_LineNumber));
+        return;
+    }
+
+    beginUpdate();
+
+    if(fields.count() == 1) {
+        m_Scene->addNode(QString::fromLocal8Bit(fields.at(0)), attributes);
+    } else {
+        m_Scene->addEdge(QString::fromLocal8Bit(fields.at(0)), QString::fromLocal8Bit(fields.at(1)), attributes);
+    }
+
+    ++m_StatementCount;
+}
+
+/*! Splits a line of DOT into IDs and punctuation.  Quoted strings come back without their quotes, with escaped quotes
+    resolved, and marked as quoted; HTML strings keep their angle brackets, and count as quoted too.  The colons
+    between a node ID and its port are punctuation.
+ */
+QList<QGraphVizStreamReader::Token> QGraphVizStreamReader::tokenize(const QByteArray &line, bool &ok)
+{
+    QList<Token> tokens;
+    Token token;
+    ok = true;
+
+    const int length = line.length();
+    int i = 0;
+    while(i < length) {
+        const char c = line.at(i);
+        token.text.clear();
+        token.quoted = false;
+
+        if(isBlank(c)) {
+            ++i;
+            continue;
+        } else if(c == '#' && tokens.isEmpty()) {
+            break;
+        } else if(c == '/' && i + 1 < length && line.at(i + 1) == '/') {
+            break;
+        } else if(c == '/' && i + 1 < length && line.at(i + 1) == '*') {
+            const int end = line.indexOf("*/", i + 2);
+            if(end < 0) {
+                break;
+            }
+            i = end + 2;
+            continue;
+        } else if(c == '-' && i + 1 < length && (line.at(i + 1) == '>' || line.at(i + 1) == '-')) {
+            token.text = line.mid(i, 2);
+            i += 2;
+        } else if(isPunctuation(c)) {
+            token.text = QByteArray(1, c);
+            ++i;
+        } else if(c == '"') {
+            // Only \" is unescaped; any other backslash stays, along with the character after it, which can't end
+            // the string
+            ++i;
+            while(i < length && line.at(i) != '"') {
+                if(line.at(i) == '\\' && i + 1 < length) {
+                    if(line.at(i + 1) != '"') {
+                        token.text += '\\';
+                    }
+                    ++i;
+                }
+                token.text += line.at(i++);
+            }
+            if(i >= length) {
+                ok = false;
+                return tokens;
+            }
+            ++i;
+            token.quoted = true;
+        } else if(c == '<') {
+            int depth = 0;
+            const int start = i;
+            do {
+                if(line.at(i) == '<') {
+                    ++depth;
+                } else if(line.at(i) == '>') {
+                    --depth;
+                }
+                ++i;
+            } while(depth && i < length);
+            if(depth) {
+                ok = false;
+                return tokens;
+            }
+            token.text = line.mid(start, i - start);
+            token.quoted = true;
+        } else {
+            const int start = i;
+            while(i < length && !isBlank(line.at(i)) && !isPunctuation(line.at(i)) && line.at(i) != '"'
+                  && !(line.at(i) == '-' && i + 1 < length && (line.at(i + 1) == '>' || line.at(i + 1) == '-'))) {
+                ++i;
+            }
+            token.text = line.mid(start, i - start);
+        }
+
+        tokens.append(token);
+    }
+
+    return tokens;
+}
+
+/*! Reads the node ID at index, with its port and compass point if it has them ("port" or "port:compass", as in the
+    tailport and headport attributes).  Returns the index of the token after it, or -1 if it's malformed.
+ */
+int QGraphVizStreamReader::readNodeId(const QList<Token> &tokens, int index, QString &node, QString &port)
+{
+    if(index >= tokens.count() || tokens.at(index).isPunctuation()
+            || tokens.at(index).is("->") || tokens.at(index).is("--")) {
+        return -1;
+    }
+
+    node = QString::fromLocal8Bit(tokens.at(index++).text);
+    port.clear();
+
+    for(int part = 0; part < 2 && index < tokens.count() && tokens.at(index).is(":"); ++part) {
+        if(index + 1 >= tokens.count() || tokens.at(index + 1).isPunctuation()
+                || tokens.at(index + 1).is("->") || tokens.at(index + 1).is("--")) {
+            return -1;
+        }
+        if(part) {
+            port += ':';
+        }
+        port += QString::fromLocal8Bit(tokens.at(index + 1).text);
+        index += 2;
+    }
+
+    return index;
+}
+
+/*! Reads the attribute lists starting at index, which must be a "[", into attributes.  Returns the index of the token
+    after the last list, or -1 if one is malformed.
+ */
+int QGraphVizStreamReader::readAttributes(const QList<Token> &tokens, int index, Attributes &attributes)
+{
+    while(index < tokens.count() && tokens.at(index).is("[")) {
+        ++index;
+        while(index < tokens.count() && !tokens.at(index).is("]")) {
+            const Token &token = tokens.at(index);
+            if(token.is(",") || token.is(";")) {
+                ++index;
+                continue;
+            }
+
+            if(index + 2 >= tokens.count() || !tokens.at(index + 1).is("=") || token.isPunctuation()
+                    || tokens.at(index + 2).isPunctuation()) {
+                return -1;
+            }
+
+            attributes.insert(QString::fromLocal8Bit(token.text), QString::fromLocal8Bit(tokens.at(index + 2).text));
+            index += 3;
+        }
+
+        if(index >= tokens.count()) {
+            return -1;
+        }
+        ++index;
+    }
+
+    return index;
+}
@@ -0,0 +1,113 @@
+/*!
+   \file
+   \author Dane Gardner <dane.gardner@gmail.com>
+   \version
+
+   \section LICENSE
+   This file is part of the Parallel Tools GUI Framework (PTGF)
+   Copyright (C) 2010-2011 Argo Navis Technologies, LLC
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+   \section DESCRIPTION
+
+ */
+
+
+#ifndef QGRAPHVIZSTREAMREADER_H
+#define QGRAPHVIZSTREAMREADER_H
+
+#include <QtCore>
+
+#include "QGraphVizLibrary.h"
+
+class QGraphVizScene;
+
+class QGRAPHVIZ_EXPORT QGraphVizStreamReader : public QObject
+{
+    Q_OBJECT
+public:
+    enum Format { Format_Dot, Format_EdgeList };
+
+    explicit QGraphVizStreamReader(QGraphVizScene *scene, QIODevice *device = 0, QObject *parent = 0);
+    ~QGraphVizStreamReader();
+
+    QGraphVizScene *scene();
+
+    QIODevice *device();
+    void setDevice(QIODevice *device);
+
+    Format format();
+    void setFormat(Format format);
+
+    int interval();
+    void setInterval(int msecs);
+
+    quint64 statementCount();
+
+signals:
+    void streamError(QString message);
+    void finished();
+
+public slots:
+    void flush();
+
+private slots:
+    void onReadyRead();
+    void onReadChannelFinished();
+    void onLayoutFinished();
+    void scheduleCommit();
+
+private:
+    typedef QHash<QString, QString> Attributes;
+
+    /*! A quoted token is always an ID, even if it reads like a keyword or punctuation
+     */
+    struct Token {
+        QByteArray text;
+        bool quoted;
+
+        bool is(const char *symbol) const { return !quoted && text == symbol; }
+        bool isPunctuation() const;
+    };
+
+    void readLine(const QByteArray &line);
+    void readDotStatement(const QList<Token> &tokens);
+    void readEdgeListLine(const QByteArray &line);
+    void beginUpdate();
+
+    static QList<Token> tokenize(const QByteArray &line, bool &ok);
+    static int readNodeId(const QList<Token> &tokens, int index, QString &node, QString &port);
+    static int readAttributes(const QList<Token> &tokens, int index, Attributes &attributes);
+
+    QPointer<QGraphVizScene> m_Scene;
+    QPointer<QIODevice> m_Device;
+    Format m_Format;
+    int m_Interval;
+
+    QByteArray m_Buffer;
+    quint64 m_LineNumber;
+    quint64 m_StatementCount;
+    Attributes m_NodeDefaults;
+    Attributes m_EdgeDefaults;
+
+    bool m_Updating;
+    bool m_CommitWaiting;
+    QTimer m_CommitTimer;
+    QElapsedTimer m_LastCommit;
+
+};
+
+#endif // QGRAPHVIZSTREAMREADER_H
@@ -0,0 +1,216 @@
+/*!
+   \file
+   \author Dane Gardner <dane.gardner@gmail.com>
+   \version
+
+   \section LICENSE
+   This file is part of the Parallel Tools GUI Framework (PTGF)
+   Copyright (C) 2010-2011 Argo Navis Technologies, LLC
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+   \section DESCRIPTION
+
+ */
+
+
+#include "QGraphVizStyleTable.h"
+
+/*! Mixes a value into a hash; reals are hashed at a fixed precision, so equal values always hash alike
+ */
+static inline uint mixHash(uint hash, uint value)
+{
+    return (hash ^ value) * 16777619U;
+}
+
+static inline uint mixHash(uint hash, qreal value)
+{
+    const qint64 fixed = qRound64(value * 1024.0);
+    return mixHash(mixHash(hash, uint(fixed)), uint(fixed >> 32));
+}
+
+QGraphVizStyleTable::QGraphVizStyleTable(QObject *parent) :
+    QObject(parent)
+{
+}
+
+/*! Returns the index of a record that looks like style, adding one if there's none yet
+ */
+int QGraphVizStyleTable::addStyle(const Style &style)
+{
+    const uint hash = hashStyle(style);
+
+    QMultiHash<uint, int>::const_iterator iterator = m_StyleIndex.constFind(hash);
+    while(iterator != m_StyleIndex.constEnd() && iterator.key() == hash) {
+        if(equalStyles(m_Styles.at(iterator.value()), style)) {
+            return iterator.value();
+        }
+        ++iterator;
+    }
+
+    const int index = m_Styles.count();
+    m_Styles.append(style);
+    m_StyleIndex.insert(hash, index);
+    return index;
+}
+
+/*! The record at index; only valid until the next addStyle(), so copy anything that has to outlive that
+ */
+const QGraphVizStyleTable::Style &QGraphVizStyleTable::style(int index) const
+{
+    if(index < 0 || index >= m_Styles.count()) {
+        return m_DefaultStyle;
+    }
+
+    return m_Styles.at(index);
+}
+
+int QGraphVizStyleTable::styleCount() const
+{
+    return m_Styles.count();
+}
+
+/*! Returns the index of a path identical to path, adding one if there's none yet
+ */
+int QGraphVizStyleTable::addPath(const QPainterPath &path)
+{
+    if(path.isEmpty()) {
+        return -1;
+    }
+
+    const uint hash = hashPath(path);
+
+    QMultiHash<uint, int>::const_iterator iterator = m_PathIndex.constFind(hash);
+    while(iterator != m_PathIndex.constEnd() && iterator.key() == hash) {
+        if(m_Paths.at(iterator.value()) == path) {
+            return iterator.value();
+        }
+        ++iterator;
+    }
+
+    const int index = m_Paths.count();
+    m_Paths.append(path);
+    m_PathIndex.insert(hash, index);
+    return index;
+}
+
+/*! The path at index; only valid until the next addPath(), so copy it if it has to outlive that
+ */
+const QPainterPath &QGraphVizStyleTable::path(int index) const
+{
+    if(index < 0 || index >= m_Paths.count()) {
+        return m_EmptyPath;
+    }
+
+    return m_Paths.at(index);
+}
+
+int QGraphVizStyleTable::pathCount() const
+{
+    return m_Paths.count();
+}
+
+/*! Approximate bytes held by the table; see memoryUsage(const Style&)
+ */
+qint64 QGraphVizStyleTable::memoryUsage() const
+{
+    qint64 bytes = qint64(m_Styles.capacity() - m_Styles.count()) * sizeof(Style)
+            + qint64(m_Paths.capacity() - m_Paths.count()) * sizeof(QPainterPath)
+            + qint64(m_StyleIndex.capacity() + m_PathIndex.capacity()) * (sizeof(uint) + sizeof(int) + sizeof(void*));
+
+    foreach(const Style &style, m_Styles) {
+        bytes += memoryUsage(style);
+    }
+
+    foreach(const QPainterPath &path, m_Paths) {
+        bytes += memoryUsage(path);
+    }
+
+    return bytes;
+}
+
+/*! Approximate bytes for one copy of a style.  Only what's visible from here is counted; the private data that Qt
+    allocates behind each pen, brush and font isn't, so this is a lower bound.
+ */
+qint64 QGraphVizStyleTable::memoryUsage(const Style &style)
+{
+    return qint64(sizeof(Style)) + (style.labelFont.family().capacity() * sizeof(QChar));
+}
+
+/*! Approximate bytes for one copy of a path: the path and its elements
+ */
+qint64 QGraphVizStyleTable::memoryUsage(const QPainterPath &path)
+{
+    return qint64(sizeof(QPainterPath)) + (qint64(path.elementCount()) * sizeof(QPainterPath::Element));
+}
+
+/*! Forgets every record; any index held by an item is left referring to the defaults
+ */
+void QGraphVizStyleTable::clear()
+{
+    m_Styles.clear();
+    m_StyleIndex.clear();
+    m_Paths.clear();
+    m_PathIndex.clear();
+}
+
+uint QGraphVizStyleTable::hashStyle(const Style &style)
+{
+    uint hash = 2166136261U;
+
+    hash = mixHash(hash, uint(style.pen.color().rgba()));
+    hash = mixHash(hash, style.pen.widthF());
+    hash = mixHash(hash, uint(style.pen.style()) | (uint(style.pen.joinStyle()) << 8) | (uint(style.pen.capStyle()) << 16));
+
+    hash = mixHash(hash, uint(style.brush.color().rgba()));
+    hash = mixHash(hash, uint(style.brush.style()));
+
+    hash = mixHash(hash, qHash(style.labelFont.family()));
+    hash = mixHash(hash, style.labelFont.pointSizeF());
+    hash = mixHash(hash, uint(style.labelColor.rgba()));
+
+    hash = mixHash(hash, uint(style.labelOptions.alignment()) ^ (uint(style.labelOptions.wrapMode()) << 16));
+
+    return hash;
+}
+
+bool QGraphVizStyleTable::equalStyles(const Style &style, const Style &other)
+{
+    // QTextOption has no comparison of its own; these are the parts of it that items set
+    return style.pen == other.pen &&
+            style.brush == other.brush &&
+            style.labelFont == other.labelFont &&
+            style.labelColor == other.labelColor &&
+            style.labelOptions.alignment() == other.labelOptions.alignment() &&
+            style.labelOptions.wrapMode() == other.labelOptions.wrapMode() &&
+            style.labelOptions.flags() == other.labelOptions.flags() &&
+            style.labelOptions.textDirection() == other.labelOptions.textDirection() &&
+            style.labelOptions.tabStop() == other.labelOptions.tabStop() &&
+            style.labelOptions.tabs().isEmpty() && other.labelOptions.tabs().isEmpty();
+}
+
+uint QGraphVizStyleTable::hashPath(const QPainterPath &path)
+{
+    uint hash = mixHash(2166136261U, uint(path.fillRule()));
+
+    for(int i = 0; i < path.elementCount(); ++i) {
+        const QPainterPath::Element &element = path.elementAt(i);
+        hash = mixHash(hash, uint(element.type));
+        hash = mixHash(hash, element.x);
+        hash = mixHash(hash, element.y);
+    }
+
+    return hash;
+}
@@ -0,0 +1,91 @@
+/*!
+   \file
+   \author Dane Gardner <dane.gardner@gmail.com>
+   \version
+
+   \section LICENSE
+   This file is part of the Parallel Tools GUI Framework (PTGF)
+   Copyright (C) 2010-2011 Argo Navis Technologies, LLC
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+   \section DESCRIPTION
+
+ */
+
+
+#ifndef QGRAPHVIZSTYLETABLE_H
+#define QGRAPHVIZSTYLETABLE_H
+
+#include <QtCore>
+#include <QtGui>
+
+#include "QGraphVizLibrary.h"
+
+/*! The styles and shapes of a scene's items, each kept once and shared by every item that looks the same.  Items
+    hold indices into the table rather than their own pens, brushes, fonts and paths; in a large graph most of them
+    look like most of the others, so a few hundred records stand in for hundreds of thousands of copies.
+
+    Records are immutable once added; an item that changes its look adds the new record and switches to its index.
+    Nothing is removed until clear(), which the scene calls once all of its items are gone.
+ */
+class QGRAPHVIZ_EXPORT QGraphVizStyleTable : public QObject
+{
+    Q_OBJECT
+public:
+    struct Style {
+        QPen pen;
+        QBrush brush;
+        QFont labelFont;
+        QColor labelColor;
+        QTextOption labelOptions;
+    };
+
+    explicit QGraphVizStyleTable(QObject *parent = 0);
+
+    int addStyle(const Style &style);
+    const Style &style(int index) const;
+    int styleCount() const;
+
+    int addPath(const QPainterPath &path);
+    const QPainterPath &path(int index) const;
+    int pathCount() const;
+
+    qint64 memoryUsage() const;
+    static qint64 memoryUsage(const Style &style);
+    static qint64 memoryUsage(const QPainterPath &path);
+
+public slots:
+    void clear();
+
+protected:
+    static uint hashStyle(const Style &style);
+    static bool equalStyles(const Style &style, const Style &other);
+    static uint hashPath(const QPainterPath &path);
+
+private:
+    QVector<Style> m_Styles;
+    QMultiHash<uint, int> m_StyleIndex;
+
+    QVector<QPainterPath> m_Paths;
+    QMultiHash<uint, int> m_PathIndex;
+
+    // What an index of -1 (or any other out of range) refers to; the look of an item that hasn't set one
+    Style m_DefaultStyle;
+    QPainterPath m_EmptyPath;
+
+};
+
+#endif // QGRAPHVIZSTYLETABLE_H
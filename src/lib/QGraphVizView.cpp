@@ -66,6 +66,12 @@ void QGraphVizView::init()
     m_PictureInPicture->updateViewPortRect();
 
     connect(scene(), SIGNAL(selectionChanged()), this, SLOT(selectionChanged()));
+
+    // Asynchronous scenes are still empty at this point; pick up the scene rect once the layout is done
+    QGraphVizScene *graphVizScene = qobject_cast<QGraphVizScene*>(scene());
+    if(graphVizScene) {
+        connect(graphVizScene, SIGNAL(layoutFinished()), this, SLOT(layoutFinished()));
+    }
 }
 
 
@@ -351,6 +357,15 @@ void QGraphVizView::selectionChanged()
     }
 }
 
+void QGraphVizView::layoutFinished()
+{
+    QRectF sceneRect = scene()->sceneRect();
+    sceneRect.adjust(-50, -50, 50, 50);
+    setSceneRect(sceneRect);
+
+    m_PictureInPicture->updateViewPortRect();
+}
+
 void QGraphVizView::scrollContentsBy(int dx, int dy)
 {
     QGraphicsView::scrollContentsBy(dx, dy);
@@ -88,6 +88,7 @@ protected:
 
 protected slots:
     virtual void selectionChanged();
+    virtual void layoutFinished();
 
 private:
     qreal m_Scale;
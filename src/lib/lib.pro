@@ -30,29 +30,64 @@ INSTALLS         += target
 
 HEADERS  += QGraphVizNode.h \
             QGraphVizEdge.h \
+            QGraphVizEdgeRange.h \
+            QGraphVizEdgeLayer.h \
             QGraphVizView.h \
             QGraphVizPIP.h \
             QGraphVizScene.h \
             QGraphVizLibrary.h \
     QGraphVizNodeEffect.h \
+    QGraphVizLabelCache.h \
+    QGraphVizGeometry.h \
+    QGraphVizLayoutCache.h \
+    QGraphVizNativeLayout.h \
+    QGraphVizComponents.h \
+    QGraphVizLayoutPool.h \
+    QGraphVizStreamReader.h \
+    QGraphVizDotGraph.h \
+    QGraphVizDecompressor.h \
+    QGraphVizAttributes.h \
+    QGraphVizStyleTable.h \
     QPixmapFilter.h
 
 SOURCES +=  QGraphVizNode.cpp \
             QGraphVizEdge.cpp \
+            QGraphVizEdgeLayer.cpp \
             QGraphVizView.cpp \
             QGraphVizPIP.cpp \
             QGraphVizScene.cpp \
-    QGraphVizNodeEffect.cpp
+    QGraphVizNodeEffect.cpp \
+    QGraphVizLabelCache.cpp \
+    QGraphVizGeometry.cpp \
+    QGraphVizLayoutCache.cpp \
+    QGraphVizNativeLayout.cpp \
+    QGraphVizComponents.cpp \
+    QGraphVizLayoutPool.cpp \
+    QGraphVizStreamReader.cpp \
+    QGraphVizDotGraph.cpp \
+    QGraphVizDecompressor.cpp \
+    QGraphVizAttributes.cpp \
+    QGraphVizStyleTable.cpp
 
-LIBS += -lgraph -lcdt -lpathplan -lxdot -lgvc
+LIBS += -lgraph -lcdt -lpathplan -lxdot -lgvc -lz
 
 DEFINES          += QGRAPHVIZ_LIBRARY
+DEFINES          += QGRAPHVIZ_WORKER=\\\"Layout$${APPLICATION_TARGET}$${LIB_POSTFIX}\\\"
 
 #debug:DEFINES    += QGRAPHVIZVIEW_DEBUG
 #debug:DEFINES    += QGRAPHVIZSCENE_DEBUG
 #debug:DEFINES    += QGRAPHVIZNODE_DEBUG
 #debug:DEFINES    += QGRAPHVIZEDGE_DEBUG
 
+# Reading zstd compressed content needs libzstd
+#DEFINES          += QGRAPHVIZ_ZSTD
+contains(DEFINES, QGRAPHVIZ_ZSTD):LIBS += -lzstd
+
 qGraphVizHeaders.path = /include
-qGraphVizHeaders.files = QGraphVizLibrary.h QGraphVizView.h QGraphVizScene.h QGraphVizNode.h QGraphVizEdge.h
+qGraphVizHeaders.files = QGraphVizLibrary.h QGraphVizView.h QGraphVizScene.h QGraphVizNode.h QGraphVizEdge.h QGraphVizEdgeRange.h \
+                         QGraphVizNodeEffect.h QGraphVizEdgeLayer.h \
+                         QGraphVizLabelCache.h QGraphVizGeometry.h QGraphVizLayoutCache.h \
+                         QGraphVizNativeLayout.h QGraphVizComponents.h QGraphVizLayoutPool.h \
+                         QGraphVizStreamReader.h QGraphVizDotGraph.h QGraphVizDecompressor.h \
+                         QGraphVizAttributes.h QGraphVizStyleTable.h
 INSTALLS += qGraphVizHeaders
@@ -52,11 +52,10 @@ MainWindow::MainWindow(QWidget *parent) :
     }
 
     if(file.exists()) {
-        file.open(QIODevice::ReadOnly);
-        QByteArray data = file.readAll();
-        file.close();
-
-        QGraphVizScene *gv = new QGraphVizScene(QString(data), this);
+        QGraphVizScene *gv = new QGraphVizScene(this);
+        gv->setAsynchronous(true);
+        connect(gv, SIGNAL(layoutFailed(QString)), this, SLOT(layoutFailed(QString)));
+        gv->setContentFile(file.fileName());
 
         QGraphVizView *view = new QGraphVizView(gv);
 //        view->setNodeCollapse(QGraphVizView::NodeCollapse_OnDoubleClick);
@@ -76,3 +75,8 @@ MainWindow::~MainWindow()
 {
     delete ui;
 }
+
+void MainWindow::layoutFailed(QString message)
+{
+    qCritical() << "layout failed: " << message;
+}
@@ -43,6 +43,9 @@ public:
     explicit MainWindow(QWidget *parent = 0);
     ~MainWindow();
 
+protected slots:
+    void layoutFailed(QString message);
+
 private:
     Ui::MainWindow *ui;
 };
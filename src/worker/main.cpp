@@ -0,0 +1,142 @@
+/*!
+   \file
+   \author Dane Gardner <dane.gardner@gmail.com>
+   \version
+
+   \section LICENSE
+   This file is part of the Parallel Tools GUI Framework (PTGF)
+   Copyright (C) 2010-2011 Argo Navis Technologies, LLC
+
+   This library is free software; you can redistribute it and/or modify it
+   under the terms of the GNU Lesser General Public License as published by the
+   Free Software Foundation; either version 2.1 of the License, or (at your
+   option) any later version.
+
+   This library is distributed in the hope that it will be useful, but WITHOUT
+   ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+   FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+   for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this library; if not, write to the Free Software Foundation,
+   Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+   \section DESCRIPTION
+
+ */
+
+
+#include <QtCore>
+
+#if defined(Q_OS_WIN)
+#  include <io.h>
+#  include <fcntl.h>
+#elif defined(Q_OS_UNIX)
+#  include <sys/resource.h>
+#endif
+
+#include <graphviz/gvc.h>
+#include <graphviz/graph.h>
+
+#include <QGraphVizGeometry.h>
+#include <QGraphVizLayoutPool.h>
+
+static void usage()
+{
+    QTextStream(stderr)
+            << "Usage: " << QFileInfo(QCoreApplication::applicationFilePath()).fileName() << " [options]" << endl
+            << "Lays out the DOT graphs on standard input, and writes the results to standard output for" << endl
+            << "QGraphVizLayoutPool.  Not meant to be run by hand." << endl << endl
+            << "  --engine <name>          GraphViz layout engine (default dot)" << endl
+            << "  --memory-limit <MB>      fail rather than allocate more than this" << endl;
+}
+
+static bool limitMemory(int megabytes)
+{
+#if defined(Q_OS_UNIX)
+    struct rlimit limit;
+    limit.rlim_cur = limit.rlim_max = rlim_t(megabytes) * 1024 * 1024;
+    return !setrlimit(RLIMIT_AS, &limit);
+#else
+    Q_UNUSED(megabytes);
+    return true;
+#endif
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QTextStream error(stderr);
+
+    QString engine("dot");
+    int memoryLimit = 0;
+
+    QStringList arguments = QCoreApplication::arguments();
+    arguments.removeFirst();
+    while(!arguments.isEmpty()) {
+        QString argument = arguments.takeFirst();
+
+        if(argument == "--engine" && !arguments.isEmpty()) {
+            engine = arguments.takeFirst();
+        } else if(argument == "--memory-limit" && !arguments.isEmpty()) {
+            memoryLimit = arguments.takeFirst().toInt();
+        } else {
+            usage();
+            return (argument == "--help" || argument == "-h") ? 0 : 1;
+        }
+    }
+
+    if(memoryLimit > 0 && !limitMemory(memoryLimit)) {
+        error << "Failed to limit memory to " << memoryLimit << "MB." << endl;
+        return 1;
+    }
+
+#if defined(Q_OS_WIN)
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+    QFile input;
+    if(!input.open(stdin, QIODevice::ReadOnly)) {
+        error << "Failed to read standard input." << endl;
+        return 1;
+    }
+    QList<QByteArray> contents;
+    if(!QGraphVizLayoutPool::readInput(input.readAll(), contents)) {
+        error << "Standard input isn't from QGraphVizLayoutPool." << endl;
+        return 1;
+    }
+
+    GVC_t *context = gvContext();
+
+    QList<QGraphVizGeometry> geometries;
+    for(int i = 0; i < contents.count(); ++i) {
+        graph_t *graph = agmemread(contents[i].data());
+        if(!graph) {
+            error << "Failed to parse content." << endl;
+            return 2;
+        }
+
+        if(gvLayout(context, graph, engine.toLocal8Bit().data())) {
+            error << "Layout failed" << endl;
+            return 3;
+        }
+
+        geometries.append(QGraphVizGeometry::fromGraph(graph));
+
+        gvFreeLayout(context, graph);
+        agclose(graph);
+    }
+
+    gvFreeContext(context);
+
+    QFile output;
+    if(!output.open(stdout, QIODevice::WriteOnly)) {
+        error << "Failed to write standard output." << endl;
+        return 1;
+    }
+    QGraphVizLayoutPool::writeResult(&output, geometries);
+    output.close();
+
+    return 0;
+}